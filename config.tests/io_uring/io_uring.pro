@@ -0,0 +1,2 @@
+SOURCES += io_uring.cpp
+CONFIG -= qt
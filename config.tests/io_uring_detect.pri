@@ -0,0 +1,6 @@
+isEmpty(CONFIG_TEST_LOADED): include(config_test.pri)
+
+configTest(io_uring) {
+    writeCacheAppendVar(CONFIG, have_io_uring)
+}
+writeCacheVar(IO_URING_DETECT_DONE, yes)
@@ -1,6 +1,8 @@
 
 # Detect libusb on Linux systems.
 linux*:!isEqual(LIBUSB_DETECT_DONE,yes): include(config.tests/libusb_detect.pri)
+# Detect io_uring support in the kernel headers on Linux systems.
+linux*:!isEqual(IO_URING_DETECT_DONE,yes): include(config.tests/io_uring_detect.pri)
 QMAKE_DISTCLEAN += .qmake.cache
 
 TEMPLATE = subdirs
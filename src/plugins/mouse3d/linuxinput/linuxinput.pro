@@ -2,11 +2,17 @@ TARGET  = qmouse3dlinuxinput
 include(../../qpluginbase.pri)
 
 HEADERS += qmouse3dlinuxinputdevice.h \
+           qmouse3dhidrawdevice.h \
+           qmouse3dlinuxinputparser.h \
+           qmouse3dlinuxinputreader.h \
            qmouse3dlcdscreen.h \
            qmouse3dhaldevice.h \
            qextmouse3dudevdevice.h
 SOURCES += main.cpp \
            qmouse3dlinuxinputdevice.cpp \
+           qmouse3dhidrawdevice.cpp \
+           qmouse3dlinuxinputparser.cpp \
+           qmouse3dlinuxinputreader.cpp \
            qmouse3dlcdscreen.cpp \
            qmouse3dhaldevice.cpp \
            qextmouse3dudevdevice.cpp
@@ -25,4 +31,10 @@ QT += dbus
     LIBS += -ludev
 # }
 
+have_io_uring {
+    DEFINES += QT_HAVE_IO_URING
+    HEADERS += qmouse3dlinuxinputuring.h
+    SOURCES += qmouse3dlinuxinputuring.cpp
+}
+
 include(../../../../src/threed/threed_dep.pri)
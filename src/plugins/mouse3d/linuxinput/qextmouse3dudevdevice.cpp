@@ -1,4 +1,5 @@
 #include "qextmouse3dudevdevice.h"
+#include "qmouse3dhidrawdevice.h"
 
 #include <QtCore/qdebug.h>
 #include <sys/types.h>
@@ -7,6 +8,7 @@
 #include <sys/time.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <linux/input.h>
 #include <libudev.h>
@@ -17,8 +19,14 @@ QT_BEGIN_NAMESPACE
 
 // Qt5 has QDeviceDiscovery
 
+// Set QT_MOUSE3D_HIDRAW in the environment to read 3Dconnexion devices
+// from /dev/hidrawN instead of the Linux input event interface.  The
+// HID reports carry the state of all buttons at once and a motion
+// takes two reads instead of one read of up to seven events.
+
 QExtMouse3DUdevDevice::QExtMouse3DUdevDevice(QObject *parent):
     QExtMouse3DDevice(parent)
+    , useHidraw(!qgetenv("QT_MOUSE3D_HIDRAW").isEmpty())
 {
     struct udev_enumerate *enumerate;
     struct udev_list_entry *devices, *dev_list_entry;
@@ -35,7 +43,8 @@ QExtMouse3DUdevDevice::QExtMouse3DUdevDevice(QObject *parent):
     /* Listen to monitor events from the 'input' subsystem
      * Events can be: "add", "remove", "change", "online", and "offline") */
     monitor = udev_monitor_new_from_netlink(udev, "udev");
-    udev_monitor_filter_add_match_subsystem_devtype(monitor, "input", NULL);
+    const char *subsystem = (useHidraw ? "hidraw" : "input");
+    udev_monitor_filter_add_match_subsystem_devtype(monitor, subsystem, NULL);
     udev_monitor_enable_receiving(monitor);
     fd = udev_monitor_get_fd(monitor);
     notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
@@ -43,9 +52,9 @@ QExtMouse3DUdevDevice::QExtMouse3DUdevDevice(QObject *parent):
             this, SLOT(monitorEvent(int)));
     notifier->setEnabled(true);
 
-    /* Walk the devices in the 'input' subsystem. */
+    /* Walk the devices in the 'input' or 'hidraw' subsystem. */
     enumerate = udev_enumerate_new(udev);
-    udev_enumerate_add_match_subsystem(enumerate, "input");
+    udev_enumerate_add_match_subsystem(enumerate, subsystem);
     udev_enumerate_scan_devices(enumerate);
     devices = udev_enumerate_get_list_entry(enumerate);
     udev_list_entry_foreach(dev_list_entry, devices) {
@@ -77,6 +86,33 @@ QStringList QExtMouse3DUdevDevice::deviceNames() const
     return names;
 }
 
+// The identifiers from udev are known before the device is opened,
+// so they fill in for the ones that the device has not read yet.
+QList<QExtMouse3DDeviceDescriptor> QExtMouse3DUdevDevice::deviceDescriptors() const
+{
+    QList<QExtMouse3DDeviceDescriptor> descriptors;
+    for (int index = 0; index < devices.size(); ++index) {
+        const MouseInfo *info = devices.at(index);
+        QExtMouse3DDeviceDescriptor descriptor =
+            info->device->deviceDescriptors().value(0);
+        descriptor.name = info->realName;
+        if (!descriptor.vendorId && !descriptor.productId) {
+            descriptor.vendorId = info->vendorId;
+            descriptor.productId = info->productId;
+        }
+        descriptors.append(descriptor);
+    }
+    return descriptors;
+}
+
+QList<QExtMouse3DDevice *> QExtMouse3DUdevDevice::inputDevices() const
+{
+    QList<QExtMouse3DDevice *> inputs;
+    for (int index = 0; index < devices.size(); ++index)
+        inputs.append(devices[index]->device);
+    return inputs;
+}
+
 void QExtMouse3DUdevDevice::setProvider(QExtMouse3DEventProvider *provider)
 {
     QExtMouse3DDevice::setProvider(provider);
@@ -105,6 +141,64 @@ void QExtMouse3DUdevDevice::updateSensitivity(qreal sensitivity)
         devices[index]->device->updateSensitivity(sensitivity);
 }
 
+void QExtMouse3DUdevDevice::updateReadMode(QExtMouse3DEventProvider::ReadMode mode)
+{
+    QExtMouse3DDevice::updateReadMode(mode);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateReadMode(mode);
+}
+
+void QExtMouse3DUdevDevice::updateAggregation
+    (QExtMouse3DEventProvider::Aggregation aggregation)
+{
+    QExtMouse3DDevice::updateAggregation(aggregation);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateAggregation(aggregation);
+}
+
+void QExtMouse3DUdevDevice::updateKeepOpen(bool keepOpen)
+{
+    QExtMouse3DDevice::updateKeepOpen(keepOpen);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateKeepOpen(keepOpen);
+}
+
+void QExtMouse3DUdevDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    QExtMouse3DDevice::updateAdaptiveCalibration(adaptive);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateAdaptiveCalibration(adaptive);
+}
+
+void QExtMouse3DUdevDevice::updateReaderOptions(const QExtMouse3DReaderOptions &options)
+{
+    QExtMouse3DDevice::updateReaderOptions(options);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateReaderOptions(options);
+}
+
+void QExtMouse3DUdevDevice::updateWakeupRate(int rate)
+{
+    QExtMouse3DDevice::updateWakeupRate(rate);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateWakeupRate(rate);
+}
+
+void QExtMouse3DUdevDevice::updateMotionSink(QExtMouse3DMotionSink *sink)
+{
+    QExtMouse3DDevice::updateMotionSink(sink);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateMotionSink(sink);
+}
+
+void QExtMouse3DUdevDevice::updateDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    QExtMouse3DDevice::updateDelivery(delivery);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateDelivery(delivery);
+}
+
 void QExtMouse3DUdevDevice::deviceAdded(const char *sysPath)
 {
     struct udev_device *dev = udev_device_new_from_syspath(udev, sysPath);
@@ -112,6 +206,23 @@ void QExtMouse3DUdevDevice::deviceAdded(const char *sysPath)
     if (!dev)
         return;
 
+    if (useHidraw) {
+        QString devPath(udev_device_get_devnode(dev));
+        QExtMouse3DDevice *device = 0;
+        foreach (MouseInfo *info, devices) {
+            if (info->devPath == devPath) {
+                udev_device_unref(dev);
+                return;
+            }
+        }
+        if (!devPath.isEmpty())
+            device = createHidrawDevice(dev, devPath);
+        udev_device_unref(dev);
+        if (device)
+            emit availableChanged();
+        return;
+    }
+
     // If the input device node is not a mouse, then bail out.
     // (A mouse provides both event and mouse nodes)
     QString devPath(udev_device_get_devnode(dev));
@@ -140,9 +251,16 @@ void QExtMouse3DUdevDevice::deviceAdded(const char *sysPath)
     qDebug() << "deviceAdded:" << realName << devPath;
 
     // Add an entry to the device list.
+    int vendor = QString(udev_device_get_property_value(dev, "ID_VENDOR_ID"))
+                    .toInt(0, 16);
+    int product = QString(udev_device_get_property_value(dev, "ID_MODEL_ID"))
+                    .toInt(0, 16);
     QExtMouse3DLinuxInputDevice *device =
         new QExtMouse3DLinuxInputDevice(realName, realName);
-    MouseInfo *info = new MouseInfo(sysPath, devPath, realName, device);
+    connect(device, SIGNAL(descriptorChanged()),
+            this, SIGNAL(descriptorChanged()));
+    MouseInfo *info = new MouseInfo(sysPath, devPath, realName,
+                                    vendor, product, device);
     devices.append(info);
 
     // Tell the application that there is a new mouse attached.
@@ -151,6 +269,43 @@ void QExtMouse3DUdevDevice::deviceAdded(const char *sysPath)
     udev_device_unref(dev);
 }
 
+// Creates a device for the hidraw node \a devPath if the HID device
+// behind it is a 3Dconnexion 3D mouse, which has either the Logitech
+// vendor identifier and a product identifier of 0xc6xx, or the
+// 3Dconnexion vendor identifier.
+QExtMouse3DDevice *QExtMouse3DUdevDevice::createHidrawDevice
+    (struct udev_device *dev, const QString &devPath)
+{
+    struct udev_device *hid =
+        udev_device_get_parent_with_subsystem_devtype(dev, "hid", NULL);
+    if (!hid)
+        return 0;
+    const char *hidId = udev_device_get_property_value(hid, "HID_ID");
+    unsigned int bus, vendor, product;
+    if (!hidId || sscanf(hidId, "%x:%x:%x", &bus, &vendor, &product) != 3)
+        return 0;
+    bool is3Dconnexion = ((vendor == 0x046d && (product & 0xff00) == 0xc600) ||
+                          vendor == 0x256f);
+    if (!is3Dconnexion)
+        return 0;
+
+    QString realName(udev_device_get_property_value(hid, "HID_NAME"));
+    if (realName.isEmpty())
+        realName = QString("%1:%2").arg(vendor, 4, 16, QChar('0'))
+                                   .arg(product, 4, 16, QChar('0'));
+
+    qDebug() << "deviceAdded:" << realName << devPath;
+
+    QExtMouse3DDevice *device = new QExtMouse3DHidrawDevice
+        (devPath, realName, int(vendor), int(product));
+    connect(device, SIGNAL(descriptorChanged()),
+            this, SIGNAL(descriptorChanged()));
+    QString sysPath(udev_device_get_syspath(dev));
+    devices.append(new MouseInfo(sysPath, devPath, realName,
+                                 int(vendor), int(product), device));
+    return device;
+}
+
 void QExtMouse3DUdevDevice::deviceRemoved(const char *sysPath)
 {
     for (int index = 0; index < devices.size(); ++index) {
@@ -24,11 +24,21 @@ public:
 
     bool isAvailable() const;
     QStringList deviceNames() const;
+    QList<QExtMouse3DDeviceDescriptor> deviceDescriptors() const;
+    QList<QExtMouse3DDevice *> inputDevices() const;
 
     void setProvider(QExtMouse3DEventProvider *provider);
     void setWidget(QWidget *widget);
     void updateFilters(QExtMouse3DEventProvider::Filters filters);
     void updateSensitivity(qreal sensitivity);
+    void updateReadMode(QExtMouse3DEventProvider::ReadMode mode);
+    void updateAggregation(QExtMouse3DEventProvider::Aggregation aggregation);
+    void updateKeepOpen(bool keepOpen);
+    void updateAdaptiveCalibration(bool adaptive);
+    void updateReaderOptions(const QExtMouse3DReaderOptions &options);
+    void updateWakeupRate(int rate);
+    void updateMotionSink(QExtMouse3DMotionSink *sink);
+    void updateDelivery(QExtMouse3DEventProvider::Delivery delivery);
 
 private Q_SLOTS:
     void deviceAdded(const char *path);
@@ -41,20 +51,28 @@ private:
     {
     public:
         MouseInfo(const QString &sys, const QString &dev,
-                  const QString &rName, QExtMouse3DLinuxInputDevice *idev)
-            : sysPath(sys), devPath(dev), realName(rName), device(idev) {}
+                  const QString &rName, int vendor, int product,
+                  QExtMouse3DDevice *idev)
+            : sysPath(sys), devPath(dev), realName(rName)
+            , vendorId(vendor), productId(product), device(idev) {}
         ~MouseInfo() { delete device; }
 
         QString sysPath;
         QString devPath;
         QString realName;
-        QExtMouse3DLinuxInputDevice *device;
+        int vendorId;
+        int productId;
+        QExtMouse3DDevice *device;
     };
 
     struct udev *udev;
     struct udev_monitor *monitor;
     QSocketNotifier *notifier;
     QList<MouseInfo *> devices;
+    bool useHidraw;
+
+    QExtMouse3DDevice *createHidrawDevice
+        (struct udev_device *dev, const QString &devPath);
 
 };
 
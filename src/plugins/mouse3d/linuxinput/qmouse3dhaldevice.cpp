@@ -124,6 +124,26 @@ QStringList QExtMouse3DHalDevice::deviceNames() const
     return names;
 }
 
+QList<QExtMouse3DDeviceDescriptor> QExtMouse3DHalDevice::deviceDescriptors() const
+{
+    QList<QExtMouse3DDeviceDescriptor> descriptors;
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDeviceDescriptor descriptor =
+            devices[index]->device->deviceDescriptors().value(0);
+        descriptor.name = devices[index]->realName;
+        descriptors.append(descriptor);
+    }
+    return descriptors;
+}
+
+QList<QExtMouse3DDevice *> QExtMouse3DHalDevice::inputDevices() const
+{
+    QList<QExtMouse3DDevice *> inputs;
+    for (int index = 0; index < devices.size(); ++index)
+        inputs.append(devices[index]->device);
+    return inputs;
+}
+
 void QExtMouse3DHalDevice::setProvider(QExtMouse3DEventProvider *provider)
 {
     QExtMouse3DDevice::setProvider(provider);
@@ -152,6 +172,64 @@ void QExtMouse3DHalDevice::updateSensitivity(qreal sensitivity)
         devices[index]->device->updateSensitivity(sensitivity);
 }
 
+void QExtMouse3DHalDevice::updateReadMode(QExtMouse3DEventProvider::ReadMode mode)
+{
+    QExtMouse3DDevice::updateReadMode(mode);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateReadMode(mode);
+}
+
+void QExtMouse3DHalDevice::updateAggregation
+    (QExtMouse3DEventProvider::Aggregation aggregation)
+{
+    QExtMouse3DDevice::updateAggregation(aggregation);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateAggregation(aggregation);
+}
+
+void QExtMouse3DHalDevice::updateKeepOpen(bool keepOpen)
+{
+    QExtMouse3DDevice::updateKeepOpen(keepOpen);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateKeepOpen(keepOpen);
+}
+
+void QExtMouse3DHalDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    QExtMouse3DDevice::updateAdaptiveCalibration(adaptive);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateAdaptiveCalibration(adaptive);
+}
+
+void QExtMouse3DHalDevice::updateReaderOptions(const QExtMouse3DReaderOptions &options)
+{
+    QExtMouse3DDevice::updateReaderOptions(options);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateReaderOptions(options);
+}
+
+void QExtMouse3DHalDevice::updateWakeupRate(int rate)
+{
+    QExtMouse3DDevice::updateWakeupRate(rate);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateWakeupRate(rate);
+}
+
+void QExtMouse3DHalDevice::updateMotionSink(QExtMouse3DMotionSink *sink)
+{
+    QExtMouse3DDevice::updateMotionSink(sink);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateMotionSink(sink);
+}
+
+void QExtMouse3DHalDevice::updateDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    QExtMouse3DDevice::updateDelivery(delivery);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateDelivery(delivery);
+}
+
 void QExtMouse3DHalDevice::deviceAdded(const QString &path)
 {
     QDBusInterface *deviceIface = new QDBusInterface
@@ -230,6 +308,8 @@ void QExtMouse3DHalDevice::mouseAdded
     // Add an entry to the device list.
     QExtMouse3DLinuxInputDevice *device =
         new QExtMouse3DLinuxInputDevice(devName, realName);
+    connect(device, SIGNAL(descriptorChanged()),
+            this, SIGNAL(descriptorChanged()));
     MouseInfo *info = new MouseInfo(path, devName, realName, device);
     devices.append(info);
 
@@ -61,11 +61,21 @@ public:
 
     bool isAvailable() const;
     QStringList deviceNames() const;
+    QList<QExtMouse3DDeviceDescriptor> deviceDescriptors() const;
+    QList<QExtMouse3DDevice *> inputDevices() const;
 
     void setProvider(QExtMouse3DEventProvider *provider);
     void setWidget(QWidget *widget);
     void updateFilters(QExtMouse3DEventProvider::Filters filters);
     void updateSensitivity(qreal sensitivity);
+    void updateReadMode(QExtMouse3DEventProvider::ReadMode mode);
+    void updateAggregation(QExtMouse3DEventProvider::Aggregation aggregation);
+    void updateKeepOpen(bool keepOpen);
+    void updateAdaptiveCalibration(bool adaptive);
+    void updateReaderOptions(const QExtMouse3DReaderOptions &options);
+    void updateWakeupRate(int rate);
+    void updateMotionSink(QExtMouse3DMotionSink *sink);
+    void updateDelivery(QExtMouse3DEventProvider::Delivery delivery);
 
 private Q_SLOTS:
     void deviceAdded(const QString &path);
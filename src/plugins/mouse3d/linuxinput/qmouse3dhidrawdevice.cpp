@@ -0,0 +1,248 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dhidrawdevice.h"
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+QExtMouse3DHidrawDevice::QExtMouse3DHidrawDevice
+        (const QString &dName, const QString &realName, int vendorId,
+         int productId, QObject *parent)
+    : QExtMouse3DDevice(parent)
+    , isOpen(false)
+    , isPaused(false)
+    , keepOpen(false)
+    , adaptiveCalibration(true)
+    , devName(dName)
+    , name(realName)
+    , fd(-1)
+    , notifier(0)
+    , spaceNavigator(productId == QExtMouse3DHidParser::SpaceNavigator ||
+                     productId == QExtMouse3DHidParser::SpaceNavigatorNotebook)
+    , batched(false)
+    , prevWasFlat(false)
+{
+    parser.setProductId(productId);
+    setDeviceInfo(vendorId, productId, parser.buttonCount(),
+                  productId == QExtMouse3DHidParser::SpacePilotPRO);
+}
+
+QExtMouse3DHidrawDevice::~QExtMouse3DHidrawDevice()
+{
+    closeDevice();
+}
+
+bool QExtMouse3DHidrawDevice::isAvailable() const
+{
+    // Not used - QExtMouse3DUdevDevice reports the availability state.
+    return true;
+}
+
+QStringList QExtMouse3DHidrawDevice::deviceNames() const
+{
+    // QExtMouse3DUdevDevice reports the names of all devices.  This one
+    // is used to find the device in the provider's merge priority list.
+    return QStringList() << name;
+}
+
+void QExtMouse3DHidrawDevice::setWidget(QWidget *widget)
+{
+    QExtMouse3DDevice::setWidget(widget);
+    if (isOpen && !isPaused && !widget) {
+        // hidraw has no grab to release, so pausing only stops
+        // listening for reports until we are activated again.
+        if (keepOpen) {
+            notifier->setEnabled(false);
+            isPaused = true;
+        } else {
+            closeDevice();
+        }
+    } else if (widget) {
+        if (isPaused) {
+            // Reports that arrived while we were inactive are stale.
+            discardInput();
+            parser.reset();
+            prevWasFlat = false;
+            notifier->setEnabled(true);
+            isPaused = false;
+        } else if (!isOpen) {
+            openDevice();
+        }
+    }
+}
+
+void QExtMouse3DHidrawDevice::updateKeepOpen(bool keepOpen)
+{
+    this->keepOpen = keepOpen;
+    if (!keepOpen && isPaused)
+        closeDevice();
+}
+
+void QExtMouse3DHidrawDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    adaptiveCalibration = adaptive;
+    parser.calibration()->setAdaptive(adaptive);
+}
+
+void QExtMouse3DHidrawDevice::updateDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    batched = (delivery == QExtMouse3DEventProvider::BatchedDelivery);
+}
+
+void QExtMouse3DHidrawDevice::openDevice()
+{
+    fd = ::open(devName.toLatin1().constData(), O_RDONLY | O_NONBLOCK, 0);
+    if (fd < 0) {
+        qWarning("QExtMouse3DHidrawDevice: cannot open %s: %s",
+                 devName.toLatin1().constData(), strerror(errno));
+        return;
+    }
+    isOpen = true;
+
+    // The HID reports carry no dead zone information, and the axes
+    // of the 3Dconnexion devices report values of about -500 to 500.
+    // The dead zone and zero offset are then refined while the
+    // device is used, to suit this particular mouse, unless the
+    // provider asks for a fixed calibration.
+    QExtMouse3DCalibration *calibration = parser.calibration();
+    int ranges[6];
+    for (int axis = 0; axis < 6; ++axis) {
+        calibration->setAxis(axis, -500, 500, 16);
+        ranges[axis] = 500;
+    }
+    setAxisRanges(ranges);
+    calibration->setAdaptive(adaptiveCalibration);
+    parser.reset();
+    prevWasFlat = false;
+
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readyRead()));
+}
+
+void QExtMouse3DHidrawDevice::closeDevice()
+{
+    if (!isOpen)
+        return;
+    delete notifier;
+    notifier = 0;
+    ::close(fd);
+    fd = -1;
+    isOpen = false;
+    isPaused = false;
+}
+
+void QExtMouse3DHidrawDevice::discardInput()
+{
+    uchar report[MaxReportSize];
+    while (::read(fd, report, sizeof(report)) > 0)
+        ; // Nothing to do here.
+}
+
+void QExtMouse3DHidrawDevice::readyRead()
+{
+    // Every read() returns a single report.  Read until the queue is
+    // empty, but only deliver the last motion of a backlog unless the
+    // widget receives every motion in batches.
+    uchar report[MaxReportSize];
+    bool sawMotion = false;
+    for (;;) {
+        ssize_t len = ::read(fd, report, sizeof(report));
+        if (len <= 0) {
+            if (len < 0 && errno == ENODEV) {
+                // The device was unplugged; udev will remove us shortly.
+                notifier->setEnabled(false);
+            }
+            break;
+        }
+        int result = parser.parse(report, int(len));
+        if (result & QExtMouse3DHidParser::Buttons) {
+            // Deliver any motion that happened before the buttons changed.
+            if (sawMotion) {
+                deliverMotion(parser.values());
+                sawMotion = false;
+            }
+            quint32 changed = parser.changedButtons();
+            for (int button = 0; button < 32; ++button) {
+                quint32 mask = quint32(1) << button;
+                if ((changed & mask) == 0)
+                    continue;
+                int key = QExtMouse3DHidParser::keyCode
+                    (parser.buttonKey(button), spaceNavigator);
+                if (key != -1)
+                    deviceKey(key, (parser.buttons() & mask) != 0);
+            }
+        }
+        if (result & QExtMouse3DHidParser::Motion) {
+            if (batched)
+                deliverMotion(parser.values());
+            else
+                sawMotion = true;
+        }
+    }
+    if (sawMotion)
+        deliverMotion(parser.values());
+}
+
+void QExtMouse3DHidrawDevice::deliverMotion(const int *values)
+{
+    // Filter out multiple "flat" events so we don't get too much noise
+    // being delivered up to the widget layer.
+    bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
+                   values[3] == 0 && values[4] == 0 && values[5] == 0);
+    bool wasFlat = prevWasFlat;
+    prevWasFlat = isFlat;
+    if (wasFlat && isFlat)
+        return;
+
+    // hidraw does not timestamp the reports, so use the delivery time.
+    QExtMouse3DEvent mevent
+        ((short)(values[0]), (short)(values[1]), (short)(values[2]),
+         (short)(values[3]), (short)(values[4]), (short)(values[5]));
+    mevent.setTimestamp(QExtMouse3DEvent::currentTimestamp());
+    motion(&mevent);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DHIDRAWDEVICE_H
+#define QMOUSE3DHIDRAWDEVICE_H
+
+#include "qmouse3ddevice_p.h"
+#include "qmouse3dhidparser_p.h"
+#include <QtCore/qsocketnotifier.h>
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+// Reads the HID reports of a 3Dconnexion device from /dev/hidrawN and
+// decodes them with the same parser as the win32input plug-in.  Each
+// read() returns a whole report, and a button report carries the state
+// of every button at once.
+class QExtMouse3DHidrawDevice : public QExtMouse3DDevice
+{
+    Q_OBJECT
+public:
+    QExtMouse3DHidrawDevice
+        (const QString &devName, const QString &realName, int vendorId,
+         int productId, QObject *parent = 0);
+    ~QExtMouse3DHidrawDevice();
+
+    bool isAvailable() const;
+    QStringList deviceNames() const;
+
+    void setWidget(QWidget *widget);
+    void updateKeepOpen(bool keepOpen);
+    void updateAdaptiveCalibration(bool adaptive);
+    void updateDelivery(QExtMouse3DEventProvider::Delivery delivery);
+
+    // Largest input report that we expect from a 3D mouse.
+    enum { MaxReportSize = 64 };
+
+private Q_SLOTS:
+    void readyRead();
+
+private:
+    bool isOpen;
+    bool isPaused;
+    bool keepOpen;
+    bool adaptiveCalibration;
+    QString devName;
+    QString name;
+    int fd;
+    QSocketNotifier *notifier;
+    QExtMouse3DHidParser parser;
+    bool spaceNavigator;
+    bool batched;
+    bool prevWasFlat;
+
+    void openDevice();
+    void closeDevice();
+    void discardInput();
+    void deliverMotion(const int *values);
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
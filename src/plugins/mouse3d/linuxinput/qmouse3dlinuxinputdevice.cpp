@@ -40,45 +40,79 @@
 ****************************************************************************/
 
 #include "qmouse3dlinuxinputdevice.h"
+#include "qmouse3dlinuxinputreader.h"
+#ifdef QT_HAVE_IO_URING
+#include "qmouse3dlinuxinputuring.h"
+#endif
 #include "qmouse3dlcdscreen.h"
-#include "qglnamespace.h"
 #include <QtGui/qwidget.h>
 #include <QtGui/qicon.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 
 QT_BEGIN_NAMESPACE
 
+// Initial guess at the interval between reports from the device, in
+// microseconds, until it has been measured.  Gaps longer than the
+// maximum are idle periods and are not used for the measurement.
+#define QMOUSE3D_DEFAULT_REPORT_INTERVAL    8000
+#define QMOUSE3D_MAX_REPORT_INTERVAL        100000
+
 QExtMouse3DLinuxInputDevice::QExtMouse3DLinuxInputDevice
         (const QString &dName, const QString &realName, QObject *parent)
     : QExtMouse3DDevice(parent)
     , isOpen(false)
+    , isPaused(false)
+    , keepOpen(false)
+    , adaptiveCalibration(true)
     , devName(dName)
     , name(realName)
     , fd(-1)
     , notifier(0)
-    , flatMiddle(15)
-    , mscKey(-1)
-    , sawTranslate(false)
-    , sawRotate(false)
+    , wakeupRate(0)
+    , wakeupTimerActive(false)
+    , timerFd(-1)
+    , timerNotifier(0)
+    , wakeupTimer(0)
+    , readMode(QExtMouse3DEventProvider::GuiThreadRead)
+    , reader(0)
+    , uring(0)
+    , resyncs(0)
+    , monotonicClock(false)
+    , filters(QExtMouse3DEventProvider::Translations |
+              QExtMouse3DEventProvider::Rotations)
+    , sink(0)
+    , sinkProvider(0)
+    , sinkFilters(QExtMouse3DEventProvider::Translations |
+                  QExtMouse3DEventProvider::Rotations)
+    , sinkSensitivity(1.0f)
+    , sinkWasFlat(false)
+    , canMaskEvents(true)
+    , maskPending(false)
+    , aggregation(QExtMouse3DEventProvider::LastSample)
+    , batched(false)
+    , aggregateTime(0)
+    , aggregateCount(0)
+    , lastMotionTime(0)
+    , reportInterval(QMOUSE3D_DEFAULT_REPORT_INTERVAL)
     , prevWasFlat(false)
     , lcdScreen(0)
     , mouseType(QExtMouse3DLinuxInputDevice::MouseUnknown)
 {
-    memset(values, 0, sizeof(values));
-    memset(tempValues, 0, sizeof(tempValues));
 }
 
 QExtMouse3DLinuxInputDevice::~QExtMouse3DLinuxInputDevice()
 {
-    delete notifier;
-    if (fd != -1)
-        ::close(fd);
+    closeDevice();
 }
 
 bool QExtMouse3DLinuxInputDevice::isAvailable() const
@@ -90,27 +124,26 @@ bool QExtMouse3DLinuxInputDevice::isAvailable() const
 
 QStringList QExtMouse3DLinuxInputDevice::deviceNames() const
 {
-    // Not used - QExtMouse3DHalDevice reports the name.
-    return QStringList();
+    // QExtMouse3DHalDevice reports the names of all devices.  This one
+    // is used to find the device in the provider's merge priority list.
+    return QStringList() << name;
 }
 
 void QExtMouse3DLinuxInputDevice::setWidget(QWidget *widget)
 {
     QExtMouse3DDevice::setWidget(widget);
-    if (isOpen && !widget) {
-        // Close the device - we don't need it any more.
-        delete notifier;
-        ::close(fd);
-        notifier = 0;
-        fd = -1;
-        isOpen = false;
-    } else if (!isOpen && widget) {
-        // Attempt to open the device.
-        int fd = ::open(devName.toLatin1().constData(), O_RDONLY | O_NONBLOCK, 0);
-        if (fd >= 0) {
-            isOpen = true;
-            initDevice(fd);
-        }
+    if (isOpen && !isPaused && !widget) {
+        // We don't need the device any more.  Close it, or keep it
+        // open but paused if we are likely to be activated again soon.
+        if (keepOpen)
+            pauseDevice();
+        else
+            closeDevice();
+    } else if ((!isOpen || isPaused) && widget) {
+        if (isPaused)
+            resumeDevice();
+        else
+            openDevice();
     }
     if (lcdScreen) {
         lcdScreen->setActive(widget != 0);
@@ -132,6 +165,137 @@ void QExtMouse3DLinuxInputDevice::setWidget(QWidget *widget)
     }
 }
 
+void QExtMouse3DLinuxInputDevice::updateReadMode
+    (QExtMouse3DEventProvider::ReadMode mode)
+{
+    if (readMode == mode)
+        return;
+    readMode = mode;
+    if (isOpen && !isPaused) {
+        stopReading();
+        startReading();
+    }
+}
+
+void QExtMouse3DLinuxInputDevice::updateAggregation
+    (QExtMouse3DEventProvider::Aggregation aggregation)
+{
+    // Deliver anything that was combined under the old mode first.
+    flushMotion();
+    this->aggregation = aggregation;
+}
+
+// With BatchedDelivery the widget wants every sample, so nothing is
+// combined, whichever way the samples are read.
+void QExtMouse3DLinuxInputDevice::updateDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    flushMotion();
+    batched = (delivery == QExtMouse3DEventProvider::BatchedDelivery);
+}
+
+void QExtMouse3DLinuxInputDevice::updateKeepOpen(bool keepOpen)
+{
+    this->keepOpen = keepOpen;
+    if (!keepOpen && isPaused)
+        closeDevice();
+}
+
+void QExtMouse3DLinuxInputDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    if (adaptiveCalibration == adaptive)
+        return;
+    adaptiveCalibration = adaptive;
+
+    // The reader thread calibrates with the parser while it owns the fd.
+    bool restart = (isOpen && !isPaused && reader);
+    if (restart)
+        stopReading();
+    parser.calibration()->setAdaptive(adaptive);
+    if (restart)
+        startReading();
+}
+
+void QExtMouse3DLinuxInputDevice::updateReaderOptions
+    (const QExtMouse3DReaderOptions &options)
+{
+    readerOptions = options;
+    if (reader)
+        reader->setOptions(options);
+}
+
+void QExtMouse3DLinuxInputDevice::updateWakeupRate(int rate)
+{
+    wakeupRate = rate;
+    if (!wakeupTimerActive)
+        return;
+    if (rate > 0) {
+        // Carry on polling at the new rate.
+        startWakeupTimer();
+    } else {
+        stopWakeupTimer();
+        notifier->setEnabled(true);
+    }
+}
+
+void QExtMouse3DLinuxInputDevice::openDevice()
+{
+    int fd = ::open(devName.toLatin1().constData(), O_RDONLY | O_NONBLOCK, 0);
+    if (fd >= 0) {
+        isOpen = true;
+        initDevice(fd);
+        startReading();
+    }
+}
+
+void QExtMouse3DLinuxInputDevice::closeDevice()
+{
+    if (!isOpen)
+        return;
+    stopReading();
+    ::close(fd);
+    fd = -1;
+    isOpen = false;
+    isPaused = false;
+}
+
+// Stops delivering events without closing the device, so that the
+// grab, axis information, and model detection do not have to be
+// redone when the widget is activated again.
+void QExtMouse3DLinuxInputDevice::pauseDevice()
+{
+    stopReading();
+
+    // Let other applications see the device while we are inactive.
+    ::ioctl(fd, EVIOCGRAB, 0);
+    isPaused = true;
+}
+
+void QExtMouse3DLinuxInputDevice::resumeDevice()
+{
+    ::ioctl(fd, EVIOCGRAB, 1);
+
+    // Events that arrived while we were paused belong to
+    // other applications, so start again from a clean state.
+    discardInput();
+    parser.reset();
+    prevWasFlat = false;
+    memset(aggregateSums, 0, sizeof(aggregateSums));
+    aggregateTime = 0;
+    aggregateCount = 0;
+    lastMotionTime = 0;
+    isPaused = false;
+    startReading();
+}
+
+// Throws away everything that is waiting in the kernel's event queue.
+void QExtMouse3DLinuxInputDevice::discardInput()
+{
+    struct input_event events[QExtMouse3DLinuxInputParser::BatchSize];
+    while (::read(fd, events, sizeof(events)) == ssize_t(sizeof(events)))
+        ; // Nothing to do here.
+}
+
 void QExtMouse3DLinuxInputDevice::initDevice(int fd)
 {
     // Remember the fd for later.
@@ -141,36 +305,32 @@ void QExtMouse3DLinuxInputDevice::initDevice(int fd)
     // in the system (particularly the X server) don't get the events.
     ::ioctl(fd, EVIOCGRAB, 1);
 
-    // Determine the size of the "flat middle", where we clamp values to
-    // zero to filter out noise when the mouse is in the center position.
-    int flat = 0;
-    for (int index = 0; index < 6; ++index) {
-        struct input_absinfo info;
-        if (::ioctl(fd, EVIOCGABS(ABS_X + index), &info) >= 0) {
-            int range = qMax(qAbs(info.minimum), qAbs(info.maximum));
-            if (range < 10)
-                range = 500; // Zero protection.
-            if (info.flat != 0)
-                flat = qMax(flat, info.flat);
-            else
-                flat = qMax(flat, range / 10);
-        } else {
-            flat = qMax(flat, 16);
-        }
+    // Ask for event timestamps on the monotonic clock, which is the
+    // clock that QExtMouse3DEvent::currentTimestamp() uses.
+#ifdef EVIOCSCLOCKID
+    int clockId = CLOCK_MONOTONIC;
+    monotonicClock = (::ioctl(fd, EVIOCSCLOCKID, &clockId) >= 0);
+#else
+    monotonicClock = false;
+#endif
+
+    // Record the range of each axis and the size of its "flat middle",
+    // where we clamp values to zero to filter out noise when the mouse
+    // is in the center position.  The ranges are also used to scale
+    // the axes of QExtMouse3DNormalizedEvent.
+    parser.probeAxes(fd);
+    QExtMouse3DCalibration *calibration = parser.calibration();
+    int ranges[6];
+    for (int axis = 0; axis < 6; ++axis) {
+        ranges[axis] = qMax(-calibration->minimum(axis),
+                            calibration->maximum(axis));
     }
-    flatMiddle = flat;
+    setAxisRanges(ranges);
 
-    // Create a socket notifier to receive notification of new events.
-    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
-    connect(notifier, SIGNAL(activated(int)), this, SLOT(readyRead()));
-
-    // Clear the current mouse state.
-    memset(values, 0, sizeof(values));
-    memset(tempValues, 0, sizeof(tempValues));
-    mscKey = -1;
-    sawTranslate = false;
-    sawRotate = false;
-    prevWasFlat = false;
+    // Start from the values above, but follow the noise and the zero
+    // drift of this particular device while it is being used, unless
+    // the provider asks for a fixed calibration.
+    parser.calibration()->setAdaptive(adaptiveCalibration);
 
     // What type of 3D mouse do we have?
     mouseType = QExtMouse3DLinuxInputDevice::MouseUnknown;
@@ -182,226 +342,647 @@ void QExtMouse3DLinuxInputDevice::initDevice(int fd)
             mouseType |= QExtMouse3DLinuxInputDevice::MouseSpacePilotPRO;
     }
 
+    // Describe the device for QExtMouse3DEventProvider::deviceDescriptors().
+    struct input_id id;
+    memset(&id, 0, sizeof(id));
+    ::ioctl(fd, EVIOCGID, &id);
+    unsigned long keyBits[KEY_MAX / (8 * sizeof(unsigned long)) + 1];
+    memset(keyBits, 0, sizeof(keyBits));
+    int buttonCount = 0;
+    if (::ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) >= 0) {
+        for (uint index = 0; index < sizeof(keyBits) / sizeof(keyBits[0]); ++index) {
+            for (unsigned long bits = keyBits[index]; bits; bits &= bits - 1)
+                ++buttonCount;
+        }
+    }
+    setDeviceInfo(id.vendor, id.product, buttonCount,
+                  (mouseType & MouseSpacePilotPRO) != 0);
+
+    // Clear the current mouse state.
+    parser.reset();
+    parser.setDecodeKeys
+        ((mouseType & QExtMouse3DLinuxInputDevice::Mouse3Dconnexion) != 0);
+    prevWasFlat = false;
+    memset(aggregateSums, 0, sizeof(aggregateSums));
+    aggregateTime = 0;
+    aggregateCount = 0;
+    lastMotionTime = 0;
+
+    // Only ask the kernel for the events that we will use.
+    canMaskEvents = true;
+    maskPending = false;
+    updateEventMask();
+
     // Create a LCD screen handler if we have a SpacePilot PRO.
     if (!lcdScreen && (mouseType & MouseSpacePilotPRO) != 0)
         lcdScreen = new QExtMouse3DSpacePilotPROScreen(this);
 }
 
-static inline int clampRange(int value)
+void QExtMouse3DLinuxInputDevice::updateFilters
+    (QExtMouse3DEventProvider::Filters filters)
+{
+    QExtMouse3DEventProvider::Filters axes =
+        QExtMouse3DEventProvider::Translations |
+        QExtMouse3DEventProvider::Rotations;
+    bool changed = ((this->filters ^ filters) & axes) != 0;
+    this->filters = filters;
+    setSinkState(sink, filters, sinkSensitivity);
+    if (!changed || !isOpen || !canMaskEvents || maskPending)
+        return;
+
+    // A key on the device toggles the filters while we are delivering
+    // from readyRead(), drainPackets() or another of our slots, which
+    // must not have the reader or notifier torn down under them.
+    maskPending = true;
+    QMetaObject::invokeMethod(this, "applyEventMask", Qt::QueuedConnection);
+}
+
+// Applies the event mask for the filters that were set since the
+// last call to updateFilters().
+void QExtMouse3DLinuxInputDevice::applyEventMask()
+{
+    if (!maskPending)
+        return;
+    maskPending = false;
+    if (!isOpen)
+        return;
+
+    // The parser may be in use on another thread, so stop reading
+    // while the mask is changed.  Axes that were masked until now
+    // have not been tracked, so re-read the state of all axes and
+    // deliver it, as the mouse may already be deflected on them.
+    bool reading = (notifier != 0 || reader != 0 || uring != 0);
+    if (reading)
+        stopReading();
+    updateEventMask();
+    QExtMouse3DLinuxInputPacket packet;
+    packet.timestamp = QExtMouse3DEvent::currentTimestamp();
+    parser.resync(fd, &packet);
+    if (!isPaused) {
+        flushMotion();
+        deliverPacket(packet);
+    }
+    if (reading)
+        startReading();
+}
+
+void QExtMouse3DLinuxInputDevice::updateSensitivity(qreal sensitivity)
+{
+    QExtMouse3DDevice::updateSensitivity(sensitivity);
+    setSinkState(sink, sinkFilters, sensitivity);
+}
+
+// With a sink, motions decoded on the reader thread are filtered and
+// handed to it there instead of being queued for the GUI thread.
+// Keys are still queued.  Only used with ReaderThreadRead.
+void QExtMouse3DLinuxInputDevice::updateMotionSink(QExtMouse3DMotionSink *sink)
+{
+    QExtMouse3DDevice::updateMotionSink(sink);
+    setSinkState(sink, sinkFilters, sinkSensitivity);
+}
+
+// The sink state is read on the reader thread, which holds the
+// reader's lock while it calls readerReadyRead().  Taking the lock
+// here also means that the old sink is no longer in use on return.
+void QExtMouse3DLinuxInputDevice::setSinkState
+    (QExtMouse3DMotionSink *sink, QExtMouse3DEventProvider::Filters filters,
+     qreal sensitivity)
+{
+    if (reader)
+        reader->deviceLock()->lock();
+    if (this->sink != sink)
+        sinkWasFlat = false;
+    this->sink = sink;
+    sinkProvider = (sink ? provider() : 0);
+    sinkFilters = filters;
+    sinkSensitivity = sensitivity;
+    if (reader)
+        reader->deviceLock()->unlock();
+}
+
+static inline void setMaskBit(unsigned long *mask, int bit)
+{
+    const int bitsPerLong = int(sizeof(unsigned long)) * 8;
+    mask[bit / bitsPerLong] |= (1UL << (bit % bitsPerLong));
+}
+
+// Limits the events that the kernel queues for us to the ones that
+// the parser uses, so that the GUI or reader thread is not woken for
+// events that would be discarded.  The kernel drops SYN_REPORT events
+// that close a packet in which every event was masked.
+void QExtMouse3DLinuxInputDevice::updateEventMask()
+{
+#ifdef EVIOCSMASK
+    const int bitsPerLong = int(sizeof(unsigned long)) * 8;
+    unsigned long types[(EV_CNT + bitsPerLong - 1) / bitsPerLong];
+    unsigned long axes[(ABS_CNT + bitsPerLong - 1) / bitsPerLong];
+    unsigned long msc[(MSC_CNT + bitsPerLong - 1) / bitsPerLong];
+    memset(types, 0, sizeof(types));
+    memset(axes, 0, sizeof(axes));
+    memset(msc, 0, sizeof(msc));
+
+    setMaskBit(types, EV_SYN);
+    setMaskBit(types, EV_ABS);
+    setMaskBit(types, EV_REL);
+    if ((filters & QExtMouse3DEventProvider::Translations) != 0) {
+        setMaskBit(axes, ABS_X);
+        setMaskBit(axes, ABS_Y);
+        setMaskBit(axes, ABS_Z);
+    }
+    if ((filters & QExtMouse3DEventProvider::Rotations) != 0) {
+        setMaskBit(axes, ABS_RX);
+        setMaskBit(axes, ABS_RY);
+        setMaskBit(axes, ABS_RZ);
+    }
+    if (parser.decodeKeys()) {
+        setMaskBit(types, EV_MSC);
+        setMaskBit(types, EV_KEY);
+        setMaskBit(msc, MSC_SCAN);
+    }
+
+    // REL_X..REL_RZ have the same codes as ABS_X..ABS_RZ, so the
+    // same axis mask is used for both.  EV_KEY is left unrestricted
+    // because the parser accepts any key after a 3Dconnexion MSC_SCAN.
+    struct input_mask mask;
+    mask.type = 0;
+    mask.codes_size = sizeof(types);
+    mask.codes_ptr = quint64(quintptr(types));
+    if (::ioctl(fd, EVIOCSMASK, &mask) < 0) {
+        // Not supported before Linux 4.4; just take all events.
+        canMaskEvents = false;
+        return;
+    }
+    mask.type = EV_ABS;
+    mask.codes_size = sizeof(axes);
+    mask.codes_ptr = quint64(quintptr(axes));
+    ::ioctl(fd, EVIOCSMASK, &mask);
+    mask.type = EV_REL;
+    mask.codes_size = (REL_CNT + bitsPerLong - 1) / bitsPerLong * sizeof(unsigned long);
+    ::ioctl(fd, EVIOCSMASK, &mask);
+    mask.type = EV_MSC;
+    mask.codes_size = sizeof(msc);
+    mask.codes_ptr = quint64(quintptr(msc));
+    ::ioctl(fd, EVIOCSMASK, &mask);
+
+    // The kernel still tracks the masked axes, so keep resync() from
+    // reading them back.
+    parser.setMaskedAxes
+        ((filters & QExtMouse3DEventProvider::Translations) == 0,
+         (filters & QExtMouse3DEventProvider::Rotations) == 0);
+#else
+    canMaskEvents = false;
+#endif
+}
+
+void QExtMouse3DLinuxInputDevice::startReading()
+{
+    if (readMode == QExtMouse3DEventProvider::ReaderThreadRead) {
+        // Hand the fd over to the reader thread.  If the reader
+        // cannot be used, fall back to reading on the GUI thread.
+        if (!reader)
+            reader = QExtMouse3DLinuxInputReader::attach();
+        reader->setOptions(readerOptions);
+        stalledPackets.clear();
+        if (reader->addDevice(fd, this))
+            return;
+        QExtMouse3DLinuxInputReader::detach(reader);
+        reader = 0;
+    }
+#ifdef QT_HAVE_IO_URING
+    if (readMode == QExtMouse3DEventProvider::AsyncRead) {
+        // Queue asynchronous reads on the shared io_uring instance,
+        // or fall back to the socket notifier if it is not usable.
+        if (!uring)
+            uring = QExtMouse3DLinuxInputUring::attach();
+        if (uring->addDevice(fd, this))
+            return;
+        QExtMouse3DLinuxInputUring::detach(uring);
+        uring = 0;
+    }
+#endif
+    startNotifier();
+}
+
+void QExtMouse3DLinuxInputDevice::startNotifier()
+{
+    // Create a socket notifier to receive notification of new events.
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(readyRead()));
+}
+
+void QExtMouse3DLinuxInputDevice::stopReading()
 {
-    return qMin(qMax(value, -32768), 32767);
+    if (reader) {
+        reader->removeDevice(fd);
+        QExtMouse3DLinuxInputReader::detach(reader);
+        reader = 0;
+
+        // Deliver anything that the reader thread decoded before it let go.
+        drainPackets();
+    }
+#ifdef QT_HAVE_IO_URING
+    if (uring) {
+        uring->removeDevice(this);
+        QExtMouse3DLinuxInputUring::detach(uring);
+        uring = 0;
+    }
+#endif
+
+    // We may have been called from a slot that one of these objects
+    // invoked, when a delivery closes the device, so they are deleted
+    // once control is back in the event loop.  Disabling a notifier
+    // stops it from watching the fd, which can then be closed.
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = 0;
+    }
+    stopWakeupTimer();
+    if (timerNotifier) {
+        timerNotifier->setEnabled(false);
+        timerNotifier->deleteLater();
+        timerNotifier = 0;
+    }
+    if (timerFd >= 0) {
+        ::close(timerFd);
+        timerFd = -1;
+    }
+    if (wakeupTimer) {
+        wakeupTimer->deleteLater();
+        wakeupTimer = 0;
+    }
 }
 
 void QExtMouse3DLinuxInputDevice::readyRead()
 {
-    // Read as many events as we can in case the event queue has gotten
-    // backed up due to an application delay.  We only care about the
-    // most recent mouse position.
-    struct input_event event;
-    bool deliverMotion = false;
-    while (read(fd, &event, sizeof(event)) == int(sizeof(event))) {
-        if (event.type == EV_ABS || event.type == EV_REL) {
-            if (event.code <= ABS_RZ) {
-                tempValues[event.code] = clampRange(event.value);
-                if (event.code >= ABS_RX)
-                    sawRotate = true;
-                else
-                    sawTranslate = true;
-            }
-        } else if (event.type == EV_MSC && event.code == MSC_SCAN &&
-                   (mouseType & QExtMouse3DLinuxInputDevice::Mouse3Dconnexion) != 0) {
-            // If the value is between 0x90001 and 0x9001f then we
-            // assume that it is a 3Dconnexion special key and then
-            // wait for the EV_KEY to tell us the press/release state.
-            if (event.value >= 0x90001 && event.value <= 0x9001f)
-                mscKey = event.value;
-        } else if (event.type == EV_KEY && mscKey != -1) {
-            translateMscKey(mscKey, event.value != 0);
-            mscKey = -1;
-        } else if (event.type == EV_SYN) {
-            mscKey = -1;
-            if (sawTranslate) {
-                deliverMotion = true;
-                sawTranslate = false;
-                values[0] = tempValues[0];
-                values[1] = tempValues[1];
-                values[2] = tempValues[2];
-                tempValues[0] = tempValues[1] = tempValues[2] = 0;
-                if (qAbs(values[0]) < flatMiddle &&
-                        qAbs(values[1]) < flatMiddle &&
-                        qAbs(values[2]) < flatMiddle) {
-                    values[0] = 0;
-                    values[1] = 0;
-                    values[2] = 0;
-                }
-            }
-            if (sawRotate) {
-                deliverMotion = true;
-                sawRotate = false;
-                values[3] = tempValues[3];
-                values[4] = tempValues[4];
-                values[5] = tempValues[5];
-                tempValues[3] = tempValues[4] = tempValues[5] = 0;
-                if (qAbs(values[3]) < flatMiddle &&
-                        qAbs(values[4]) < flatMiddle &&
-                        qAbs(values[5]) < flatMiddle) {
-                    values[3] = 0;
-                    values[4] = 0;
-                    values[5] = 0;
-                }
-            }
+    readAvailable();
+
+    // When the wakeup rate is limited, the rest of the reports from
+    // this movement are picked up by the wakeup timer instead.  A
+    // delivery may have closed the device or switched read modes.
+    if (wakeupRate > 0 && notifier)
+        startWakeupTimer();
+}
+
+// Called by the wakeup timer while the mouse is moving.  Once a tick
+// finds nothing to read, the mouse is at rest and we go back to
+// waiting for the socket notifier, so that an idle mouse costs nothing.
+void QExtMouse3DLinuxInputDevice::wakeupTimeout()
+{
+    if (timerFd >= 0) {
+        quint64 expirations;
+        if (::read(timerFd, &expirations, sizeof(expirations)) < 0)
+            return;
+    }
+    if (!wakeupTimerActive)
+        return;
+
+    // A delivery may have closed the device, which stops the timer.
+    if (!readAvailable() && wakeupTimerActive) {
+        stopWakeupTimer();
+        notifier->setEnabled(true);
+    }
+}
+
+// Reads as many events as we can in case the event queue has gotten
+// backed up due to an application or timer delay.  The motions in the
+// backlog are combined into one according to the aggregation mode,
+// unless they are delivered in batches.
+// Events are fetched in batches, and a short batch tells us the queue
+// is empty without another read().  Returns the number of events read.
+int QExtMouse3DLinuxInputDevice::readAvailable()
+{
+    int total = 0;
+    int count;
+    do {
+        count = parser.readEvents(fd);
+        total += count;
+        parseBatch();
+    } while (count == QExtMouse3DLinuxInputParser::BatchSize);
+    flushMotion();
+    return total;
+}
+
+// Switches from the socket notifier to reading the device wakeupRate
+// times a second.  A timerfd is used where the kernel supports it,
+// as it keeps to the period more closely than a QTimer does.
+void QExtMouse3DLinuxInputDevice::startWakeupTimer()
+{
+    notifier->setEnabled(false);
+    int interval = qMax(1000000 / wakeupRate, 1);
+    if (timerFd < 0 && !wakeupTimer) {
+        timerFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timerFd >= 0) {
+            timerNotifier = new QSocketNotifier
+                (timerFd, QSocketNotifier::Read, this);
+            connect(timerNotifier, SIGNAL(activated(int)),
+                    this, SLOT(wakeupTimeout()));
+        } else {
+            wakeupTimer = new QTimer(this);
+            connect(wakeupTimer, SIGNAL(timeout()),
+                    this, SLOT(wakeupTimeout()));
         }
     }
-    if (deliverMotion) {
-        // Filter out multiple "flat" events so we don't get too much noise
-        // being delivered up to the widget layer.
-        bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
-                       values[3] == 0 && values[4] == 0 && values[5] == 0);
-        if (prevWasFlat && isFlat)
-            deliverMotion = false;
-        prevWasFlat = isFlat;
-    }
-    if (deliverMotion) {
-        // Deliver the motion event and ask QExtMouse3DDevice to filter it.
-        QExtMouse3DEvent mevent
-            ((short)(values[0]), (short)(values[1]), (short)(values[2]),
-             (short)(values[3]), (short)(values[4]), (short)(values[5]));
-        motion(&mevent);
-    }
-}
-
-// These are the keycodes that are reported by the 3Dconnection
-// SpacePilot PRO via the Linux input event interface as EV_MSC events.
-// The SpaceNavigator reports similar events, but only has 2 buttons,
-// which we map to the same behavior as SPKey_Pan and SPKey_Rotation.
-//
-// http://www.3dconnexion.com/products/spacepilot-pro.html
-// http://www.3dconnexion.com/products/spacenavigator.html
-enum SpacePilotKeys
-{
-    SPKey_Menu              = 0x90001,  // Left button on SpaceNavigator
-    SPKey_Fit               = 0x90002,  // Right button on SpaceNavigator
-
-    SPKey_TopView           = 0x90003,
-    SPKey_LeftView          = 0x90004,
-    SPKey_RightView         = 0x90005,
-    SPKey_FrontView         = 0x90006,
-    SPKey_BottomView        = 0x90007,
-    SPKey_BackView          = 0x90008,
-
-    SPKey_RotateCW90        = 0x90009,  // Rotate 90 degrees clockwise
-    SPKey_RotateCCW90       = 0x9000a,  // Rotate 90 degrees counter-clockwise
-
-    SPKey_ISO1              = 0x9000b,  // Isometric top/front/right view
-    SPKey_ISO2              = 0x9000c,  // Isometric top/back/left view
-
-    SPKey_F1                = 0x9000d,
-    SPKey_F2                = 0x9000e,
-    SPKey_F3                = 0x9000f,
-    SPKey_F4                = 0x90010,
-    SPKey_F5                = 0x90011,
-    SPKey_F6                = 0x90012,
-    SPKey_F7                = 0x90013,
-    SPKey_F8                = 0x90014,
-    SPKey_F9                = 0x90015,
-    SPKey_F10               = 0x90016,
-
-    SPKey_Escape            = 0x90017,
-    SPKey_Alt               = 0x90018,
-    SPKey_Shift             = 0x90019,
-    SPKey_Control           = 0x9001a,
-
-    SPKey_Rotation          = 0x9001b,  // Toggle rotation on/off
-    SPKey_Pan               = 0x9001c,  // Toggle pan on/off
-    SPKey_Dominant          = 0x9001d,  // Toggle main axis being dominant
-    SPKey_IncSensitivity    = 0x9001e,  // Increase sensitivity of movements
-    SPKey_DecSensitivity    = 0x9001f   // Decrease sensitivity of movements
-};
+    if (timerFd >= 0) {
+        struct itimerspec spec;
+        spec.it_interval.tv_sec = interval / 1000000;
+        spec.it_interval.tv_nsec = (interval % 1000000) * 1000;
+        spec.it_value = spec.it_interval;
+        ::timerfd_settime(timerFd, 0, &spec, 0);
+    } else {
+        wakeupTimer->start(qMax(interval / 1000, 1));
+    }
+    wakeupTimerActive = true;
+}
 
-void QExtMouse3DLinuxInputDevice::translateMscKey(int code, bool press)
+void QExtMouse3DLinuxInputDevice::stopWakeupTimer()
 {
-    int qtcode = -1;
-    switch (code) {
-    case SPKey_Menu:
-        // On the SpaceNavigator, map this key to "translation lock".
-        if (mouseType & QExtMouse3DLinuxInputDevice::MouseSpaceNavigator) {
-            if (press)
-                toggleFilter(QExtMouse3DEventProvider::Translations);
-            qtcode = QGL::Key_Translations;
+    if (!wakeupTimerActive)
+        return;
+    wakeupTimerActive = false;
+    if (timerFd >= 0) {
+        // Disarming also clears any expirations that were not read yet.
+        struct itimerspec spec;
+        memset(&spec, 0, sizeof(spec));
+        ::timerfd_settime(timerFd, 0, &spec, 0);
+    } else {
+        wakeupTimer->stop();
+    }
+}
+
+// Delivers the key packets in the parser's current batch right away
+// and adds the motion packets to the pending aggregate.
+void QExtMouse3DLinuxInputDevice::parseBatch()
+{
+    QExtMouse3DLinuxInputPacket packet;
+    while (parser.nextPacket(&packet)) {
+        if (packet.type == QExtMouse3DLinuxInputPacket::Resync)
+            resync(&packet);
+        if (packet.type == QExtMouse3DLinuxInputPacket::Motion) {
+            addMotion(packet, !batched);
         } else {
-            qtcode = Qt::Key_Menu;
+            // Keep key presses in order with respect to the motions,
+            // as a key may change the filters for the motions after it.
+            flushMotion();
+            deliverPacket(packet);
         }
-        break;
-
-    case SPKey_Fit:
-        // On the SpaceNavigator, map this key to "rotation lock".
-        if (mouseType & QExtMouse3DLinuxInputDevice::MouseSpaceNavigator) {
-            if (press)
-                toggleFilter(QExtMouse3DEventProvider::Rotations);
-            qtcode = QGL::Key_Rotations;
+    }
+    reportResyncs();
+}
+
+// Re-reads the state of the axes into \a packet after the kernel has
+// dropped events, on whichever thread is reading the device.
+void QExtMouse3DLinuxInputDevice::resync(QExtMouse3DLinuxInputPacket *packet)
+{
+    parser.resync(fd, packet);
+    pendingResyncs.ref();
+}
+
+// Adds the resyncs since the last call to the count that
+// deviceDescriptors() reports.  Called on the GUI thread.
+void QExtMouse3DLinuxInputDevice::reportResyncs()
+{
+    int count = pendingResyncs.fetchAndStoreOrdered(0);
+    if (count) {
+        resyncs += count;
+        setDroppedSyncs(resyncs);
+    }
+}
+
+// Called by QExtMouse3DLinuxInputUring when a read has completed into
+// the \a size bytes at \a data.  The buffer is reused for the next
+// read as soon as this function returns.
+void QExtMouse3DLinuxInputDevice::uringReadyRead(const void *data, int size)
+{
+    parser.setEvents(data, size);
+    parseBatch();
+    flushMotion();
+}
+
+// Called by QExtMouse3DLinuxInputUring when a read has failed with
+// \a error.  The ring has already let go of the device at this point.
+void QExtMouse3DLinuxInputDevice::uringFailed(int error)
+{
+#ifdef QT_HAVE_IO_URING
+    if (uring) {
+        QExtMouse3DLinuxInputUring::detach(uring);
+        uring = 0;
+    }
+#endif
+
+    // ENODEV means the device was unplugged, in which case HAL or udev
+    // will remove us shortly.  Otherwise keep going on the GUI thread.
+    if (error != ENODEV && isOpen && !notifier) {
+        qWarning("QExtMouse3DLinuxInputDevice: %s: asynchronous read failed: %s",
+                 name.toLocal8Bit().constData(), strerror(error));
+        startNotifier();
+    }
+}
+
+// Called on the reader thread when the device has input pending.
+// Every decoded packet is queued for the GUI thread, so nothing is
+// lost while the GUI thread is busy.  Returns true if some packets
+// could not be queued yet.
+bool QExtMouse3DLinuxInputDevice::readerReadyRead()
+{
+    // Queue older packets first so that the order is preserved.
+    readerRetry();
+
+    QExtMouse3DLinuxInputPacket packet;
+    int count;
+    do {
+        count = parser.readEvents(fd);
+        while (parser.nextPacket(&packet)) {
+            if (packet.type == QExtMouse3DLinuxInputPacket::Resync)
+                resync(&packet);
+            if (sink && packet.type == QExtMouse3DLinuxInputPacket::Motion)
+                sinkMotion(packet);
+            else
+                queuePacket(packet);
+        }
+    } while (count == QExtMouse3DLinuxInputParser::BatchSize);
+    wakeGuiThread();
+    return !stalledPackets.isEmpty();
+}
+
+// Called on the reader thread to queue packets that did not fit
+// into the ring earlier.  Returns true if some are still waiting.
+bool QExtMouse3DLinuxInputDevice::readerRetry()
+{
+    if (stalledPackets.isEmpty())
+        return false;
+    while (!stalledPackets.isEmpty() && packets.push(stalledPackets.first()))
+        stalledPackets.remove(0);
+    wakeGuiThread();
+    return !stalledPackets.isEmpty();
+}
+
+// Called on the reader thread to hand a decoded motion to the sink,
+// skipping repeated flat motions like deliverPacket() does.
+void QExtMouse3DLinuxInputDevice::sinkMotion
+    (const QExtMouse3DLinuxInputPacket &packet)
+{
+    const int *values = packet.values;
+    bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
+                   values[3] == 0 && values[4] == 0 && values[5] == 0);
+    bool wasFlat = sinkWasFlat;
+    sinkWasFlat = isFlat;
+    if (wasFlat && isFlat)
+        return;
+    short filtered[6];
+    filterMotion(sinkFilters, sinkSensitivity, values, filtered);
+    qint64 timestamp = (monotonicClock ? packet.timestamp
+                                       : QExtMouse3DEvent::currentTimestamp());
+    if (sinkProvider)
+        publishMotion(sinkProvider, filtered, timestamp);
+    sink->motion(filtered, timestamp);
+}
+
+void QExtMouse3DLinuxInputDevice::queuePacket
+    (const QExtMouse3DLinuxInputPacket &packet)
+{
+    if (stalledPackets.isEmpty() && packets.push(packet))
+        return;
+
+    // The ring is full.  Hold on to the packet until the GUI thread
+    // catches up, keeping only the newest of consecutive motions.
+    if (packet.type == QExtMouse3DLinuxInputPacket::Motion &&
+            !stalledPackets.isEmpty() &&
+            stalledPackets.last().type == QExtMouse3DLinuxInputPacket::Motion)
+        stalledPackets.last() = packet;
+    else
+        stalledPackets.append(packet);
+}
+
+void QExtMouse3DLinuxInputDevice::wakeGuiThread()
+{
+    // Only one drain request needs to be in flight at any one time.
+    // A resync is reported even if the motion it produced went to the
+    // motion sink.
+    bool pending = !packets.isEmpty() || int(pendingResyncs) != 0;
+    if (pending && drainPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "drainPackets", Qt::QueuedConnection);
+}
+
+// Delivers the packets that the reader thread has queued.  The reader
+// thread keeps every sample, so with LastSample each one is delivered
+// in order rather than only the last of them.
+void QExtMouse3DLinuxInputDevice::drainPackets()
+{
+    // Clear the flag before draining so that a packet queued after
+    // the last pop() below will request another drain.
+    drainPending.fetchAndStoreOrdered(0);
+    bool combine = !batched &&
+        aggregation != QExtMouse3DEventProvider::LastSample;
+    QExtMouse3DLinuxInputPacket packet;
+    while (packets.pop(&packet)) {
+        if (packet.type == QExtMouse3DLinuxInputPacket::Motion) {
+            addMotion(packet, combine);
         } else {
-            qtcode = QGL::Key_Fit;
+            // Keep key presses in order with respect to the motions.
+            flushMotion();
+            deliverPacket(packet);
         }
-        break;
-
-    case SPKey_TopView:         qtcode = QGL::Key_TopView; break;
-    case SPKey_LeftView:        qtcode = QGL::Key_LeftView; break;
-    case SPKey_RightView:       qtcode = QGL::Key_RightView; break;
-    case SPKey_FrontView:       qtcode = QGL::Key_FrontView; break;
-    case SPKey_BottomView:      qtcode = QGL::Key_BottomView; break;
-    case SPKey_BackView:        qtcode = QGL::Key_BackView; break;
-    case SPKey_RotateCW90:      qtcode = QGL::Key_RotateCW90; break;
-    case SPKey_RotateCCW90:     qtcode = QGL::Key_RotateCCW90; break;
-    case SPKey_ISO1:            qtcode = QGL::Key_ISO1; break;
-    case SPKey_ISO2:            qtcode = QGL::Key_ISO2; break;
-    case SPKey_F1:              qtcode = QGL::Key_Button1; break;
-    case SPKey_F2:              qtcode = QGL::Key_Button2; break;
-    case SPKey_F3:              qtcode = QGL::Key_Button3; break;
-    case SPKey_F4:              qtcode = QGL::Key_Button4; break;
-    case SPKey_F5:              qtcode = QGL::Key_Button5; break;
-    case SPKey_F6:              qtcode = QGL::Key_Button6; break;
-    case SPKey_F7:              qtcode = QGL::Key_Button7; break;
-    case SPKey_F8:              qtcode = QGL::Key_Button8; break;
-    case SPKey_F9:              qtcode = QGL::Key_Button9; break;
-    case SPKey_F10:             qtcode = QGL::Key_Button10; break;
-    case SPKey_Escape:          qtcode = Qt::Key_Escape; break;
-    case SPKey_Alt:             qtcode = Qt::Key_Alt; break;
-    case SPKey_Shift:           qtcode = Qt::Key_Shift; break;
-    case SPKey_Control:         qtcode = Qt::Key_Control; break;
-
-    case SPKey_Rotation:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::Rotations);
-        qtcode = QGL::Key_Rotations;
-        break;
-    case SPKey_Pan:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::Translations);
-        qtcode = QGL::Key_Translations;
-        break;
-    case SPKey_Dominant:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::DominantAxis);
-        qtcode = QGL::Key_DominantAxis;
-        break;
-    case SPKey_IncSensitivity:
-        if (press)
-            adjustSensitivity(2.0f);
-        qtcode = QGL::Key_IncreaseSensitivity;
-        break;
-    case SPKey_DecSensitivity:
-        if (press)
-            adjustSensitivity(0.5f);
-        qtcode = QGL::Key_DecreaseSensitivity;
-        break;
-    default: break;
-    }
-    if (qtcode != -1) {
-        if (press)
-            keyPress(qtcode);
-        else
-            keyRelease(qtcode);
     }
+    flushMotion();
+    reportResyncs();
+}
+
+// Adds a motion to the aggregate that will be delivered by the next
+// flushMotion(), or delivers it right away if \a combine is false.
+// Each motion is weighted by the time since the one before it, which
+// is the time for which the mouse was moving towards that position.
+void QExtMouse3DLinuxInputDevice::addMotion
+    (const QExtMouse3DLinuxInputPacket &packet, bool combine)
+{
+    qint64 interval = packet.timestamp - lastMotionTime;
+    if (lastMotionTime && interval > 0 &&
+            interval < QMOUSE3D_MAX_REPORT_INTERVAL)
+        reportInterval = (reportInterval * 7 + interval) / 8;
+    lastMotionTime = packet.timestamp;
+    if (!combine) {
+        flushMotion();
+        deliverPacket(packet);
+        return;
+    }
+
+    // The first motion after an idle period only counts for one report,
+    // as the mouse was at rest for most of the gap.
+    interval = qBound(qint64(0), interval, reportInterval);
+    for (int index = 0; index < 6; ++index)
+        aggregateSums[index] += packet.values[index] * interval;
+    aggregateTime += interval;
+    aggregateLast = packet;
+    ++aggregateCount;
+}
+
+static inline int clampRange(qint64 value)
+{
+    return int(qMin(qMax(value, qint64(-32768)), qint64(32767)));
+}
+
+// Delivers the motions that were added since the last call as a single
+// motion, combined according to the aggregation mode.
+void QExtMouse3DLinuxInputDevice::flushMotion()
+{
+    if (!aggregateCount)
+        return;
+    QExtMouse3DLinuxInputPacket packet = aggregateLast;
+    if (aggregation == QExtMouse3DEventProvider::TimeWeightedAverage) {
+        if (aggregateCount > 1 && aggregateTime > 0) {
+            for (int index = 0; index < 6; ++index)
+                packet.values[index] = int(aggregateSums[index] / aggregateTime);
+        }
+    } else if (aggregation == QExtMouse3DEventProvider::IntegratedDisplacement) {
+        for (int index = 0; index < 6; ++index) {
+            packet.values[index] =
+                clampRange(aggregateSums[index] / reportInterval);
+        }
+    }
+    memset(aggregateSums, 0, sizeof(aggregateSums));
+    aggregateTime = 0;
+    aggregateCount = 0;
+    deliverPacket(packet);
+}
+
+void QExtMouse3DLinuxInputDevice::deliverPacket
+    (const QExtMouse3DLinuxInputPacket &packet)
+{
+    if (packet.type != QExtMouse3DLinuxInputPacket::Motion) {
+        translateMscKey(packet.key,
+                        packet.type == QExtMouse3DLinuxInputPacket::KeyPress);
+        return;
+    }
+
+    // Filter out multiple "flat" events so we don't get too much noise
+    // being delivered up to the widget layer.
+    const int *values = packet.values;
+    bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
+                   values[3] == 0 && values[4] == 0 && values[5] == 0);
+    bool wasFlat = prevWasFlat;
+    prevWasFlat = isFlat;
+    if (wasFlat && isFlat)
+        return;
+
+    // Deliver the motion event and ask QExtMouse3DDevice to filter it.
+    // Older kernels stamp events with the wall clock, which cannot be
+    // compared with currentTimestamp(), so use the delivery time instead.
+    QExtMouse3DEvent mevent
+        ((short)(values[0]), (short)(values[1]), (short)(values[2]),
+         (short)(values[3]), (short)(values[4]), (short)(values[5]));
+    if (monotonicClock)
+        mevent.setTimestamp(packet.timestamp);
+    else
+        mevent.setTimestamp(QExtMouse3DEvent::currentTimestamp());
+    motion(&mevent);
+}
+
+void QExtMouse3DLinuxInputDevice::translateMscKey(int code, bool press)
+{
+    int qtcode = QExtMouse3DLinuxInputParser::keyCode
+        (code, (mouseType & QExtMouse3DLinuxInputDevice::MouseSpaceNavigator) != 0);
+    if (qtcode != -1)
+        deviceKey(qtcode, press);
 }
 
 QT_END_NAMESPACE
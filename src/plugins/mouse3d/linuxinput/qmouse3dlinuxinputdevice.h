@@ -43,8 +43,11 @@
 #define QMOUSE3DLINUXINPUTDEVICE_H
 
 #include "qmouse3ddevice_p.h"
+#include "qmouse3dlinuxinputparser.h"
+#include "qmouse3dringbuffer_p.h"
 #include <QtCore/qsocketnotifier.h>
 #include <QtCore/qtimer.h>
+#include <QtCore/qvector.h>
 #include <linux/input.h>
 
 QT_BEGIN_HEADER
@@ -52,6 +55,8 @@ QT_BEGIN_HEADER
 QT_BEGIN_NAMESPACE
 
 class QExtMouse3DLcdScreen;
+class QExtMouse3DLinuxInputReader;
+class QExtMouse3DLinuxInputUring;
 
 class QExtMouse3DLinuxInputDevice : public QExtMouse3DDevice
 {
@@ -65,22 +70,72 @@ public:
     QStringList deviceNames() const;
 
     void setWidget(QWidget *widget);
+    void updateFilters(QExtMouse3DEventProvider::Filters filters);
+    void updateSensitivity(qreal sensitivity);
+    void updateReadMode(QExtMouse3DEventProvider::ReadMode mode);
+    void updateAggregation(QExtMouse3DEventProvider::Aggregation aggregation);
+    void updateKeepOpen(bool keepOpen);
+    void updateAdaptiveCalibration(bool adaptive);
+    void updateReaderOptions(const QExtMouse3DReaderOptions &options);
+    void updateWakeupRate(int rate);
+    void updateMotionSink(QExtMouse3DMotionSink *sink);
+    void updateDelivery(QExtMouse3DEventProvider::Delivery delivery);
+
+    // Called on the reader thread by QExtMouse3DLinuxInputReader.
+    bool readerReadyRead();
+    bool readerRetry();
+
+    // Called on the GUI thread by QExtMouse3DLinuxInputUring.
+    void uringReadyRead(const void *data, int size);
+    void uringFailed(int error);
 
 private Q_SLOTS:
     void readyRead();
+    void wakeupTimeout();
+    void drainPackets();
+    void applyEventMask();
 
 private:
     bool isOpen;
+    bool isPaused;
+    bool keepOpen;
+    bool adaptiveCalibration;
     QString devName;
     QString name;
     int fd;
     QSocketNotifier *notifier;
-    int values[6];
-    int tempValues[6];
-    int flatMiddle;
-    int mscKey;
-    bool sawTranslate;
-    bool sawRotate;
+    int wakeupRate;
+    bool wakeupTimerActive;
+    int timerFd;
+    QSocketNotifier *timerNotifier;
+    QTimer *wakeupTimer;
+    QExtMouse3DEventProvider::ReadMode readMode;
+    QExtMouse3DLinuxInputReader *reader;
+    QExtMouse3DReaderOptions readerOptions;
+    QExtMouse3DLinuxInputUring *uring;
+    QExtMouse3DLinuxInputParser parser;
+    QExtMouse3DRingBuffer<QExtMouse3DLinuxInputPacket, 256> packets;
+    QVector<QExtMouse3DLinuxInputPacket> stalledPackets;
+    QAtomicInt drainPending;
+    QAtomicInt pendingResyncs;
+    quint64 resyncs;
+    bool monotonicClock;
+    QExtMouse3DEventProvider::Filters filters;
+    QExtMouse3DMotionSink *sink;
+    QExtMouse3DEventProvider *sinkProvider;
+    QExtMouse3DEventProvider::Filters sinkFilters;
+    qreal sinkSensitivity;
+    bool sinkWasFlat;
+    bool canMaskEvents;
+    bool maskPending;
+    QExtMouse3DEventProvider::Aggregation aggregation;
+    bool batched;
+    qint64 aggregateSums[6];
+    qint64 aggregateTime;
+    int aggregateCount;
+    QExtMouse3DLinuxInputPacket aggregateLast;
+    qint64 lastMotionTime;
+    qint64 reportInterval;
     bool prevWasFlat;
     QExtMouse3DLcdScreen *lcdScreen;
 
@@ -94,7 +149,31 @@ private:
     };
     int mouseType;
 
+    void openDevice();
+    void closeDevice();
+    void pauseDevice();
+    void resumeDevice();
     void initDevice(int fd);
+    void discardInput();
+    void updateEventMask();
+    void startReading();
+    void startNotifier();
+    void stopReading();
+    int readAvailable();
+    void startWakeupTimer();
+    void stopWakeupTimer();
+    void parseBatch();
+    void resync(QExtMouse3DLinuxInputPacket *packet);
+    void reportResyncs();
+    void addMotion(const QExtMouse3DLinuxInputPacket &packet, bool combine);
+    void flushMotion();
+    void queuePacket(const QExtMouse3DLinuxInputPacket &packet);
+    void wakeGuiThread();
+    void setSinkState(QExtMouse3DMotionSink *sink,
+                      QExtMouse3DEventProvider::Filters filters,
+                      qreal sensitivity);
+    void sinkMotion(const QExtMouse3DLinuxInputPacket &packet);
+    void deliverPacket(const QExtMouse3DLinuxInputPacket &packet);
     void translateMscKey(int code, bool press);
 };
 
@@ -0,0 +1,298 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dlinuxinputparser.h"
+#include "qmouse3dhidparser_p.h"
+#include <sys/ioctl.h>
+#include <string.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+QExtMouse3DLinuxInputParser::QExtMouse3DLinuxInputParser()
+    : m_batch(m_events)
+    , m_eventCount(0)
+    , m_eventIndex(0)
+    , m_readCalls(0)
+    , m_eventsRead(0)
+    , m_droppedSyncs(0)
+    , m_decodeKeys(false)
+    , m_maskTranslations(false)
+    , m_maskRotations(false)
+{
+    reset();
+}
+
+void QExtMouse3DLinuxInputParser::reset()
+{
+    memset(m_values, 0, sizeof(m_values));
+    memset(m_tempValues, 0, sizeof(m_tempValues));
+    m_mscKey = -1;
+    m_sawTranslate = false;
+    m_sawRotate = false;
+    m_dropping = false;
+    m_eventCount = 0;
+    m_eventIndex = 0;
+}
+
+static inline int clampRange(int value)
+{
+    return qMin(qMax(value, -32768), 32767);
+}
+
+// Tells the parser that the kernel's event mask hides the translation
+// or rotation axes, according to \a translations and \a rotations.
+// Masked axes read as centered, rather than keeping the value they
+// had when they were masked or picking one up from resync(), so that
+// the motions still go flat and the calibration does not learn from
+// values that the mouse is no longer reporting.
+void QExtMouse3DLinuxInputParser::setMaskedAxes(bool translations, bool rotations)
+{
+    m_maskTranslations = translations;
+    m_maskRotations = rotations;
+    for (int index = 0; index < 6; ++index) {
+        if (index < 3 ? translations : rotations)
+            m_values[index] = 0;
+    }
+}
+
+// Stores the three translation or rotation values starting at \a first,
+// after removing the dead zone around the center position.
+void QExtMouse3DLinuxInputParser::setValues(int first, const int *values)
+{
+    if (first == 0 ? m_maskTranslations : m_maskRotations) {
+        m_values[first] = m_values[first + 1] = m_values[first + 2] = 0;
+        return;
+    }
+    m_calibration.calibrate(first, values, m_values + first);
+}
+
+static inline qint64 eventTimestamp(const struct input_event &event)
+{
+    return qint64(event.time.tv_sec) * 1000000 + event.time.tv_usec;
+}
+
+// Processes a single evdev record.  Returns true and fills in
+// \a packet when the record completes a motion or a key press/release.
+bool QExtMouse3DLinuxInputParser::parse
+    (const struct input_event &event, QExtMouse3DLinuxInputPacket *packet)
+{
+    if (m_dropping) {
+        // The kernel dropped events because its buffer overflowed.
+        // Everything up to and including the next SYN_REPORT is stale.
+        if (event.type == EV_SYN && event.code == SYN_REPORT) {
+            m_dropping = false;
+            packet->type = QExtMouse3DLinuxInputPacket::Resync;
+            packet->timestamp = eventTimestamp(event);
+            return true;
+        }
+        return false;
+    }
+
+    if (event.type == EV_ABS || event.type == EV_REL) {
+        if (event.code <= ABS_RZ) {
+            m_tempValues[event.code] = clampRange(event.value);
+            if (event.code >= ABS_RX)
+                m_sawRotate = true;
+            else
+                m_sawTranslate = true;
+        }
+    } else if (event.type == EV_MSC && event.code == MSC_SCAN && m_decodeKeys) {
+        // If the value is between 0x90001 and 0x9001f then we
+        // assume that it is a 3Dconnexion special key and then
+        // wait for the EV_KEY to tell us the press/release state.
+        if (event.value >= 0x90001 && event.value <= 0x9001f)
+            m_mscKey = event.value;
+    } else if (event.type == EV_KEY && m_mscKey != -1) {
+        packet->type = (event.value != 0 ? QExtMouse3DLinuxInputPacket::KeyPress
+                                         : QExtMouse3DLinuxInputPacket::KeyRelease);
+        packet->key = m_mscKey;
+        packet->timestamp = eventTimestamp(event);
+        m_mscKey = -1;
+        return true;
+    } else if (event.type == EV_SYN && event.code == SYN_DROPPED) {
+        // Throw away the partial packet, which may mix old and new
+        // axis values, and wait for the end of the dropped stretch.
+        memset(m_tempValues, 0, sizeof(m_tempValues));
+        m_sawTranslate = false;
+        m_sawRotate = false;
+        m_mscKey = -1;
+        m_dropping = true;
+        ++m_droppedSyncs;
+    } else if (event.type == EV_SYN) {
+        bool sawMotion = false;
+        m_mscKey = -1;
+        if (m_sawTranslate) {
+            sawMotion = true;
+            m_sawTranslate = false;
+            setValues(0, m_tempValues);
+            m_tempValues[0] = m_tempValues[1] = m_tempValues[2] = 0;
+        }
+        if (m_sawRotate) {
+            sawMotion = true;
+            m_sawRotate = false;
+            setValues(3, m_tempValues + 3);
+            m_tempValues[3] = m_tempValues[4] = m_tempValues[5] = 0;
+        }
+        if (sawMotion) {
+            packet->type = QExtMouse3DLinuxInputPacket::Motion;
+            packet->timestamp = eventTimestamp(event);
+            memcpy(packet->values, m_values, sizeof(m_values));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Turns a Resync packet into a Motion packet that holds the current
+// absolute state of the axes, as reported by the kernel for \a fd.
+// The packet keeps the timestamp of the SYN_REPORT that ended the
+// dropped stretch.
+// Axes that cannot be queried, such as those of a device that reports
+// EV_REL events, are taken to be at rest.
+void QExtMouse3DLinuxInputParser::resync
+    (int fd, QExtMouse3DLinuxInputPacket *packet)
+{
+    int values[6];
+    for (int index = 0; index < 6; ++index) {
+        struct input_absinfo info;
+        if (::ioctl(fd, EVIOCGABS(ABS_X + index), &info) >= 0)
+            values[index] = clampRange(info.value);
+        else
+            values[index] = 0;
+    }
+    setValues(0, values);
+    setValues(3, values + 3);
+    packet->type = QExtMouse3DLinuxInputPacket::Motion;
+    memcpy(packet->values, m_values, sizeof(m_values));
+}
+
+// Sets up the calibration of each axis from the range and the size
+// of the "flat middle" that the kernel reports for \a fd.  Axes that
+// cannot be queried, such as those of a pipe or socket that is fed
+// with recorded events, get a range of -500 to 500 and a flat of 16.
+void QExtMouse3DLinuxInputParser::probeAxes(int fd)
+{
+    for (int index = 0; index < 6; ++index) {
+        struct input_absinfo info;
+        if (::ioctl(fd, EVIOCGABS(ABS_X + index), &info) >= 0) {
+            int minimum = info.minimum;
+            int maximum = info.maximum;
+            int range = qMax(qAbs(minimum), qAbs(maximum));
+            if (range < 10) {
+                // Zero protection.
+                range = 500;
+                minimum = -range;
+                maximum = range;
+            }
+            int flat = (info.flat != 0 ? info.flat : range / 10);
+            m_calibration.setAxis(index, minimum, maximum, flat);
+        } else {
+            m_calibration.setAxis(index, -500, 500, 16);
+        }
+    }
+}
+
+// Fetches up to BatchSize events from \a fd with a single read() call,
+// replacing any events that have not been consumed by nextPacket() yet.
+// Returns the number of events that were read.  A return value less
+// than BatchSize means that the kernel queue has been drained.
+int QExtMouse3DLinuxInputParser::readEvents(int fd)
+{
+    ssize_t len = ::read(fd, m_events, sizeof(m_events));
+    ++m_readCalls;
+    m_batch = m_events;
+    m_eventIndex = 0;
+    if (len < ssize_t(sizeof(struct input_event)))
+        m_eventCount = 0;
+    else
+        m_eventCount = int(len / sizeof(struct input_event));
+    m_eventsRead += m_eventCount;
+    return m_eventCount;
+}
+
+// Uses \a size bytes of events that were read into \a data by someone
+// else, such as the io_uring backend, instead of calling read() here.
+// The buffer must stay valid until nextPacket() has consumed it.
+// Returns the number of complete events in the buffer.
+int QExtMouse3DLinuxInputParser::setEvents(const void *data, int size)
+{
+    ++m_readCalls;
+    m_batch = reinterpret_cast<const struct input_event *>(data);
+    m_eventIndex = 0;
+    m_eventCount = size / int(sizeof(struct input_event));
+    m_eventsRead += m_eventCount;
+    return m_eventCount;
+}
+
+// Parses the events fetched by readEvents() or setEvents() until one of them completes
+// a packet.  Returns false once all of the fetched events are consumed.
+bool QExtMouse3DLinuxInputParser::nextPacket(QExtMouse3DLinuxInputPacket *packet)
+{
+    while (m_eventIndex < m_eventCount) {
+        if (parse(m_batch[m_eventIndex++], packet))
+            return true;
+    }
+    return false;
+}
+
+// The 3Dconnexion special keys are reported via the Linux input event
+// interface as EV_MSC events with scan codes 0x90001 to 0x9001f, whose
+// low bits are the QExtMouse3DHidParser::Key of the button.  The
+// SpaceNavigator reports similar events, but only has 2 buttons,
+// which we map to the same behavior as the pan and rotation keys.
+//
+// http://www.3dconnexion.com/products/spacepilot-pro.html
+// http://www.3dconnexion.com/products/spacenavigator.html
+
+// Maps the MSC_SCAN code of a special key to a Qt key code, or returns
+// -1 if the key is not known.  The two buttons of the SpaceNavigator
+// are used as translation and rotation locks when \a spaceNavigator
+// is true.
+int QExtMouse3DLinuxInputParser::keyCode(int scanCode, bool spaceNavigator)
+{
+    if (scanCode < 0x90001 || scanCode > 0x9001f)
+        return -1;
+    return QExtMouse3DHidParser::keyCode
+        (QExtMouse3DHidParser::Key(scanCode - 0x90000), spaceNavigator);
+}
+
+QT_END_NAMESPACE
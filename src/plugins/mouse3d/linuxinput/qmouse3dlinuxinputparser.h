@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DLINUXINPUTPARSER_H
+#define QMOUSE3DLINUXINPUTPARSER_H
+
+#include <QtCore/qglobal.h>
+#include "qmouse3dcalibration_p.h"
+#include <linux/input.h>
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+// Decoded result of one or more struct input_event records.
+struct QExtMouse3DLinuxInputPacket
+{
+    enum Type
+    {
+        Motion,
+        KeyPress,
+        KeyRelease,
+        Resync          // Events were dropped; call resync() on the fd.
+    };
+
+    int type;
+    int values[6];      // Axis values for Motion packets.
+    int key;            // MSC_SCAN code for KeyPress and KeyRelease.
+    qint64 timestamp;   // Kernel time of the event, in microseconds.
+};
+
+// Turns the raw evdev stream of a 3D mouse into motion and key packets.
+// The parser keeps no reference to the device, so it can be driven
+// from any thread that owns the fd.
+class QExtMouse3DLinuxInputParser
+{
+public:
+    QExtMouse3DLinuxInputParser();
+
+    // Maximum number of events fetched by a single read() call.
+    enum { BatchSize = 64 };
+
+    void reset();
+
+    QExtMouse3DCalibration *calibration() { return &m_calibration; }
+    void probeAxes(int fd);
+
+    bool decodeKeys() const { return m_decodeKeys; }
+    void setDecodeKeys(bool value) { m_decodeKeys = value; }
+
+    void setMaskedAxes(bool translations, bool rotations);
+
+    bool parse(const struct input_event &event,
+               QExtMouse3DLinuxInputPacket *packet);
+
+    int readEvents(int fd);
+    int setEvents(const void *data, int size);
+    bool nextPacket(QExtMouse3DLinuxInputPacket *packet);
+    void resync(int fd, QExtMouse3DLinuxInputPacket *packet);
+
+    static int keyCode(int scanCode, bool spaceNavigator);
+
+    quint64 readCalls() const { return m_readCalls; }
+    quint64 eventsRead() const { return m_eventsRead; }
+    quint64 droppedSyncs() const { return m_droppedSyncs; }
+
+private:
+    struct input_event m_events[BatchSize];
+    const struct input_event *m_batch;
+    int m_eventCount;
+    int m_eventIndex;
+    quint64 m_readCalls;
+    quint64 m_eventsRead;
+    quint64 m_droppedSyncs;
+    int m_values[6];
+    int m_tempValues[6];
+    QExtMouse3DCalibration m_calibration;
+    int m_mscKey;
+    bool m_sawTranslate;
+    bool m_sawRotate;
+    bool m_decodeKeys;
+    bool m_dropping;
+    bool m_maskTranslations;
+    bool m_maskRotations;
+
+    void setValues(int first, const int *values);
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
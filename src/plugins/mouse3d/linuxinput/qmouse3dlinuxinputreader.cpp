@@ -0,0 +1,356 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dlinuxinputreader.h"
+#include "qmouse3dlinuxinputdevice.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+// Milliseconds to wait before retrying delivery when the GUI thread
+// has let a device's packet ring fill up.
+#define QMOUSE3D_READER_RETRY_INTERVAL 5
+
+static QExtMouse3DLinuxInputReader *readerInstance = 0;
+
+QExtMouse3DLinuxInputReader::QExtMouse3DLinuxInputReader()
+    : QThread()
+    , epollFd(-1)
+    , wakeupFd(-1)
+    , optionsChanged(false)
+    , stopping(false)
+    , haveDefaultCpus(false)
+{
+    ref = 1;
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        qWarning("QExtMouse3DLinuxInputReader: epoll_create1 failed: %s",
+                 strerror(errno));
+        return;
+    }
+    wakeupFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeupFd < 0) {
+        qWarning("QExtMouse3DLinuxInputReader: eventfd failed: %s",
+                 strerror(errno));
+        ::close(epollFd);
+        epollFd = -1;
+        return;
+    }
+
+    // The wakeup fd is used to tell the thread to exit or to apply
+    // new options.
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = wakeupFd;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &event);
+    start();
+}
+
+QExtMouse3DLinuxInputReader::~QExtMouse3DLinuxInputReader()
+{
+    if (isRunning()) {
+        // Wake up epoll_wait() and wait for the thread to notice.
+        mutex.lock();
+        stopping = true;
+        mutex.unlock();
+        wakeup();
+        wait();
+    }
+    if (wakeupFd >= 0)
+        ::close(wakeupFd);
+    if (epollFd >= 0)
+        ::close(epollFd);
+}
+
+QExtMouse3DLinuxInputReader *QExtMouse3DLinuxInputReader::attach()
+{
+    if (!readerInstance) {
+        readerInstance = new QExtMouse3DLinuxInputReader();
+        return readerInstance;
+    }
+    readerInstance->ref.ref();
+    return readerInstance;
+}
+
+void QExtMouse3DLinuxInputReader::detach(QExtMouse3DLinuxInputReader *reader)
+{
+    if (!reader->ref.deref()) {
+        delete reader;
+        readerInstance = 0;
+    }
+}
+
+// Starts reading \a fd on the reader thread on behalf of \a device.
+// Returns false if the reader thread is not usable, in which case
+// the caller should continue to read the device on the GUI thread.
+bool QExtMouse3DLinuxInputReader::addDevice
+    (int fd, QExtMouse3DLinuxInputDevice *device)
+{
+    if (epollFd < 0)
+        return false;
+    QMutexLocker locker(&mutex);
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        qWarning("QExtMouse3DLinuxInputReader: cannot watch fd %d: %s",
+                 fd, strerror(errno));
+        return false;
+    }
+    devices.insert(fd, device);
+    return true;
+}
+
+// Stops reading \a fd.  On return the reader thread will not touch
+// the device that was registered for \a fd again.
+void QExtMouse3DLinuxInputReader::removeDevice(int fd)
+{
+    QMutexLocker locker(&mutex);
+    if (devices.remove(fd) > 0)
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, 0);
+}
+
+void QExtMouse3DLinuxInputReader::wakeup()
+{
+    quint64 value = 1;
+    if (::write(wakeupFd, &value, sizeof(value)) != sizeof(value))
+        qWarning("QExtMouse3DLinuxInputReader: could not wake up reader");
+}
+
+// Changes the scheduling policy, CPU affinity and busy-poll window of
+// the reader thread to \a options.  The thread applies them itself the
+// next time that it wakes up.
+void QExtMouse3DLinuxInputReader::setOptions
+    (const QExtMouse3DReaderOptions &options)
+{
+    QMutexLocker locker(&mutex);
+    if (this->options == options)
+        return;
+    this->options = options;
+    optionsChanged = true;
+    locker.unlock();
+    wakeup();
+}
+
+static const char *schedulingName(int policy)
+{
+    switch (policy) {
+    case SCHED_FIFO:    return "SCHED_FIFO";
+    case SCHED_RR:      return "SCHED_RR";
+    default: break;
+    }
+    return "SCHED_OTHER";
+}
+
+// Switches the calling thread to the requested scheduling policy.
+// Without CAP_SYS_NICE, the kernel refuses real-time priorities above
+// RLIMIT_RTPRIO, so the limit is included in the warning to tell the
+// user what needs to be raised.  The thread keeps running with normal
+// scheduling when the policy cannot be applied.
+void QExtMouse3DLinuxInputReader::applyScheduling
+    (const QExtMouse3DReaderOptions &options)
+{
+    int policy;
+    switch (options.scheduling) {
+    case QExtMouse3DEventProvider::FifoScheduling:
+        policy = SCHED_FIFO; break;
+    case QExtMouse3DEventProvider::RoundRobinScheduling:
+        policy = SCHED_RR; break;
+    default:
+        policy = SCHED_OTHER; break;
+    }
+
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if (policy != SCHED_OTHER) {
+        int minimum = ::sched_get_priority_min(policy);
+        int maximum = ::sched_get_priority_max(policy);
+        param.sched_priority = qBound(minimum, options.priority, maximum);
+        if (param.sched_priority != options.priority) {
+            qWarning("QExtMouse3DLinuxInputReader: %s priority %d is out "
+                     "of range, using %d", schedulingName(policy),
+                     options.priority, param.sched_priority);
+        }
+    }
+
+    int error = ::pthread_setschedparam(::pthread_self(), policy, &param);
+    if (error == 0)
+        return;
+    if (error == EPERM) {
+        struct rlimit limit;
+        if (::getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+                limit.rlim_cur != RLIM_INFINITY) {
+            qWarning("QExtMouse3DLinuxInputReader: not permitted to use %s "
+                     "priority %d, RLIMIT_RTPRIO is %lu",
+                     schedulingName(policy), param.sched_priority,
+                     (unsigned long)limit.rlim_cur);
+        } else {
+            qWarning("QExtMouse3DLinuxInputReader: not permitted to use %s "
+                     "priority %d", schedulingName(policy),
+                     param.sched_priority);
+        }
+    } else {
+        qWarning("QExtMouse3DLinuxInputReader: cannot use %s priority %d: %s",
+                 schedulingName(policy), param.sched_priority,
+                 strerror(error));
+    }
+    if (policy != SCHED_OTHER) {
+        param.sched_priority = 0;
+        ::pthread_setschedparam(::pthread_self(), SCHED_OTHER, &param);
+    }
+}
+
+// Restricts the calling thread to the requested processors, or
+// returns it to the processors that it started out with.
+void QExtMouse3DLinuxInputReader::applyCpus
+    (const QExtMouse3DReaderOptions &options)
+{
+    if (!haveDefaultCpus) {
+        CPU_ZERO(&defaultCpus);
+        haveDefaultCpus = (::pthread_getaffinity_np
+            (::pthread_self(), sizeof(defaultCpus), &defaultCpus) == 0);
+        if (!haveDefaultCpus && options.cpus.isEmpty())
+            return;
+    }
+
+    cpu_set_t cpus;
+    if (options.cpus.isEmpty()) {
+        cpus = defaultCpus;
+    } else {
+        CPU_ZERO(&cpus);
+        for (int index = 0; index < options.cpus.size(); ++index) {
+            int cpu = options.cpus.at(index);
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &cpus);
+            else
+                qWarning("QExtMouse3DLinuxInputReader: ignoring CPU %d", cpu);
+        }
+    }
+
+    int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0) {
+        qWarning("QExtMouse3DLinuxInputReader: cannot set CPU affinity: %s",
+                 strerror(error));
+    }
+}
+
+void QExtMouse3DLinuxInputReader::run()
+{
+    struct epoll_event events[16];
+    int timeout = -1;
+    int busyPollTime = 0;
+    qint64 pollUntil = 0;
+    for (;;) {
+        // Keep polling without sleeping for a while after input
+        // arrived, so that the next report is picked up at once.
+        int wait = timeout;
+        if (pollUntil != 0) {
+            if (QExtMouse3DEvent::currentTimestamp() < pollUntil)
+                wait = 0;
+            else
+                pollUntil = 0;
+        }
+
+        int count = ::epoll_wait(epollFd, events, 16, wait);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            qWarning("QExtMouse3DLinuxInputReader: epoll_wait failed: %s",
+                     strerror(errno));
+            break;
+        }
+
+        // The mutex keeps removeDevice() from returning while we are
+        // still decoding input for the device being removed.  A device
+        // may already be gone by the time we get here, so events are
+        // looked up by fd rather than trusting a stored pointer.
+        QMutexLocker locker(&mutex);
+
+        // Input that arrived together with the wakeup for new options
+        // is already read under the new options.
+        if (optionsChanged) {
+            optionsChanged = false;
+            applyScheduling(options);
+            applyCpus(options);
+            busyPollTime = options.busyPollTime;
+            if (busyPollTime == 0)
+                pollUntil = 0;
+        }
+        bool sawInput = false;
+        for (int index = 0; index < count; ++index) {
+            int fd = events[index].data.fd;
+            if (fd == wakeupFd) {
+                quint64 value;
+                ssize_t len = ::read(wakeupFd, &value, sizeof(value));
+                Q_UNUSED(len);
+                continue;
+            }
+            QExtMouse3DLinuxInputDevice *device = devices.value(fd, 0);
+            if (device) {
+                device->readerReadyRead();
+                sawInput = true;
+            }
+        }
+        if (stopping)
+            break;
+        if (sawInput && busyPollTime > 0)
+            pollUntil = QExtMouse3DEvent::currentTimestamp() + busyPollTime;
+
+        // Poll again soon if a device still has packets that did
+        // not fit into its ring because the GUI thread is behind.
+        timeout = -1;
+        QHash<int, QExtMouse3DLinuxInputDevice *>::ConstIterator it;
+        for (it = devices.constBegin(); it != devices.constEnd(); ++it) {
+            if ((*it)->readerRetry())
+                timeout = QMOUSE3D_READER_RETRY_INTERVAL;
+        }
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DLINUXINPUTREADER_H
+#define QMOUSE3DLINUXINPUTREADER_H
+
+#include <QtCore/qthread.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qatomic.h>
+#include "qmouse3ddevice_p.h"
+#include <sched.h>
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+class QExtMouse3DLinuxInputDevice;
+
+// Background thread that waits on every open evdev device with a single
+// epoll set and decodes the input as soon as it arrives.  The decoded
+// packets are handed to the GUI thread by the devices themselves.
+// The thread's scheduling policy, CPU affinity and busy-poll window
+// come from QExtMouse3DEventProvider via setOptions().
+class QExtMouse3DLinuxInputReader : public QThread
+{
+    Q_OBJECT
+public:
+    static QExtMouse3DLinuxInputReader *attach();
+    static void detach(QExtMouse3DLinuxInputReader *reader);
+
+    bool addDevice(int fd, QExtMouse3DLinuxInputDevice *device);
+    void removeDevice(int fd);
+
+    void setOptions(const QExtMouse3DReaderOptions &options);
+
+    // Held while the reader thread is calling into a device.
+    QMutex *deviceLock() { return &mutex; }
+
+protected:
+    void run();
+
+private:
+    QExtMouse3DLinuxInputReader();
+    ~QExtMouse3DLinuxInputReader();
+
+    QBasicAtomicInt ref;
+    int epollFd;
+    int wakeupFd;
+    QMutex mutex;
+    QHash<int, QExtMouse3DLinuxInputDevice *> devices;
+    QExtMouse3DReaderOptions options;
+    bool optionsChanged;
+    bool stopping;
+    cpu_set_t defaultCpus;
+    bool haveDefaultCpus;
+
+    void wakeup();
+    void applyScheduling(const QExtMouse3DReaderOptions &options);
+    void applyCpus(const QExtMouse3DReaderOptions &options);
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
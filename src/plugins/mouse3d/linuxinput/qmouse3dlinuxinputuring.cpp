@@ -0,0 +1,406 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dlinuxinputuring.h"
+#include "qmouse3dlinuxinputdevice.h"
+#include "qmouse3dlinuxinputparser.h"
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+// Size of the registered buffer that each device reads into.
+#define QMOUSE3D_URING_SLOT_SIZE \
+    (QExtMouse3DLinuxInputParser::BatchSize * sizeof(struct input_event))
+
+static QExtMouse3DLinuxInputUring *uringInstance = 0;
+
+static inline int uringSetup(unsigned entries, struct io_uring_params *params)
+{
+    return int(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static inline int uringEnter(int fd, unsigned toSubmit)
+{
+    return int(::syscall(__NR_io_uring_enter, fd, toSubmit, 0, 0, 0, 0));
+}
+
+static inline int uringRegister
+    (int fd, unsigned opcode, const void *arg, unsigned count)
+{
+    return int(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+QExtMouse3DLinuxInputUring::QExtMouse3DLinuxInputUring()
+    : QObject()
+    , ringFd(-1)
+    , eventFd(-1)
+    , notifier(0)
+    , sqRing(MAP_FAILED)
+    , sqRingSize(0)
+    , cqRing(MAP_FAILED)
+    , cqRingSize(0)
+    , sqes(0)
+    , sqesSize(0)
+    , sqHead(0)
+    , sqTail(0)
+    , sqMask(0)
+    , sqArray(0)
+    , sqEntries(0)
+    , cqHead(0)
+    , cqTail(0)
+    , cqMask(0)
+    , cqes(0)
+    , toSubmit(0)
+    , buffers(0)
+    , buffersSize(0)
+{
+    ref = 1;
+    memset(deviceSlots, 0, sizeof(deviceSlots));
+    if (!setup())
+        teardown();
+}
+
+QExtMouse3DLinuxInputUring::~QExtMouse3DLinuxInputUring()
+{
+    teardown();
+}
+
+QExtMouse3DLinuxInputUring *QExtMouse3DLinuxInputUring::attach()
+{
+    if (!uringInstance) {
+        uringInstance = new QExtMouse3DLinuxInputUring();
+        return uringInstance;
+    }
+    uringInstance->ref.ref();
+    return uringInstance;
+}
+
+void QExtMouse3DLinuxInputUring::detach(QExtMouse3DLinuxInputUring *uring)
+{
+    if (!uring->ref.deref()) {
+        // The last device may let go from inside completionsReady(),
+        // so the ring cannot be destroyed right away.
+        uring->deleteLater();
+        uringInstance = 0;
+    }
+}
+
+bool QExtMouse3DLinuxInputUring::setup()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = uringSetup(RingEntries, &params);
+    if (ringFd < 0) {
+        // Most likely ENOSYS on kernels without io_uring, or EPERM
+        // if io_uring has been disabled by the administrator.
+        qWarning("QExtMouse3DLinuxInputUring: io_uring is not available: %s",
+                 strerror(errno));
+        return false;
+    }
+
+    // Map the submission and completion rings and the SQE array.
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes +
+                 params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = qMax(sqRingSize, cqRingSize);
+        cqRingSize = 0;
+    }
+    sqRing = ::mmap(0, sqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED)
+        return false;
+    char *cq = reinterpret_cast<char *>(sqRing);
+    if (cqRingSize) {
+        cqRing = ::mmap(0, cqRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+        cq = reinterpret_cast<char *>(cqRing);
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqeMap = ::mmap(0, sqesSize, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeMap == MAP_FAILED)
+        return false;
+    sqes = reinterpret_cast<struct io_uring_sqe *>(sqeMap);
+
+    char *sq = reinterpret_cast<char *>(sqRing);
+    sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    // Register one read buffer per device slot so that the kernel
+    // does not have to map the buffers again on every read.
+    buffersSize = MaxDevices * QMOUSE3D_URING_SLOT_SIZE;
+    void *bufferMap = ::mmap(0, buffersSize, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufferMap == MAP_FAILED)
+        return false;
+    buffers = reinterpret_cast<char *>(bufferMap);
+    struct iovec iov[MaxDevices];
+    for (int slot = 0; slot < MaxDevices; ++slot) {
+        iov[slot].iov_base = buffers + slot * QMOUSE3D_URING_SLOT_SIZE;
+        iov[slot].iov_len = QMOUSE3D_URING_SLOT_SIZE;
+    }
+    if (uringRegister(ringFd, IORING_REGISTER_BUFFERS, iov, MaxDevices) < 0) {
+        qWarning("QExtMouse3DLinuxInputUring: cannot register buffers: %s",
+                 strerror(errno));
+        return false;
+    }
+
+    // All completions are signalled through a single eventfd.
+    eventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0)
+        return false;
+    if (uringRegister(ringFd, IORING_REGISTER_EVENTFD, &eventFd, 1) < 0)
+        return false;
+    notifier = new QSocketNotifier(eventFd, QSocketNotifier::Read, this);
+    connect(notifier, SIGNAL(activated(int)), this, SLOT(completionsReady()));
+    return true;
+}
+
+void QExtMouse3DLinuxInputUring::teardown()
+{
+    delete notifier;
+    notifier = 0;
+
+    // Give back any devices that are still attached with the flags
+    // that they had before addDevice(), as removeDevice() does.
+    for (int slot = 0; slot < MaxDevices; ++slot) {
+        DeviceSlot &entry = deviceSlots[slot];
+        if (entry.device)
+            ::fcntl(entry.fd, F_SETFL, entry.fdFlags);
+        entry.device = 0;
+        entry.pending = false;
+    }
+
+    // Closing the ring cancels any reads that are still in flight.
+    if (ringFd >= 0)
+        ::close(ringFd);
+    ringFd = -1;
+    if (eventFd >= 0)
+        ::close(eventFd);
+    eventFd = -1;
+    if (sqes)
+        ::munmap(sqes, sqesSize);
+    sqes = 0;
+    if (cqRing != MAP_FAILED)
+        ::munmap(cqRing, cqRingSize);
+    cqRing = MAP_FAILED;
+    if (sqRing != MAP_FAILED)
+        ::munmap(sqRing, sqRingSize);
+    sqRing = MAP_FAILED;
+    if (buffers)
+        ::munmap(buffers, buffersSize);
+    buffers = 0;
+}
+
+// Starts reading \a fd through the ring on behalf of \a device.
+// Returns false if io_uring is not usable or all slots are taken,
+// in which case the caller should fall back to a QSocketNotifier.
+bool QExtMouse3DLinuxInputUring::addDevice
+    (int fd, QExtMouse3DLinuxInputDevice *device)
+{
+    if (!notifier)
+        return false;
+    for (int slot = 0; slot < MaxDevices; ++slot) {
+        DeviceSlot &entry = deviceSlots[slot];
+        if (entry.device || entry.pending)
+            continue;
+
+        // io_uring fails reads on O_NONBLOCK files with EAGAIN instead
+        // of waiting for input, so the fd must block while it is ours.
+        entry.fdFlags = ::fcntl(fd, F_GETFL);
+        ::fcntl(fd, F_SETFL, entry.fdFlags & ~O_NONBLOCK);
+        entry.device = device;
+        entry.fd = fd;
+        queueRead(slot);
+        submit();
+        return true;
+    }
+    return false;
+}
+
+// Stops reading for \a device.  The device will not be called again.
+void QExtMouse3DLinuxInputUring::removeDevice(QExtMouse3DLinuxInputDevice *device)
+{
+    for (int slot = 0; slot < MaxDevices; ++slot) {
+        DeviceSlot &entry = deviceSlots[slot];
+        if (entry.device != device)
+            continue;
+        entry.device = 0;
+        ::fcntl(entry.fd, F_SETFL, entry.fdFlags);
+        if (entry.pending) {
+            // The slot stays busy until the cancelled read completes.
+            queueCancel(slot);
+            submit();
+        }
+    }
+}
+
+void QExtMouse3DLinuxInputUring::completionsReady()
+{
+    quint64 count;
+    if (::read(eventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        qWarning("QExtMouse3DLinuxInputUring: eventfd read failed");
+
+    // Take the whole batch off the completion ring before delivering
+    // anything, as delivery may re-enter the event loop.
+    struct io_uring_cqe batch[RingEntries];
+    int batchSize = 0;
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail && batchSize < RingEntries)
+        batch[batchSize++] = cqes[head++ & *cqMask];
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    if (head != tail) {
+        // More left over: make sure that we are called again.
+        count = 1;
+        if (::write(eventFd, &count, sizeof(count)) < 0)
+            qWarning("QExtMouse3DLinuxInputUring: eventfd write failed");
+    }
+
+    for (int index = 0; index < batchSize; ++index) {
+        quint64 data = batch[index].user_data;
+        int res = batch[index].res;
+        if (data & CancelTag)
+            continue;   // Result of a cancel request.
+        DeviceSlot &entry = deviceSlots[data];
+        entry.pending = false;
+        if (!entry.device)
+            continue;   // Device was removed while the read was pending.
+        if (res > 0) {
+            entry.device->uringReadyRead
+                (buffers + data * QMOUSE3D_URING_SLOT_SIZE, res);
+        }
+        if (!entry.device || entry.pending)
+            continue;   // Device was removed or replaced during delivery.
+        if (res >= 0 || res == -EINTR || res == -EAGAIN) {
+            queueRead(int(data));
+        } else {
+            // Typically ENODEV when the mouse has been unplugged.
+            // Let the device fall back to the notifier path.
+            QExtMouse3DLinuxInputDevice *device = entry.device;
+            removeDevice(device);
+            device->uringFailed(-res);
+        }
+    }
+    submit();
+}
+
+struct io_uring_sqe *QExtMouse3DLinuxInputUring::nextSqe()
+{
+    unsigned tail = *sqTail;
+    if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+        // Submission ring is full: flush what we have queued so far.
+        submit();
+        if (tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+            return 0;
+    }
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    return sqe;
+}
+
+void QExtMouse3DLinuxInputUring::commitSqe()
+{
+    __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+    ++toSubmit;
+}
+
+void QExtMouse3DLinuxInputUring::queueRead(int slot)
+{
+    struct io_uring_sqe *sqe = nextSqe();
+    if (!sqe)
+        return;
+    DeviceSlot &entry = deviceSlots[slot];
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->fd = entry.fd;
+    sqe->addr = quint64(quintptr(buffers + slot * QMOUSE3D_URING_SLOT_SIZE));
+    sqe->len = QMOUSE3D_URING_SLOT_SIZE;
+    sqe->buf_index = slot;
+    sqe->user_data = quint64(slot);
+    commitSqe();
+    entry.pending = true;
+}
+
+void QExtMouse3DLinuxInputUring::queueCancel(int slot)
+{
+    struct io_uring_sqe *sqe = nextSqe();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = quint64(slot);
+    sqe->user_data = quint64(slot | CancelTag);
+    commitSqe();
+}
+
+void QExtMouse3DLinuxInputUring::submit()
+{
+    if (!toSubmit)
+        return;
+    int result = uringEnter(ringFd, toSubmit);
+    if (result >= 0)
+        toSubmit -= qMin(unsigned(result), toSubmit);
+    else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        qWarning("QExtMouse3DLinuxInputUring: io_uring_enter failed: %s",
+                 strerror(errno));
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,133 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DLINUXINPUTURING_H
+#define QMOUSE3DLINUXINPUTURING_H
+
+#include <QtCore/qobject.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qsocketnotifier.h>
+#include <sys/types.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+class QExtMouse3DLinuxInputDevice;
+
+// Reads every open evdev device through a single io_uring instance.
+// Each device gets a slot in a pool of registered buffers, and the GUI
+// thread is woken through one eventfd for any number of completions.
+class QExtMouse3DLinuxInputUring : public QObject
+{
+    Q_OBJECT
+public:
+    static QExtMouse3DLinuxInputUring *attach();
+    static void detach(QExtMouse3DLinuxInputUring *uring);
+
+    bool addDevice(int fd, QExtMouse3DLinuxInputDevice *device);
+    void removeDevice(QExtMouse3DLinuxInputDevice *device);
+
+private Q_SLOTS:
+    void completionsReady();
+
+private:
+    QExtMouse3DLinuxInputUring();
+    ~QExtMouse3DLinuxInputUring();
+
+    enum
+    {
+        MaxDevices      = 8,
+        RingEntries     = 32,
+        CancelTag       = 0x100
+    };
+
+    struct DeviceSlot
+    {
+        QExtMouse3DLinuxInputDevice *device;
+        int fd;
+        int fdFlags;
+        bool pending;
+    };
+
+    QBasicAtomicInt ref;
+    int ringFd;
+    int eventFd;
+    QSocketNotifier *notifier;
+
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned sqEntries;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+    unsigned toSubmit;
+
+    char *buffers;
+    size_t buffersSize;
+    DeviceSlot deviceSlots[MaxDevices];
+
+    bool setup();
+    void teardown();
+    struct io_uring_sqe *nextSqe();
+    void commitSqe();
+    void queueRead(int slot);
+    void queueCancel(int slot);
+    void submit();
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
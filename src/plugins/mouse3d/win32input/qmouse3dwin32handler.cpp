@@ -104,6 +104,26 @@ QStringList QExtMouse3DWin32Handler::deviceNames() const
     return names;
 }
 
+QList<QExtMouse3DDeviceDescriptor> QExtMouse3DWin32Handler::deviceDescriptors() const
+{
+    QList<QExtMouse3DDeviceDescriptor> descriptors;
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDeviceDescriptor descriptor =
+            devices[index]->device->deviceDescriptors().value(0);
+        descriptor.name = devices[index]->devName;
+        descriptors.append(descriptor);
+    }
+    return descriptors;
+}
+
+QList<QExtMouse3DDevice *> QExtMouse3DWin32Handler::inputDevices() const
+{
+    QList<QExtMouse3DDevice *> inputs;
+    for (int index = 0; index < devices.size(); ++index)
+        inputs.append(devices[index]->device);
+    return inputs;
+}
+
 void QExtMouse3DWin32Handler::setProvider(QExtMouse3DEventProvider *provider)
 {
     QExtMouse3DDevice::setProvider(provider);
@@ -132,6 +152,13 @@ void QExtMouse3DWin32Handler::updateSensitivity(qreal sensitivity)
         devices[index]->device->updateSensitivity(sensitivity);
 }
 
+void QExtMouse3DWin32Handler::updateAdaptiveCalibration(bool adaptive)
+{
+    QExtMouse3DDevice::updateAdaptiveCalibration(adaptive);
+    for (int index = 0; index < devices.size(); ++index)
+        devices[index]->device->updateAdaptiveCalibration(adaptive);
+}
+
 void QExtMouse3DWin32Handler::deviceAdded(HANDLE deviceHandle)
 {
     Q_UNUSED(deviceHandle);
@@ -186,6 +213,8 @@ void QExtMouse3DWin32Handler::mouseAdded (HANDLE deviceHandle)
 
             QExtMouse3DWin32InputDevice *device = new QExtMouse3DWin32InputDevice(devName, devBrand, deviceHandle, this);
             MouseInfo *info = new MouseInfo(deviceHandle, devName, devBrand, device);
+            connect(device, SIGNAL(descriptorChanged()),
+                    this, SIGNAL(descriptorChanged()));
 
             devices.append(info);
         }
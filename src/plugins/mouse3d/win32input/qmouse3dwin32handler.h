@@ -60,11 +60,14 @@ public:
 
     bool isAvailable() const;
     QStringList deviceNames() const;
+    QList<QExtMouse3DDeviceDescriptor> deviceDescriptors() const;
+    QList<QExtMouse3DDevice *> inputDevices() const;
 
     void setProvider(QExtMouse3DEventProvider *provider);
     void setWidget(QWidget *widget);
     void updateFilters(QExtMouse3DEventProvider::Filters filters);
     void updateSensitivity(qreal sensitivity);
+    void updateAdaptiveCalibration(bool adaptive);
 
 private Q_SLOTS:
     void deviceAdded(HANDLE deviceHandle);
@@ -135,19 +135,6 @@ static const char* connexion3d_key_names[] =
   "ALT", "SHIFT", "CTRL", "ROTATE", "PANZOOM", "DOMINANT", "PLUS", "MINUS"
 };
 
-static const connexion3dKeyCode SpaceExplorerKeys [] =
-{
-  V3DK_INVALID, V3DK_1, V3DK_2, V3DK_TOP, V3DK_LEFT, V3DK_RIGHT, V3DK_FRONT, V3DK_ESC,
-  V3DK_ALT, V3DK_SHIFT, V3DK_CTRL, V3DK_FIT, V3DK_MENU, V3DK_PLUS, V3DK_MINUS, V3DK_ROTATE
-};
-
-static const connexion3dKeyCode SpacePilotKeys [] =
-{
-  V3DK_INVALID, V3DK_1, V3DK_2, V3DK_3, V3DK_4, V3DK_5, V3DK_6, V3DK_TOP, V3DK_LEFT,
-  V3DK_RIGHT, V3DK_FRONT, V3DK_ESC, V3DK_ALT, V3DK_SHIFT, V3DK_CTRL, V3DK_FIT, V3DK_MENU,
-  V3DK_PLUS, V3DK_MINUS, V3DK_DOMINANT, V3DK_ROTATE
-};
-
 __inline QString ProductName(unsigned long pid)
 {
     switch (pid)
@@ -167,45 +154,6 @@ __inline QString ProductName(unsigned long pid)
     }
 }
 
-__inline unsigned short rawInputToVirtualKeyCode(unsigned long pid, int hidKeyCode)
-{
-    unsigned short virtualkey = V3DK_INVALID;
-
-    //Sanity checks on input.
-    if (hidKeyCode<=0)
-        virtualkey = V3DK_INVALID;
-    else
-        //get the appropriate bit masking for key codes
-        virtualkey = 1 + (int)(log( (double) hidKeyCode ) / log( 2.0 ));
-
-    int numKeys = 0;
-
-    //Special product cases.
-    switch (pid)
-    {
-    case eSpacePilot:
-        numKeys = sizeof(SpacePilotKeys)/sizeof(SpacePilotKeys[0]);
-        virtualkey < numKeys ? virtualkey = SpacePilotKeys[virtualkey] : virtualkey = V3DK_INVALID;
-        break;
-    case eSpaceExplorer:
-        numKeys = sizeof(SpaceExplorerKeys)/SpaceExplorerKeys[0];
-        virtualkey < numKeys ? virtualkey = SpaceExplorerKeys[virtualkey] : virtualkey = V3DK_INVALID;
-        break;
-    case eSpaceNavigator:
-    case eSpaceNavigatorForNotebooks:
-    case eSpacePilotPRO:
-        //no change
-        if (virtualkey>V3DK_MINUS) virtualkey = V3DK_INVALID;
-        break;
-    default:
-        //no change but unknown hardware.  Show a warning, but carry on.
-        qWarning() << "Unknown product id [" <<pid<<"] defaulting to standard keys.";
-        break;
-    }
-
-    return virtualkey;
-}
-
 QT_END_NAMESPACE
 
 QT_END_HEADER
@@ -45,7 +45,6 @@
 #include <QWidget>
 #include "qmouse3dwin32inputdevice.h"
 #include "qmouse3dwin32info.h"
-#include "qglnamespace.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -66,17 +65,12 @@ QExtMouse3DWin32InputDevice::QExtMouse3DWin32InputDevice
         (const QString &dName , const QString &realName , HANDLE deviceHandle, QObject *parent)
     : QExtMouse3DDevice(parent)
     , isOpen(false)
+    , adaptiveCalibration(true)
     , devName(dName)
     , name(realName)
-     , flatMiddle(15)
-    , sawTranslate(false)
-    , sawRotate(false)
     , prevWasFlat(false)
     , deviceHandle(deviceHandle)
 {
-    //Initialise mouse data containers
-    memset(values, 0, sizeof(values));
-    memset(tempValues, 0, sizeof(tempValues));
 }
 
 QExtMouse3DWin32InputDevice::~QExtMouse3DWin32InputDevice()
@@ -121,6 +115,12 @@ void QExtMouse3DWin32InputDevice::setWidget(QWidget *widget)
     initDevice();
 }
 
+void QExtMouse3DWin32InputDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    adaptiveCalibration = adaptive;
+    parser.calibration()->setAdaptive(adaptive);
+}
+
 void QExtMouse3DWin32InputDevice::initDevice()
 {
     // Determine the size of the "flat middle", where we clamp values to
@@ -128,16 +128,23 @@ void QExtMouse3DWin32InputDevice::initDevice()
     // windows doesn't give us much help here, so use 16 as we know the max
     // values are around 500, so that on 32 (for a good middle ground) we
     // get around 16... go figure.
-    flatMiddle = 16;
+    // The dead zone and zero offset are then refined while the device
+    // is used, to suit the noise and drift of this particular mouse,
+    // unless the provider asks for a fixed calibration.
+    QExtMouse3DCalibration *calibration = parser.calibration();
+    int ranges[6];
+    for (int axis = 0; axis < 6; ++axis) {
+        calibration->setAxis(axis, -500, 500, 16);
+        ranges[axis] = 500;
+    }
+    setAxisRanges(ranges);
+    calibration->setAdaptive(adaptiveCalibration);
 
     // Connect up signals and slots to pass on the data
     connect(&mouseSignaller, SIGNAL(rawInputDetected(HRAWINPUT)), this, SLOT(readyRead(HRAWINPUT)));
 
     // Clear the current mouse state.
-    memset(values, 0, sizeof(values));
-    memset(tempValues, 0, sizeof(tempValues));
-    sawTranslate = false;
-    sawRotate = false;
+    parser.reset();
     prevWasFlat = false;
 
 
@@ -169,19 +176,17 @@ void QExtMouse3DWin32InputDevice::initDevice()
             mouseType = QExtMouse3DWin32InputDevice::MouseUnknown;
             break;
         };
+        parser.setProductId(deviceInfo.hid.dwProductId);
+        setDeviceInfo(int(deviceInfo.hid.dwVendorId),
+                      int(deviceInfo.hid.dwProductId), parser.buttonCount(),
+                      mouseType == QExtMouse3DWin32InputDevice::MouseSpacePilotPRO);
     } else {
         qWarning() << "Failed to get mouse type.";
     }
 }
 
-static inline int clampRange(int value)
-{
-    return qMin(qMax(value, -32768), 32767);
-}
-
 void QExtMouse3DWin32InputDevice::readyRead(HRAWINPUT hRawInput)
 {
-    bool deliverMotion = false;
     int dwSize;
 
     (*_GetRawInputData)(hRawInput, RID_INPUT, NULL, &dwSize, sizeof(RAWINPUTHEADER));
@@ -217,80 +222,26 @@ void QExtMouse3DWin32InputDevice::readyRead(HRAWINPUT hRawInput)
 
         if (sRidDeviceInfo.hid.dwVendorId == LOGITECH_VENDOR_ID)
         {
-            //motion data comes in 2 packages
-            //orientation is right handed coord system with z down
-            //this is the standard HID orientation
-            BYTE* inputDataBytes = (BYTE*)(&pRawInput->data.hid.bRawData);
-            if (inputDataBytes[0]==0x01)
-            {
-
-                //translation vector
-                short *pnData = reinterpret_cast <short*>(&pRawInput->data.hid.bRawData[1]);
-                tempValues[0] = pnData[0];
-                tempValues[1] = pnData[1];
-                tempValues[2] = pnData[2];
-
-                sawTranslate = true;
-            }
-            else if (inputDataBytes[0]==0x02)
-            {
-                sawRotate = true;
-                //directed rotation vector
-                short *pnData = reinterpret_cast <short*>(&pRawInput->data.hid.bRawData[1]);
-                tempValues[3] = pnData[0];
-                tempValues[4] = pnData[1];
-                tempValues[5] = pnData[2];
-            }
-            else if (inputDataBytes[0]==0x03)
-            {
-                //state of the keys
-                unsigned long dwKeystate= *reinterpret_cast<unsigned long *>(&pRawInput->data.hid.bRawData[1]);
-                int nVirtualKeyCode = rawInputToVirtualKeyCode(sRidDeviceInfo.hid.dwProductId, dwKeystate);
-                translateMscKey(nVirtualKeyCode, true);
-            }
-
-            if (sawTranslate) {
-                deliverMotion = true;
-                sawTranslate = false;
-                values[0] = tempValues[0];
-                values[1] = tempValues[1];
-                values[2] = tempValues[2];
-                tempValues[0] = tempValues[1] = tempValues[2] = 0;
-                if (qAbs(values[0]) < flatMiddle && qAbs(values[1]) < flatMiddle && qAbs(values[2]) < flatMiddle) {
-                    values[0] = 0;
-                    values[1] = 0;
-                    values[2] = 0;
-                }
-            }
-            if (sawRotate) {
-                deliverMotion = true;
-                sawRotate = false;
-                values[3] = tempValues[3];
-                values[4] = tempValues[4];
-                values[5] = tempValues[5];
-                tempValues[3] = tempValues[4] = tempValues[5] = 0;
-                if (qAbs(values[3]) < flatMiddle && qAbs(values[4]) < flatMiddle && qAbs(values[5]) < flatMiddle) {
-                    values[3] = 0;
-                    values[4] = 0;
-                    values[5] = 0;
+            // A message can carry several reports of the same size.
+            // The reports are decoded by QExtMouse3DHidParser, which
+            // pairs the translation and rotation halves of a sample.
+            const uchar *report = pRawInput->data.hid.bRawData;
+            int size = int(pRawInput->data.hid.dwSizeHid);
+            for (DWORD index = 0; index < pRawInput->data.hid.dwCount; ++index) {
+                int result = parser.parse(report, size);
+                report += size;
+                if (result & QExtMouse3DHidParser::Buttons) {
+                    quint32 changed = parser.changedButtons();
+                    for (int button = 0; button < 32; ++button) {
+                        quint32 mask = quint32(1) << button;
+                        if (changed & mask) {
+                            translateMscKey(parser.buttonKey(button),
+                                            (parser.buttons() & mask) != 0);
+                        }
+                    }
                 }
-            }
-
-            if (deliverMotion) {
-                // Filter out multiple "flat" events so we don't get too much noise
-                // being delivered up to the widget layer.
-                bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
-                               values[3] == 0 && values[4] == 0 && values[5] == 0);
-                if (prevWasFlat && isFlat)
-                    deliverMotion = false;
-                prevWasFlat = isFlat;
-            }
-            if (deliverMotion) {
-                // Deliver the motion event and ask QExtMouse3DDevice to filter it.
-                QExtMouse3DEvent mevent
-                    ((short)(values[0]), (short)(values[1]), (short)(values[2]),
-                     (short)(values[3]), (short)(values[4]), (short)(values[5]));
-                motion(&mevent);
+                if (result & QExtMouse3DHidParser::Motion)
+                    deliverMotion(parser.values());
             }
         }
     }
@@ -299,8 +250,29 @@ void QExtMouse3DWin32InputDevice::readyRead(HRAWINPUT hRawInput)
 }
 
 
-// These are the keycodes that are reported by the 3Dconnection
-// SpacePilot PRO
+void QExtMouse3DWin32InputDevice::deliverMotion(const int *values)
+{
+    // Filter out multiple "flat" events so we don't get too much noise
+    // being delivered up to the widget layer.
+    bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0 &&
+                   values[3] == 0 && values[4] == 0 && values[5] == 0);
+    bool wasFlat = prevWasFlat;
+    prevWasFlat = isFlat;
+    if (wasFlat && isFlat)
+        return;
+
+    // Deliver the motion event and ask QExtMouse3DDevice to filter it.
+    QExtMouse3DEvent mevent
+        ((short)(values[0]), (short)(values[1]), (short)(values[2]),
+         (short)(values[3]), (short)(values[4]), (short)(values[5]));
+    // Raw input does not carry a usable timestamp, so use
+    // the time at which the report was received.
+    mevent.setTimestamp(QExtMouse3DEvent::currentTimestamp());
+    motion(&mevent);
+}
+
+// The buttons of the 3Dconnexion devices are mapped to key codes by
+// QExtMouse3DHidParser, according to the product.
 //
 // The SpaceNavigator reports keypress events, but only has 2 buttons,
 // which we map to the same behavior as pan and rotation keys
@@ -310,88 +282,11 @@ void QExtMouse3DWin32InputDevice::readyRead(HRAWINPUT hRawInput)
 
 void QExtMouse3DWin32InputDevice::translateMscKey(int code, bool press)
 {
-    int qtcode = -1;
-    switch (code) {
-    case V3DK_MENU:
-        // On the SpaceNavigator, map this key to "translation lock".
-        if (mouseType & QExtMouse3DWin32InputDevice::MouseSpaceNavigator) {
-            if (press)
-                toggleFilter(QExtMouse3DEventProvider::Translations);
-            qtcode = QGL::Key_Translations;
-        } else {
-            qtcode = Qt::Key_Menu;
-        }
-        break;
-
-    case V3DK_FIT:
-        // On the SpaceNavigator, map this key to "rotation lock".
-        if (mouseType & QExtMouse3DWin32InputDevice::MouseSpaceNavigator) {
-            if (press)
-                toggleFilter(QExtMouse3DEventProvider::Rotations);
-            qtcode = QGL::Key_Rotations;
-        } else {
-            qtcode = QGL::Key_Fit;
-        }
-        break;
-
-    case V3DK_TOP:  qtcode = QGL::Key_TopView; break;
-    case V3DK_LEFT:     qtcode = QGL::Key_LeftView; break;
-    case V3DK_RIGHT:    qtcode = QGL::Key_RightView; break;
-    case V3DK_FRONT:    qtcode = QGL::Key_FrontView; break;
-    case V3DK_BOTTOM:   qtcode = QGL::Key_BottomView; break;
-    case V3DK_BACK:     qtcode = QGL::Key_BackView; break;
-    case V3DK_CW:  qtcode = QGL::Key_RotateCW90; break;
-    case V3DK_CCW:  qtcode = QGL::Key_RotateCCW90; break;
-    case V3DK_ISO1:     qtcode = QGL::Key_ISO1; break;
-    case V3DK_ISO2:     qtcode = QGL::Key_ISO2; break;
-    case V3DK_1:        qtcode = QGL::Key_Button1; break;
-    case V3DK_2:        qtcode = QGL::Key_Button2; break;
-    case V3DK_3:        qtcode = QGL::Key_Button3; break;
-    case V3DK_4:        qtcode = QGL::Key_Button4; break;
-    case V3DK_5:        qtcode = QGL::Key_Button5; break;
-    case V3DK_6:        qtcode = QGL::Key_Button6; break;
-    case V3DK_7:        qtcode = QGL::Key_Button7; break;
-    case V3DK_8:        qtcode = QGL::Key_Button8; break;
-    case V3DK_9:        qtcode = QGL::Key_Button9; break;
-    case V3DK_10:       qtcode = QGL::Key_Button10; break;
-    case V3DK_ESC:      qtcode = Qt::Key_Escape; break;
-    case V3DK_ALT:      qtcode = Qt::Key_Alt; break;
-    case V3DK_SHIFT:    qtcode = Qt::Key_Shift; break;
-    case V3DK_CTRL:     qtcode = Qt::Key_Control; break;
-
-    case V3DK_ROTATE:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::Rotations);
-        qtcode = QGL::Key_Rotations;
-        break;
-    case V3DK_PANZOOM:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::Translations);
-        qtcode = QGL::Key_Translations;
-        break;
-    case V3DK_DOMINANT:
-        if (press)
-            toggleFilter(QExtMouse3DEventProvider::DominantAxis);
-        qtcode = QGL::Key_DominantAxis;
-        break;
-    case V3DK_PLUS:
-        if (press)
-            adjustSensitivity(2.0f);
-        qtcode = QGL::Key_IncreaseSensitivity;
-        break;
-    case V3DK_MINUS:
-        if (press)
-            adjustSensitivity(0.5f);
-        qtcode = QGL::Key_DecreaseSensitivity;
-        break;
-    default: break;
-    }
-    if (qtcode != -1) {
-        if (press)
-            keyPress(qtcode);
-        else
-            keyRelease(qtcode);
-    }
+    int qtcode = QExtMouse3DHidParser::keyCode
+        (QExtMouse3DHidParser::Key(code),
+         (mouseType & QExtMouse3DWin32InputDevice::MouseSpaceNavigator) != 0);
+    if (qtcode != -1)
+        deviceKey(qtcode, press);
 }
 
 QT_END_NAMESPACE
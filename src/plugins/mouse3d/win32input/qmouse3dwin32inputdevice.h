@@ -44,6 +44,7 @@
 
 
 #include "qmouse3ddevice_p.h"
+#include "qmouse3dhidparser_p.h"
 #include <QtCore/qtimer.h>
 #include <windows.h>
 #include "qmouse3dwin32info.h"
@@ -68,19 +69,17 @@ public:
     QStringList deviceNames() const;
 
     void setWidget(QWidget *widget);
+    void updateAdaptiveCalibration(bool adaptive);
 
 private Q_SLOTS:
     void readyRead(HRAWINPUT hRawInput);
 
 private:
     bool isOpen;
+    bool adaptiveCalibration;
     QString devName;
     QString name;
-    int values[6];
-    int tempValues[6];
-    int flatMiddle;
-    bool sawTranslate;
-    bool sawRotate;
+    QExtMouse3DHidParser parser;
     bool prevWasFlat;
     HANDLE deviceHandle;
 
@@ -98,6 +97,7 @@ private:
     int mouseType;
 
     void initDevice();
+    void deliverMotion(const int *values);
     void translateMscKey(int code, bool press);
 };
 
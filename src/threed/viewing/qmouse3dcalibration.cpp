@@ -0,0 +1,395 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dcalibration_p.h"
+#include <QtCore/qmath.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QExtMouse3DCalibration
+    \internal
+    \brief The QExtMouse3DCalibration class removes the dead zone around the center position of a 3D mouse.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    3D mice rarely report exactly zero when they are at rest, so values
+    close to the center are treated as zero.  QExtMouse3DCalibration keeps
+    the range and dead zone of each of the six axes, as reported by the
+    device, and applies them to the translation or rotation triples that
+    are decoded by the device plug-ins.
+
+    Values outside the dead zone are rescaled so that the output rises
+    smoothly from zero at the edge of the dead zone to the full range of
+    the axis, rather than jumping from zero to the dead zone size.
+
+    The default calibration has no dead zone, which passes values
+    through unchanged.
+
+    When adaptive calibration is enabled with setAdaptive(), the
+    calibration also learns how the device behaves at rest while it
+    is being used.  The zero offset of each axis is tracked so that
+    slow drift is subtracted, and the dead zone of each axis follows
+    the measured noise of the device instead of the value that was
+    given to setAxis().  The zero offset is only learned while the
+    device stays within its noise floor and does not move for a while,
+    so that a deflection that is held, however slowly it was reached,
+    is not mistaken for drift.  Only a few values per axis are kept, and
+    each sample is processed in constant time.
+*/
+
+// Upper limit on the learned dead zone, as a fraction of the range
+// of an axis.
+static const qreal restFraction = 0.15f;
+
+// Number of consecutive samples at rest whose mean is used to learn
+// the zero offset.  This is about half a second at the typical report
+// rates of a 3D mouse.
+static const int restWindowSize = 32;
+
+// Rates at which the zero offset and the noise estimate follow the
+// samples taken at rest.  At the typical 60 to 120 reports per second
+// of a 3D mouse, the offset adapts over several seconds so that
+// deliberate small motions are not absorbed, and the noise over
+// about a second.
+static const qreal biasRate = 1.0f / 512.0f;
+static const qreal noiseRate = 1.0f / 64.0f;
+
+// Size of the learned dead zone in standard deviations of the noise,
+// and the smallest dead zone that will be learned.
+static const qreal noiseDeviations = 4.0f;
+static const int minimumDeadZone = 2;
+
+/*!
+    \enum QExtMouse3DCalibration::DeadZoneShape
+    This enum defines how the dead zones of the three axes in a
+    translation or rotation triple are combined.
+
+    \value AxialDeadZone Each axis is treated independently, so a small
+        motion on one axis is not affected by noise on the others.
+    \value RadialDeadZone The triple is treated as a vector, which is
+        zero while it lies inside the ellipsoid that is formed by the
+        three dead zones.  Motions that are diagonal to the axes are
+        not distorted towards the axes.  This is the default.
+*/
+
+/*!
+    Constructs a calibration with no dead zone and a range of
+    -32768 to 32767 on every axis.
+*/
+QExtMouse3DCalibration::QExtMouse3DCalibration()
+    : m_shape(RadialDeadZone)
+    , m_adaptive(false)
+{
+    for (int axis = 0; axis < 6; ++axis)
+        setAxis(axis, -32768, 32767, 0);
+}
+
+/*!
+    \fn QExtMouse3DCalibration::DeadZoneShape QExtMouse3DCalibration::deadZoneShape() const
+
+    Returns the way in which the dead zones of the axes in a triple
+    are combined.  The default is RadialDeadZone.
+
+    \sa setDeadZoneShape()
+*/
+
+/*!
+    \fn void QExtMouse3DCalibration::setDeadZoneShape(QExtMouse3DCalibration::DeadZoneShape shape)
+
+    Sets the way in which the dead zones of the axes in a triple
+    are combined to \a shape.
+
+    \sa deadZoneShape()
+*/
+
+/*!
+    \fn int QExtMouse3DCalibration::minimum(int axis) const
+
+    Returns the minimum value that is reported on \a axis.
+
+    \sa maximum(), setAxis()
+*/
+
+/*!
+    \fn int QExtMouse3DCalibration::maximum(int axis) const
+
+    Returns the maximum value that is reported on \a axis.
+
+    \sa minimum(), setAxis()
+*/
+
+/*!
+    \fn int QExtMouse3DCalibration::deadZone(int axis) const
+
+    Returns the size of the dead zone around zero on \a axis.
+
+    \sa setAxis(), learnedDeadZone()
+*/
+
+/*!
+    \fn bool QExtMouse3DCalibration::isAdaptive() const
+
+    Returns true if the calibration learns the zero offset and noise
+    of the device while it is used; false otherwise.  The default
+    is false.
+
+    \sa setAdaptive()
+*/
+
+/*!
+    \fn void QExtMouse3DCalibration::setAdaptive(bool value)
+
+    Enables or disables learning of the zero offset and noise of the
+    device according to \a value.  Learning starts from the dead zones
+    that were passed to setAxis() and from a zero offset of zero.
+
+    \sa isAdaptive()
+*/
+
+/*!
+    \fn int QExtMouse3DCalibration::bias(int axis) const
+
+    Returns the zero offset that has been learned for \a axis.
+    This is subtracted from the raw values before the dead zone
+    is applied if isAdaptive() is true.
+
+    \sa learnedDeadZone()
+*/
+
+/*!
+    \fn int QExtMouse3DCalibration::learnedDeadZone(int axis) const
+
+    Returns the dead zone that has been learned for \a axis from the
+    noise of the device.  This is used instead of deadZone() if
+    isAdaptive() is true.
+
+    \sa bias(), deadZone()
+*/
+
+/*!
+    Sets the \a minimum and \a maximum values that are reported on
+    \a axis, and the size of the \a deadZone around zero.  Axes 0 to 2
+    are the X, Y, and Z translations, and 3 to 5 are the rotations.
+*/
+void QExtMouse3DCalibration::setAxis
+    (int axis, int minimum, int maximum, int deadZone)
+{
+    Axis &info = m_axes[axis];
+    info.minimum = qMin(minimum, -1);
+    info.maximum = qMax(maximum, 1);
+    info.deadZone = qMax(deadZone, 0);
+    info.bias = 0.0f;
+    info.noise = qreal(info.deadZone) * info.deadZone /
+                 (noiseDeviations * noiseDeviations);
+    info.learnedDeadZone = info.deadZone;
+    info.last = 0;
+    info.restSum = 0;
+    info.restMean = 0.0f;
+    m_restSamples[axis / 3] = 0;
+    m_hasRestMean[axis / 3] = false;
+}
+
+/*!
+    Calibrates the three \a raw values of the translation (\a first
+    is 0) or rotation (\a first is 3) triple and writes the results
+    to \a values.  The results stay within the range of each axis
+    for raw values that are within that range.
+
+    If isAdaptive() is true, \a raw is also used to update the
+    learned zero offset and noise of the device.
+*/
+void QExtMouse3DCalibration::calibrate(int first, const int *raw, int *values)
+{
+    const Axis *axes = m_axes + first;
+    int adjusted[3];
+    int deadZones[3];
+    if (m_adaptive) {
+        learn(first, raw);
+        for (int index = 0; index < 3; ++index) {
+            adjusted[index] = raw[index] - qRound(axes[index].bias);
+            deadZones[index] = axes[index].learnedDeadZone;
+        }
+    } else {
+        for (int index = 0; index < 3; ++index) {
+            adjusted[index] = raw[index];
+            deadZones[index] = axes[index].deadZone;
+        }
+    }
+
+    if (m_shape == AxialDeadZone) {
+        for (int index = 0; index < 3; ++index) {
+            const Axis &info = axes[index];
+            int value = adjusted[index];
+            int deadZone = deadZones[index];
+            int range = value < 0 ? -info.minimum : info.maximum;
+            int magnitude = qAbs(value);
+            if (magnitude <= deadZone) {
+                values[index] = 0;
+            } else if (range <= deadZone) {
+                values[index] = value;
+            } else {
+                qreal scaled = qreal(magnitude - deadZone) * range /
+                               (range - deadZone);
+                values[index] = (value < 0 ? -qRound(scaled) : qRound(scaled));
+            }
+        }
+        return;
+    }
+
+    // Measure the vector both against the dead zone ellipsoid and
+    // against the full range of each axis.  An axis without a dead
+    // zone makes the ellipsoid infinitely thin along that axis.
+    qreal deadLength = 0.0f;
+    qreal rangeLength = 0.0f;
+    bool outsideDeadZone = false;
+    for (int index = 0; index < 3; ++index) {
+        const Axis &info = axes[index];
+        int value = adjusted[index];
+        int deadZone = deadZones[index];
+        if (!value)
+            continue;
+        if (!deadZone)
+            outsideDeadZone = true;
+        else
+            deadLength += qreal(value) * value / (qreal(deadZone) * deadZone);
+        qreal range = (value < 0 ? -info.minimum : info.maximum);
+        rangeLength += qreal(value) * value / (range * range);
+    }
+    deadLength = qSqrt(deadLength);
+    rangeLength = qSqrt(rangeLength);
+
+    // The edge of the dead zone in the direction of the vector is at
+    // rangeLength / deadLength.  Rescale so that the output is zero at
+    // that edge and reaches full range at the edge of the range.
+    qreal scale = 1.0f;
+    if (!outsideDeadZone) {
+        if (deadLength <= 1.0f) {
+            values[0] = values[1] = values[2] = 0;
+            return;
+        }
+        qreal edge = rangeLength / deadLength;
+        if (edge < 1.0f)
+            scale = (1.0f - 1.0f / deadLength) / (1.0f - edge);
+    }
+    for (int index = 0; index < 3; ++index)
+        values[index] = qRound(adjusted[index] * scale);
+}
+
+// Updates the learned zero offset and noise of the triple starting
+// at \a first from the \a raw sample.  A sample counts as taken at
+// rest if it lies within the noise floor around the current offset,
+// which is the larger of the nominal and the learned dead zone, and
+// has not moved much since the previous sample.  The noise is
+// estimated from the change between consecutive samples, whose
+// variance is twice the variance of the noise, so that slow
+// deliberate motions and the drift itself do not inflate it.
+//
+// The offset is learned from the means of windows of restWindowSize
+// samples in a row that were taken at rest.  A window only counts
+// if its mean is within the noise of the previous window's, so that
+// a pan that passes slowly through the noise floor, or a deflection
+// that is held just outside it, is not absorbed.
+void QExtMouse3DCalibration::learn(int first, const int *raw)
+{
+    Axis *axes = m_axes + first;
+    int &restSamples = m_restSamples[first / 3];
+    bool &hasRestMean = m_hasRestMean[first / 3];
+    bool atRest = true;
+    int changes[3];
+    for (int index = 0; index < 3; ++index) {
+        Axis &info = axes[index];
+        int noiseFloor = qMax(qMax(info.deadZone, info.learnedDeadZone),
+                              minimumDeadZone);
+        changes[index] = raw[index] - info.last;
+        info.last = raw[index];
+        if (qAbs(raw[index] - info.bias) > noiseFloor)
+            atRest = false;
+        else if (qAbs(changes[index]) > qMax(2 * info.learnedDeadZone, minimumDeadZone))
+            atRest = false;
+    }
+    if (!atRest) {
+        for (int index = 0; index < 3; ++index)
+            axes[index].restSum = 0;
+        restSamples = 0;
+        hasRestMean = false;
+        return;
+    }
+    for (int index = 0; index < 3; ++index) {
+        Axis &info = axes[index];
+        int range = qMax(-info.minimum, info.maximum);
+        qreal change = changes[index];
+        info.restSum += raw[index];
+        info.noise += (change * change / 2.0f - info.noise) * noiseRate;
+
+        // Never learn a dead zone that is more than twice the nominal
+        // one, so that fine positioning does not get swallowed.
+        int maximumDeadZone = int(range * restFraction);
+        if (info.deadZone > 0)
+            maximumDeadZone = qMin(maximumDeadZone, 2 * info.deadZone);
+        info.learnedDeadZone =
+            qBound(minimumDeadZone, qRound(noiseDeviations * qSqrt(info.noise)),
+                   qMax(maximumDeadZone, minimumDeadZone));
+    }
+    if (++restSamples < restWindowSize)
+        return;
+
+    bool steady = hasRestMean;
+    for (int index = 0; index < 3; ++index) {
+        const Axis &info = axes[index];
+        qreal mean = qreal(info.restSum) / restWindowSize;
+        if (qAbs(mean - info.restMean) > qMax(qSqrt(info.noise), qreal(1.0f)))
+            steady = false;
+    }
+    for (int index = 0; index < 3; ++index) {
+        Axis &info = axes[index];
+        qreal mean = qreal(info.restSum) / restWindowSize;
+        if (steady)
+            info.bias += (mean - info.bias) * biasRate * restWindowSize;
+        info.restMean = mean;
+        info.restSum = 0;
+    }
+    restSamples = 0;
+    hasRestMean = true;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,120 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DCALIBRATION_P_H
+#define QMOUSE3DCALIBRATION_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qt3dglobal.h"
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+QT_MODULE(Qt3d)
+
+class Q_QT3D_EXPORT QExtMouse3DCalibration
+{
+public:
+    QExtMouse3DCalibration();
+
+    enum DeadZoneShape
+    {
+        AxialDeadZone,
+        RadialDeadZone
+    };
+
+    DeadZoneShape deadZoneShape() const { return m_shape; }
+    void setDeadZoneShape(DeadZoneShape shape) { m_shape = shape; }
+
+    int minimum(int axis) const { return m_axes[axis].minimum; }
+    int maximum(int axis) const { return m_axes[axis].maximum; }
+    int deadZone(int axis) const { return m_axes[axis].deadZone; }
+    void setAxis(int axis, int minimum, int maximum, int deadZone);
+
+    bool isAdaptive() const { return m_adaptive; }
+    void setAdaptive(bool value) { m_adaptive = value; }
+
+    int bias(int axis) const { return qRound(m_axes[axis].bias); }
+    int learnedDeadZone(int axis) const { return m_axes[axis].learnedDeadZone; }
+
+    void calibrate(int first, const int *raw, int *values);
+
+private:
+    struct Axis
+    {
+        int minimum;
+        int maximum;
+        int deadZone;
+
+        // Running state for adaptive calibration.
+        qreal bias;
+        qreal noise;
+        int learnedDeadZone;
+        int last;
+        int restSum;
+        qreal restMean;
+    };
+
+    Axis m_axes[6];
+    DeadZoneShape m_shape;
+    bool m_adaptive;
+    int m_restSamples[2];
+    bool m_hasRestMean[2];
+
+    void learn(int first, const int *raw);
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
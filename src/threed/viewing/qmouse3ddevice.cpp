@@ -41,9 +41,11 @@
 
 #include "qmouse3ddevice_p.h"
 #include "qmouse3ddevicelist_p.h"
+#include "qglnamespace.h"
 #include <QtGui/qapplication.h>
 #include <QtGui/qwidget.h>
 #include <QtGui/qevent.h>
+#include <QtCore/qthread.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -90,11 +92,28 @@ public:
     QExtMouse3DDevicePrivate()
         : widget(0)
         , provider(0)
+        , list(0)
+        , atRest(true)
+        , vendorId(0)
+        , productId(0)
+        , buttonCount(0)
+        , hasLcd(false)
+        , droppedSyncs(0)
     {
+        for (int axis = 0; axis < 6; ++axis)
+            axisRanges[axis] = 32767;
     }
 
     QWidget *widget;
     QExtMouse3DEventProvider *provider;
+    QExtMouse3DDeviceList *list;
+    bool atRest;
+    int axisRanges[6];
+    int vendorId;
+    int productId;
+    int buttonCount;
+    bool hasLcd;
+    quint64 droppedSyncs;
 };
 
 QExtMouse3DDevice *QExtMouse3DDevice::testDevice1 = 0;
@@ -137,6 +156,67 @@ QExtMouse3DDevice::~QExtMouse3DDevice()
     \sa isAvailable()
 */
 
+/*!
+    Returns a descriptor for each of the low-level 3D mouse devices
+    that are being managed by this device object, and which are
+    currently available.
+
+    The default implementation returns one descriptor for each of
+    deviceNames(), with the axisRange() values, the identifiers and
+    buttons that were passed to setDeviceInfo(), and the count that
+    was passed to setDroppedSyncs().  Device objects that manage
+    several devices of their own should override this to return the
+    descriptors of those devices.
+
+    \sa descriptorChanged(), deviceNames()
+*/
+QList<QExtMouse3DDeviceDescriptor> QExtMouse3DDevice::deviceDescriptors() const
+{
+    Q_D(const QExtMouse3DDevice);
+    QList<QExtMouse3DDeviceDescriptor> descriptors;
+    QStringList names = deviceNames();
+    for (int index = 0; index < names.size(); ++index) {
+        QExtMouse3DDeviceDescriptor descriptor;
+        descriptor.name = names.at(index);
+        descriptor.vendorId = d->vendorId;
+        descriptor.productId = d->productId;
+        for (int axis = 0; axis < 6; ++axis)
+            descriptor.axisRanges[axis] = d->axisRanges[axis];
+        descriptor.buttonCount = d->buttonCount;
+        descriptor.hasLcd = d->hasLcd;
+        descriptor.droppedSyncs = d->droppedSyncs;
+        descriptors.append(descriptor);
+    }
+    return descriptors;
+}
+
+/*!
+    Returns the device objects that deliver the input of each of the
+    low-level 3D mouse devices that are managed by this device object,
+    in the same order as deviceNames().  The list of providers uses it
+    to configure mice that are bound to a provider apart from the rest.
+
+    The default implementation returns this device object.  Device
+    objects that manage several devices of their own, each delivering
+    its own input, should override this to return those devices.
+
+    \sa deviceNames(), QExtMouse3DEventProvider::setDeviceBinding()
+*/
+QList<QExtMouse3DDevice *> QExtMouse3DDevice::inputDevices() const
+{
+    return QList<QExtMouse3DDevice *>() << const_cast<QExtMouse3DDevice *>(this);
+}
+
+/*!
+    \fn void QExtMouse3DDevice::descriptorChanged()
+
+    This signal is emitted when deviceDescriptors() changes while the
+    set of available devices stays the same, for example when the axis
+    ranges become known as the device is opened.
+
+    \sa deviceDescriptors(), availableChanged()
+*/
+
 /*!
     Returns the event provider that is currently associated
     with this mouse device and widget().  This can be used to
@@ -188,6 +268,84 @@ void QExtMouse3DDevice::setWidget(QWidget *widget)
     d->widget = widget;
 }
 
+/*!
+    Returns the largest value that the device reports for \a axis,
+    where 0 to 2 are the X, Y, and Z translations and 3 to 5 are the
+    rotations.  This is used to scale the axis to the range -1 to 1 for
+    QExtMouse3DNormalizedEvent.  The default is 32767, the range of
+    QExtMouse3DEvent.
+
+    \sa setAxisRanges()
+*/
+int QExtMouse3DDevice::axisRange(int axis) const
+{
+    Q_D(const QExtMouse3DDevice);
+    return d->axisRanges[axis];
+}
+
+/*!
+    Sets the largest value that the device reports for each axis to
+    the values in \a ranges, in the order translate X, Y, Z and rotate
+    X, Y, Z.  Subclasses should call this once they know the ranges of
+    the device, usually when it is opened, so that
+    QExtMouse3DNormalizedEvent values reach 1.0 at full deflection.
+    Values less than 1 are treated as 1.
+
+    \sa axisRange()
+*/
+void QExtMouse3DDevice::setAxisRanges(const int ranges[6])
+{
+    Q_D(QExtMouse3DDevice);
+    bool changed = false;
+    for (int axis = 0; axis < 6; ++axis) {
+        int range = qMax(ranges[axis], 1);
+        changed = changed || (d->axisRanges[axis] != range);
+        d->axisRanges[axis] = range;
+    }
+    if (changed)
+        emit descriptorChanged();
+}
+
+/*!
+    Sets the USB \a vendorId and \a productId of the device, the
+    number of buttons that it has in \a buttonCount, and whether it
+    has an LCD screen in \a hasLcd, for deviceDescriptors().  Values
+    that are not known are zero or false.  Subclasses should call this
+    as soon as they know the values.
+
+    \sa setAxisRanges(), descriptorChanged()
+*/
+void QExtMouse3DDevice::setDeviceInfo
+    (int vendorId, int productId, int buttonCount, bool hasLcd)
+{
+    Q_D(QExtMouse3DDevice);
+    if (d->vendorId == vendorId && d->productId == productId &&
+            d->buttonCount == buttonCount && d->hasLcd == hasLcd)
+        return;
+    d->vendorId = vendorId;
+    d->productId = productId;
+    d->buttonCount = buttonCount;
+    d->hasLcd = hasLcd;
+    emit descriptorChanged();
+}
+
+/*!
+    Sets the number of times that the operating system has dropped
+    input from the device, because it was not read quickly enough, to
+    \a count, for deviceDescriptors().  Subclasses should call this on
+    the GUI thread after they have recovered from each drop.
+
+    \sa setDeviceInfo(), descriptorChanged()
+*/
+void QExtMouse3DDevice::setDroppedSyncs(quint64 count)
+{
+    Q_D(QExtMouse3DDevice);
+    if (d->droppedSyncs == count)
+        return;
+    d->droppedSyncs = count;
+    emit descriptorChanged();
+}
+
 /*!
     Notifies the subclass that QExtMouse3DEventProvider::filters()
     has changed to \a filters.  The default implementation
@@ -220,34 +378,218 @@ void QExtMouse3DDevice::updateSensitivity(qreal sensitivity)
     Q_UNUSED(sensitivity);
 }
 
+/*!
+    Notifies the subclass that QExtMouse3DEventProvider::readMode()
+    has changed to \a mode.  The default implementation does nothing,
+    which leaves the device being read on the GUI thread.
+
+    Subclasses that can read the device on a background thread should
+    override this function and switch reading modes when it is called.
+
+    \sa updateFilters()
+*/
+void QExtMouse3DDevice::updateReadMode(QExtMouse3DEventProvider::ReadMode mode)
+{
+    Q_UNUSED(mode);
+}
+
+/*!
+    Notifies the subclass that QExtMouse3DEventProvider::aggregation()
+    has changed to \a aggregation.  The default implementation does
+    nothing, which leaves the subclass delivering the last sample.
+
+    Subclasses that coalesce backlogged samples should override this
+    function and combine them according to \a aggregation.
+
+    \sa updateReadMode()
+*/
+void QExtMouse3DDevice::updateAggregation
+    (QExtMouse3DEventProvider::Aggregation aggregation)
+{
+    Q_UNUSED(aggregation);
+}
+
+/*!
+    Notifies the subclass that QExtMouse3DEventProvider::keepDevicesOpen()
+    has changed to \a keepOpen.  The default implementation does nothing.
+
+    Subclasses that open the underlying device in setWidget() should
+    override this function and, when \a keepOpen is true, only pause the
+    device when the widget is set to null instead of closing it.
+
+    \sa setWidget()
+*/
+void QExtMouse3DDevice::updateKeepOpen(bool keepOpen)
+{
+    Q_UNUSED(keepOpen);
+}
+
+/*!
+    Notifies the subclass that
+    QExtMouse3DEventProvider::adaptiveCalibration() has changed to
+    \a adaptive.  The default implementation does nothing.
+
+    Subclasses that calibrate the raw axis values with
+    QExtMouse3DCalibration should override this function and pass
+    \a adaptive on to QExtMouse3DCalibration::setAdaptive().
+*/
+void QExtMouse3DDevice::updateAdaptiveCalibration(bool adaptive)
+{
+    Q_UNUSED(adaptive);
+}
+
+/*!
+    Notifies the subclass that the scheduling, CPU affinity or busy-poll
+    settings for background reader threads have changed to \a options.
+    The default implementation does nothing.
+
+    Subclasses that read the device on a background thread should
+    override this function and apply \a options to that thread.
+
+    \sa updateReadMode()
+*/
+void QExtMouse3DDevice::updateReaderOptions
+    (const QExtMouse3DReaderOptions &options)
+{
+    Q_UNUSED(options);
+}
+
+/*!
+    Notifies the subclass that QExtMouse3DEventProvider::maximumWakeupRate()
+    has changed to \a rate.  The default implementation does nothing,
+    which leaves the device being read whenever input arrives.
+
+    Subclasses that read the device on the GUI thread should override
+    this function and, when \a rate is non-zero, read the device at
+    most \a rate times a second while it is busy.
+
+    \sa updateReadMode(), updateAggregation()
+*/
+void QExtMouse3DDevice::updateWakeupRate(int rate)
+{
+    Q_UNUSED(rate);
+}
+
+/*!
+    Notifies the subclass that motions should be handed to \a sink on
+    the thread that reads the device, instead of being passed to
+    motion(), because the provider uses
+    QExtMouse3DEventProvider::ReaderThreadSink.  A null \a sink goes
+    back to motion().  The default implementation does nothing, in which
+    case the sink is called on the GUI thread by motion().
+
+    Subclasses that read the device on a thread of their own should
+    filter each motion with filterMotion() and call \a sink on that
+    thread.  Once this function returns, the previous sink must no
+    longer be in use.
+
+    \sa updateReadMode(), updateFilters(), updateSensitivity()
+*/
+void QExtMouse3DDevice::updateMotionSink(QExtMouse3DMotionSink *sink)
+{
+    Q_UNUSED(sink);
+}
+
+/*!
+    Notifies the subclass that QExtMouse3DEventProvider::delivery()
+    has changed to \a delivery.  The default implementation does
+    nothing.
+
+    Subclasses that combine backlogged samples according to
+    updateAggregation() should pass every sample to motion() instead
+    while \a delivery is QExtMouse3DEventProvider::BatchedDelivery,
+    so that the batch holds every sample that the device reported.
+
+    \sa updateAggregation()
+*/
+void QExtMouse3DDevice::updateDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    Q_UNUSED(delivery);
+}
+
 /*!
     Delivers a key press event to widget() for \a key.  Any of the key codes
     from Qt::Key or QGL::Mouse3DKeys may be passed to this function.
+    With QExtMouse3DEventProvider::PostedDelivery, the event is queued
+    behind the motions that are waiting to be delivered.
 
     \sa keyRelease()
 */
 void QExtMouse3DDevice::keyPress(int key)
 {
     Q_D(QExtMouse3DDevice);
-    if (d->widget) {
+    QExtMouse3DDeviceList *list = deviceList();
+    if (!list)
+        return;
+    QExtMouse3DEventProvider *provider = d->provider;
+    QWidget *widget = d->widget;
+    list->boundTarget(this, &provider, &widget);
+    if (widget && !list->postKey(provider, widget, QEvent::KeyPress, key)) {
         QKeyEvent event(QEvent::KeyPress, key, Qt::NoModifier);
-        QApplication::sendEvent(d->widget, &event);
+        list->sendEvent(provider, widget, &event);
     }
 }
 
 /*!
     Delivers a key release event to widget() for \a key.  Any of the key codes
     from Qt::Key or QGL::Mouse3DKeys may be passed to this function.
+    With QExtMouse3DEventProvider::PostedDelivery, the event is queued
+    behind the motions that are waiting to be delivered.
 
     \sa keyPress()
 */
 void QExtMouse3DDevice::keyRelease(int key)
 {
     Q_D(QExtMouse3DDevice);
-    if (d->widget) {
+    QExtMouse3DDeviceList *list = deviceList();
+    if (!list)
+        return;
+    QExtMouse3DEventProvider *provider = d->provider;
+    QWidget *widget = d->widget;
+    list->boundTarget(this, &provider, &widget);
+    if (widget && !list->postKey(provider, widget, QEvent::KeyRelease, key)) {
         QKeyEvent event(QEvent::KeyRelease, key, Qt::NoModifier);
-        QApplication::sendEvent(d->widget, &event);
+        list->sendEvent(provider, widget, &event);
+    }
+}
+
+/*!
+    Delivers a key press or release event to widget() for \a key, which
+    was generated by a button on the 3D mouse, depending upon \a press.
+
+    Before a press is delivered, the built-in action for the
+    QGL::Key_Translations, QGL::Key_Rotations, QGL::Key_DominantAxis,
+    QGL::Key_IncreaseSensitivity and QGL::Key_DecreaseSensitivity keys
+    is performed, with toggleFilter() or adjustSensitivity().
+
+    \sa keyPress(), keyRelease()
+*/
+void QExtMouse3DDevice::deviceKey(int key, bool press)
+{
+    if (!press) {
+        keyRelease(key);
+        return;
+    }
+    switch (key) {
+    case QGL::Key_Rotations:
+        toggleFilter(QExtMouse3DEventProvider::Rotations);
+        break;
+    case QGL::Key_Translations:
+        toggleFilter(QExtMouse3DEventProvider::Translations);
+        break;
+    case QGL::Key_DominantAxis:
+        toggleFilter(QExtMouse3DEventProvider::DominantAxis);
+        break;
+    case QGL::Key_IncreaseSensitivity:
+        adjustSensitivity(2.0f);
+        break;
+    case QGL::Key_DecreaseSensitivity:
+        adjustSensitivity(0.5f);
+        break;
+    default: break;
     }
+    keyPress(key);
 }
 
 /*!
@@ -257,8 +599,14 @@ void QExtMouse3DDevice::keyRelease(int key)
 void QExtMouse3DDevice::toggleFilter(QExtMouse3DEventProvider::Filter filter)
 {
     Q_D(QExtMouse3DDevice);
-    if (d->provider && (d->provider->keyFilters() & filter) != 0)
-        d->provider->toggleFilter(filter);
+    QExtMouse3DDeviceList *list = deviceList();
+    if (!list)
+        return;
+    QExtMouse3DEventProvider *provider = d->provider;
+    QWidget *widget = d->widget;
+    list->boundTarget(this, &provider, &widget);
+    if (provider && (list->providerState(provider).keyFilters & filter) != 0)
+        provider->toggleFilter(filter);
 }
 
 /*!
@@ -268,11 +616,17 @@ void QExtMouse3DDevice::toggleFilter(QExtMouse3DEventProvider::Filter filter)
 void QExtMouse3DDevice::adjustSensitivity(qreal factor)
 {
     Q_D(QExtMouse3DDevice);
-    if (d->provider &&
-            (d->provider->keyFilters() &
-                    QExtMouse3DEventProvider::Sensitivity) != 0) {
-        d->provider->setSensitivity(d->provider->sensitivity() * factor);
-    }
+    QExtMouse3DDeviceList *list = deviceList();
+    if (!list)
+        return;
+    QExtMouse3DEventProvider *provider = d->provider;
+    QWidget *widget = d->widget;
+    list->boundTarget(this, &provider, &widget);
+    if (!provider)
+        return;
+    const QExtMouse3DProviderState &state = list->providerState(provider);
+    if ((state.keyFilters & QExtMouse3DEventProvider::Sensitivity) != 0)
+        provider->setSensitivity(state.sensitivity * factor);
 }
 
 static inline short clampRange(int value)
@@ -283,29 +637,66 @@ static inline short clampRange(int value)
 /*!
     Delivers a 3D mouse \a event to widget() after applying filtering for
     rotation-lock, translation-lock, dominant-lock, and mouse sensitivity.
+
+    If the mouse starts moving after being at rest and the provider
+    uses QExtMouse3DEventProvider::PointerRouting, the registered widget
+    under the mouse pointer is made current before \a event is delivered.
+
+    If the provider merges the motions of several mice, \a event is
+    handed to the merge stage instead, which delivers the combined
+    motion of all mice later.  Devices that are bound to a provider
+    with QExtMouse3DEventProvider::setDeviceBinding() always deliver
+    straight to that provider's widget.
+
+    With QExtMouse3DEventProvider::PostedDelivery, \a event is queued
+    and delivered once control returns to the event loop.
 */
 void QExtMouse3DDevice::motion(QExtMouse3DEvent *event)
 {
     Q_D(QExtMouse3DDevice);
-    if (!d->widget || !d->provider)
+    QExtMouse3DDeviceList *list = deviceList();
+    if (!list)
+        return;
+    bool isZero = (event->translateX() == 0 && event->translateY() == 0 &&
+                   event->translateZ() == 0 && event->rotateX() == 0 &&
+                   event->rotateY() == 0 && event->rotateZ() == 0);
+    if (d->atRest && !isZero)
+        list->routeToPointer();
+    d->atRest = isZero;
+    QExtMouse3DEventProvider *provider = d->provider;
+    QWidget *widget = d->widget;
+    bool bound = list->boundTarget(this, &provider, &widget);
+    if (!widget || !provider)
+        return;
+    if (!bound && list->providerState(provider).merging !=
+                        QExtMouse3DEventProvider::NoMerging) {
+        list->mergeMotion(this, event);
+        return;
+    }
+    if (list->postMotion(provider, widget, event, d->axisRanges))
         return;
+    list->deliverMotion(provider, widget, event, d->axisRanges);
+}
+
+/*!
+    Applies \a filters and \a sensitivity to the axis values in \a input,
+    in the order translate X, Y, Z and rotate X, Y, Z, and writes the
+    clamped results to \a output.  This is the filtering that motion()
+    performs, for subclasses that deliver motions on another thread.
+
+    \sa updateMotionSink()
+*/
+void QExtMouse3DDevice::filterMotion
+    (QExtMouse3DEventProvider::Filters filters, qreal sensitivity,
+     const int input[6], short output[6])
+{
     int values[6];
-    qreal sensitivity = d->provider->sensitivity();
-    QExtMouse3DEventProvider::Filters filters = d->provider->filters();
     if ((filters & QExtMouse3DEventProvider::Sensitivity) != 0) {
-        values[0] = int(event->translateX() * sensitivity);
-        values[1] = int(event->translateY() * sensitivity);
-        values[2] = int(event->translateZ() * sensitivity);
-        values[3] = int(event->rotateX() * sensitivity);
-        values[4] = int(event->rotateY() * sensitivity);
-        values[5] = int(event->rotateZ() * sensitivity);
+        for (int index = 0; index < 6; ++index)
+            values[index] = int(input[index] * sensitivity);
     } else {
-        values[0] = event->translateX();
-        values[1] = event->translateY();
-        values[2] = event->translateZ();
-        values[3] = event->rotateX();
-        values[4] = event->rotateY();
-        values[5] = event->rotateZ();
+        for (int index = 0; index < 6; ++index)
+            values[index] = input[index];
     }
     if (!(filters & QExtMouse3DEventProvider::Translations)) {
         values[0] = 0;
@@ -332,13 +723,86 @@ void QExtMouse3DDevice::motion(QExtMouse3DEvent *event)
                 values[index] = 0;
         }
     }
-    QExtMouse3DEvent ev(clampRange(values[0]),
-                     clampRange(values[1]),
-                     clampRange(values[2]),
-                     clampRange(values[3]),
-                     clampRange(values[4]),
-                     clampRange(values[5]));
-    QApplication::sendEvent(d->widget, &ev);
+    for (int index = 0; index < 6; ++index)
+        output[index] = clampRange(values[index]);
+}
+
+/*!
+    Applies \a filters and \a sensitivity to the axis values in \a input
+    like filterMotion(), after dividing each one by the corresponding
+    entry in \a ranges, and writes the results to \a output without
+    rounding or clamping them.  The dominant axis is chosen after the
+    division, so that axes with different ranges compare fairly.
+
+    \sa filterMotion(), axisRange()
+*/
+void QExtMouse3DDevice::filterNormalizedMotion
+    (QExtMouse3DEventProvider::Filters filters, qreal sensitivity,
+     const int input[6], const int ranges[6], qreal output[6])
+{
+    if ((filters & QExtMouse3DEventProvider::Sensitivity) == 0)
+        sensitivity = 1.0f;
+    for (int index = 0; index < 6; ++index)
+        output[index] = input[index] * sensitivity / ranges[index];
+    if (!(filters & QExtMouse3DEventProvider::Translations)) {
+        output[0] = 0.0f;
+        output[1] = 0.0f;
+        output[2] = 0.0f;
+    }
+    if (!(filters & QExtMouse3DEventProvider::Rotations)) {
+        output[3] = 0.0f;
+        output[4] = 0.0f;
+        output[5] = 0.0f;
+    }
+    if (filters & QExtMouse3DEventProvider::DominantAxis) {
+        int largest = 0;
+        qreal value = qAbs(output[0]);
+        for (int index = 1; index < 6; ++index) {
+            qreal value2 = qAbs(output[index]);
+            if (value2 > value) {
+                largest = index;
+                value = value2;
+            }
+        }
+        for (int index = 0; index < 6; ++index) {
+            if (index != largest)
+                output[index] = 0.0f;
+        }
+    }
+}
+
+/*!
+    Records the filtered motion \a values and \a timestamp as the
+    latest motion of \a provider, for
+    QExtMouse3DEventProvider::latestMotion().  motion() does this for
+    the motions that it delivers; subclasses that hand motions to a
+    motion sink on another thread should call it for those.  This
+    function may be called from any thread.
+
+    \sa filterMotion(), updateMotionSink()
+*/
+void QExtMouse3DDevice::publishMotion
+    (QExtMouse3DEventProvider *provider, const short values[6],
+     qint64 timestamp)
+{
+    provider->publishMotion(values, timestamp);
+}
+
+// Returns the device list that this device delivers through, which
+// sets itself on the devices it drives and clears itself when it is
+// destroyed.  The devices only deliver on the list's thread, so this
+// is read without taking the lock that guards the list itself.
+QExtMouse3DDeviceList *QExtMouse3DDevice::deviceList() const
+{
+    Q_D(const QExtMouse3DDevice);
+    Q_ASSERT(!d->list || d->list->thread() == QThread::currentThread());
+    return d->list;
+}
+
+void QExtMouse3DDevice::setDeviceList(QExtMouse3DDeviceList *list)
+{
+    Q_D(QExtMouse3DDevice);
+    d->list = list;
 }
 
 QT_END_NAMESPACE
@@ -54,6 +54,7 @@
 //
 
 #include <QtCore/qobject.h>
+#include <QtCore/qpointer.h>
 #include <QtCore/qstringlist.h>
 #include "qmouse3devent.h"
 #include "qmouse3deventprovider.h"
@@ -65,8 +66,81 @@ QT_BEGIN_NAMESPACE
 QT_MODULE(Qt3d)
 
 class QExtMouse3DDevicePrivate;
+class QExtMouse3DDeviceList;
 class QWidget;
 
+// Settings for threads that read 3D mouse devices in the background.
+struct QExtMouse3DReaderOptions
+{
+    QExtMouse3DReaderOptions()
+        : scheduling(QExtMouse3DEventProvider::NormalScheduling)
+        , priority(0)
+        , busyPollTime(0) {}
+
+    bool operator==(const QExtMouse3DReaderOptions &other) const
+    {
+        return scheduling == other.scheduling &&
+               priority == other.priority &&
+               cpus == other.cpus &&
+               busyPollTime == other.busyPollTime;
+    }
+    bool operator!=(const QExtMouse3DReaderOptions &other) const
+        { return !operator==(other); }
+
+    QExtMouse3DEventProvider::Scheduling scheduling;
+    int priority;
+    QList<int> cpus;
+    int busyPollTime;
+};
+
+// Settings of a QExtMouse3DEventProvider.  The provider copies them
+// under its mutex whenever one changes, and the devices are driven
+// from the copy on the GUI thread, so that providers in other threads
+// can be configured while events are being delivered.  The revision
+// tells an older copy from a newer one.
+struct QExtMouse3DProviderState
+{
+    QExtMouse3DProviderState()
+        : revision(0)
+        , target(0)
+        , filters(QExtMouse3DEventProvider::Translations |
+                  QExtMouse3DEventProvider::Rotations |
+                  QExtMouse3DEventProvider::Sensitivity)
+        , keyFilters(QExtMouse3DEventProvider::AllFilters)
+        , sensitivity(1.0f)
+        , readMode(QExtMouse3DEventProvider::GuiThreadRead)
+        , aggregation(QExtMouse3DEventProvider::LastSample)
+        , keepDevicesOpen(false)
+        , adaptiveCalibration(true)
+        , maximumWakeupRate(0)
+        , routing(QExtMouse3DEventProvider::ActiveWidgetRouting)
+        , merging(QExtMouse3DEventProvider::NoMerging)
+        , delivery(QExtMouse3DEventProvider::SynchronousDelivery)
+        , normalizedMotion(false)
+        , motionSink(0)
+        , motionSinkThread(QExtMouse3DEventProvider::GuiThreadSink) {}
+
+    quint64 revision;
+    QPointer<QObject> target;
+    QExtMouse3DEventProvider::Filters filters;
+    QExtMouse3DEventProvider::Filters keyFilters;
+    qreal sensitivity;
+    QExtMouse3DEventProvider::ReadMode readMode;
+    QExtMouse3DEventProvider::Aggregation aggregation;
+    bool keepDevicesOpen;
+    bool adaptiveCalibration;
+    QExtMouse3DReaderOptions readerOptions;
+    int maximumWakeupRate;
+    QExtMouse3DEventProvider::Routing routing;
+    QExtMouse3DEventProvider::Merging merging;
+    QStringList devicePriority;
+    QStringList deviceBinding;
+    QExtMouse3DEventProvider::Delivery delivery;
+    bool normalizedMotion;
+    QExtMouse3DMotionSink *motionSink;
+    QExtMouse3DEventProvider::SinkThread motionSinkThread;
+};
+
 class Q_QT3D_EXPORT QExtMouse3DDevice : public QObject
 {
     Q_OBJECT
@@ -76,6 +150,8 @@ public:
 
     virtual bool isAvailable() const = 0;
     virtual QStringList deviceNames() const = 0;
+    virtual QList<QExtMouse3DDeviceDescriptor> deviceDescriptors() const;
+    virtual QList<QExtMouse3DDevice *> inputDevices() const;
 
     QExtMouse3DEventProvider *provider() const;
     virtual void setProvider(QExtMouse3DEventProvider *provider);
@@ -83,8 +159,19 @@ public:
     QWidget *widget() const;
     virtual void setWidget(QWidget *widget);
 
+    int axisRange(int axis) const;
+
     virtual void updateFilters(QExtMouse3DEventProvider::Filters filters);
     virtual void updateSensitivity(qreal sensitivity);
+    virtual void updateReadMode(QExtMouse3DEventProvider::ReadMode mode);
+    virtual void updateAggregation
+        (QExtMouse3DEventProvider::Aggregation aggregation);
+    virtual void updateKeepOpen(bool keepOpen);
+    virtual void updateAdaptiveCalibration(bool adaptive);
+    virtual void updateReaderOptions(const QExtMouse3DReaderOptions &options);
+    virtual void updateWakeupRate(int rate);
+    virtual void updateMotionSink(QExtMouse3DMotionSink *sink);
+    virtual void updateDelivery(QExtMouse3DEventProvider::Delivery delivery);
 
     // Used for auto-testing only.
     static QExtMouse3DDevice *testDevice1;
@@ -92,17 +179,38 @@ public:
 
 Q_SIGNALS:
     void availableChanged();
+    void descriptorChanged();
 
 protected:
     void keyPress(int key);
     void keyRelease(int key);
+    void deviceKey(int key, bool press);
     void toggleFilter(QExtMouse3DEventProvider::Filter filter);
     void adjustSensitivity(qreal factor);
     void motion(QExtMouse3DEvent *event);
 
+    void setAxisRanges(const int ranges[6]);
+    void setDeviceInfo(int vendorId, int productId, int buttonCount,
+                       bool hasLcd);
+    void setDroppedSyncs(quint64 count);
+
+    static void filterMotion(QExtMouse3DEventProvider::Filters filters,
+                             qreal sensitivity, const int input[6],
+                             short output[6]);
+    static void filterNormalizedMotion
+        (QExtMouse3DEventProvider::Filters filters, qreal sensitivity,
+         const int input[6], const int ranges[6], qreal output[6]);
+    static void publishMotion(QExtMouse3DEventProvider *provider,
+                              const short values[6], qint64 timestamp);
+
 private:
     QScopedPointer<QExtMouse3DDevicePrivate> d_ptr;
 
+    QExtMouse3DDeviceList *deviceList() const;
+    void setDeviceList(QExtMouse3DDeviceList *list);
+
+    friend class QExtMouse3DDeviceList;
+
     Q_DISABLE_COPY(QExtMouse3DDevice)
     Q_DECLARE_PRIVATE(QExtMouse3DDevice)
 };
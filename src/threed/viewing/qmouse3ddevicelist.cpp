@@ -43,8 +43,12 @@
 #include "qmouse3ddeviceplugin_p.h"
 #include <QtCore/private/qfactoryloader_p.h>
 #include <QtCore/qlibraryinfo.h>
+#include <QtCore/qthread.h>
 #include <QtGui/qwidget.h>
 #include <QtGui/qapplication.h>
+#include <QtGui/qevent.h>
+#include <QtGui/qcursor.h>
+#include <string.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -53,10 +57,23 @@ Q_GLOBAL_STATIC_WITH_ARGS(QFactoryLoader, loader,
     (QExtMouse3DDeviceFactoryInterface_iid, QLatin1String("/mouse3d")))
 #endif
 
+static QExtMouse3DDeviceList *deviceList = 0;
+Q_GLOBAL_STATIC(QMutex, deviceListMutex)
+
 QExtMouse3DDeviceList::QExtMouse3DDeviceList(QObject *parent)
     : QObject(parent)
     , currentWidget(0)
     , currentProvider(0)
+    , devicesWidget(0)
+    , devicesProvider(0)
+    , keepOpenProvider(0)
+    , mergeActivations(0)
+    , mergeTickPending(false)
+    , mergedWasZero(true)
+    , postedHead(0)
+    , postedCount(0)
+    , deliverPostedPending(false)
+    , updateQueuedPending(false)
 {
     ref = 1;
     if (QExtMouse3DDevice::testDevice1) {
@@ -64,11 +81,19 @@ QExtMouse3DDeviceList::QExtMouse3DDeviceList(QObject *parent)
         devices.append(QExtMouse3DDevice::testDevice1);
         connect(QExtMouse3DDevice::testDevice1, SIGNAL(availableChanged()),
                 this, SLOT(availableDeviceChanged()));
+        connect(QExtMouse3DDevice::testDevice1, SIGNAL(descriptorChanged()),
+                this, SLOT(updateRegistry()));
         if (QExtMouse3DDevice::testDevice2) {
             devices.append(QExtMouse3DDevice::testDevice2);
+            connect(QExtMouse3DDevice::testDevice2,
+                    SIGNAL(availableChanged()),
+                    this, SLOT(updateRegistry()));
             connect(QExtMouse3DDevice::testDevice2,
                     SIGNAL(availableChanged()),
                     this, SIGNAL(availableChanged()));
+            connect(QExtMouse3DDevice::testDevice2,
+                    SIGNAL(descriptorChanged()),
+                    this, SLOT(updateRegistry()));
         }
     } else {
 #if !defined (QT_NO_LIBRARY) && !defined(QT_NO_SETTINGS)
@@ -84,28 +109,59 @@ QExtMouse3DDeviceList::QExtMouse3DDeviceList(QObject *parent)
                     device->setParent(this);
                     connect(device, SIGNAL(availableChanged()),
                             this, SLOT(availableDeviceChanged()));
+                    connect(device, SIGNAL(descriptorChanged()),
+                            this, SLOT(updateRegistry()));
                 }
             }
         }
     }
 #endif
+    for (int index = 0; index < devices.size(); ++index)
+        devices.at(index)->setDeviceList(this);
+    updateRegistry();
 }
 
 QExtMouse3DDeviceList::~QExtMouse3DDeviceList()
 {
+    // Devices that outlive the list, such as the ones for auto-testing,
+    // must not deliver through it any more.
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDevice *device = devices.at(index);
+        device->setDeviceList(0);
+        QList<QExtMouse3DDevice *> inputs = device->inputDevices();
+        for (int input = 0; input < inputs.size(); ++input)
+            inputs.at(input)->setDeviceList(0);
+    }
 }
 
 void QExtMouse3DDeviceList::attachWidget
     (QExtMouse3DEventProvider *provider, QWidget *widget)
 {
+    // Providers in other threads wait for the list's thread to do it.
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod
+            (this, "attachQueued", Qt::BlockingQueuedConnection,
+             Q_ARG(QObject *, provider), Q_ARG(QWidget *, widget));
+        return;
+    }
+
     // Add the (widget, provider) pair to the map.
     if (widgets.contains(widget)) {
         qWarning("QExtMouse3DEventProvider: multiple providers for single widget");
         return;
     }
+    // A provider in another thread is blocked until we return, so its
+    // settings cannot change while they are copied.
     widgets.insert(widget, provider);
+    states.insert(provider, provider->state());
+    const QExtMouse3DProviderState &state = states[provider];
+    if (state.routing == QExtMouse3DEventProvider::PointerRouting)
+        indexWidget(widget);
+    if (!state.deviceBinding.isEmpty())
+        applyBinding(provider, state.deviceBinding);
 
-    // Install an event filter to track window activate/deactivate events.
+    // Install an event filter to track window activate/deactivate events,
+    // and the geometry of widgets that are routed to by the pointer.
     widget->installEventFilter(this);
 
     // If the widget is already active, then set it as the current widget.
@@ -118,6 +174,13 @@ void QExtMouse3DDeviceList::attachWidget
 void QExtMouse3DDeviceList::detachWidget
     (QExtMouse3DEventProvider *provider, QWidget *widget)
 {
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod
+            (this, "detachQueued", Qt::BlockingQueuedConnection,
+             Q_ARG(QObject *, provider), Q_ARG(QWidget *, widget));
+        return;
+    }
+
     // Check that this is the provider that was registered for the widget.
     QExtMouse3DEventProvider *prov = widgets.value(widget, 0);
     if (prov != provider)
@@ -125,13 +188,24 @@ void QExtMouse3DDeviceList::detachWidget
 
     // Remove the widget from the map.
     widgets.remove(widget);
+    pointerWidgets.remove(widget);
+    bool wasBound = !boundWidgets.isEmpty();
+    unbindProvider(provider);
+    removePosted(widget);
+    if (QExtMouse3DTargetQueue *queue = targetQueues.take(provider))
+        queue->deleteLater();
 
     // Remove the window activate/deactivate event filter.
     widget->removeEventFilter(this);
 
     // If this was the current widget, then deactivate the device.
-    if (currentWidget == widget)
+    // If the devices were only kept open for this widget's bound
+    // devices, let them go or hand them to another bound widget.
+    if (currentWidget == widget || devicesWidget == widget)
         setWidget(0, 0);
+    else if (wasBound && boundWidgets.isEmpty())
+        setWidget(currentProvider, currentWidget);
+    states.remove(provider);
 }
 
 void QExtMouse3DDeviceList::setWidget
@@ -139,19 +213,126 @@ void QExtMouse3DDeviceList::setWidget
 {
     currentProvider = provider;
     currentWidget = widget;
+    if (!provider) {
+        // The devices start again from rest when a widget is activated.
+        mergeStates.clear();
+        mergedWasZero = true;
+    }
+
+    // Devices that are bound to a provider deliver to it even when
+    // none of our widgets are active, so keep the devices going with
+    // the state of one of the bound providers in that case.
+    if (!provider && !boundWidgets.isEmpty()) {
+        devicesProvider = boundWidgets.constBegin().key();
+        devicesWidget = boundWidgets.constBegin().value();
+    } else {
+        devicesProvider = provider;
+        devicesWidget = widget;
+    }
     for (int index = 0; index < devices.size(); ++index) {
         QExtMouse3DDevice *device = devices.at(index);
-        if (device->isAvailable()) {
-            device->setProvider(provider);
-            device->setWidget(widget);
-            if (provider) {
-                device->updateFilters(provider->filters());
-                device->updateSensitivity(provider->sensitivity());
-            } else {
-                device->updateFilters(QExtMouse3DEventProvider::Translations |
-                                      QExtMouse3DEventProvider::Rotations);
-                device->updateSensitivity(1.0f);
-            }
+        if (device->isAvailable())
+            updateDevice(device);
+    }
+}
+
+// Returns true if the input of \a input, one of the inputDevices() of
+// a device, goes to a provider that has bound it.
+bool QExtMouse3DDeviceList::isBound(QExtMouse3DDevice *input) const
+{
+    return boundNames.contains(input->deviceNames().value(0));
+}
+
+// Returns the devices that are filtered with the settings of
+// \a provider: all of them while it is the current provider and no
+// mouse is bound.  Bound mice pass all axes on to the provider they
+// are bound to at full sensitivity, and that provider's filters are
+// applied on delivery, so while any mouse is bound only the inputs of
+// the mice that are not are returned.
+QList<QExtMouse3DDevice *> QExtMouse3DDeviceList::filteredDevices
+    (QExtMouse3DEventProvider *provider) const
+{
+    QList<QExtMouse3DDevice *> filtered;
+    if (!provider || provider != devicesProvider || provider != currentProvider)
+        return filtered;
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDevice *device = devices.at(index);
+        if (!device->isAvailable())
+            continue;
+        if (boundWidgets.isEmpty()) {
+            filtered.append(device);
+            continue;
+        }
+        QList<QExtMouse3DDevice *> inputs = device->inputDevices();
+        for (int input = 0; input < inputs.size(); ++input) {
+            if (!isBound(inputs.at(input)))
+                filtered.append(inputs.at(input));
+        }
+    }
+    return filtered;
+}
+
+// Tells a device the current provider, widget, and provider state.
+void QExtMouse3DDeviceList::updateDevice(QExtMouse3DDevice *device)
+{
+    // The reader options and read mode are applied before the widget so
+    // that a device which opens itself in setWidget() starts out in the
+    // right mode.
+    // When the widget is cleared, the device keeps the last keep-open
+    // state so that it knows whether to close or pause itself, until
+    // keepOpenProvider clears the setting or is destroyed.
+    if (devicesProvider) {
+        const QExtMouse3DProviderState &state = providerState(devicesProvider);
+        device->updateReaderOptions(state.readerOptions);
+        device->updateReadMode(state.readMode);
+        device->updateWakeupRate(state.maximumWakeupRate);
+        device->updateKeepOpen(state.keepDevicesOpen);
+        keepOpenProvider.fetchAndStoreOrdered
+            (state.keepDevicesOpen ? devicesProvider : 0);
+        device->updateAdaptiveCalibration(state.adaptiveCalibration);
+    }
+    // Devices that deliver the input of another one, which it may have
+    // created since the last time, find the list through it.
+    QList<QExtMouse3DDevice *> inputs = device->inputDevices();
+    for (int index = 0; index < inputs.size(); ++index)
+        inputs.at(index)->setDeviceList(this);
+    device->setProvider(devicesProvider);
+    device->setWidget(devicesWidget);
+
+    // Mice that are bound, and all of them while only bound providers
+    // hold the devices, are neutral; the rest have the settings of the
+    // current provider.
+    bool current = (devicesProvider && devicesProvider == currentProvider);
+    if (boundWidgets.isEmpty()) {
+        inputs.clear();
+        inputs.append(device);
+    }
+    for (int index = 0; index < inputs.size(); ++index) {
+        QExtMouse3DDevice *input = inputs.at(index);
+        if (current && (boundWidgets.isEmpty() || !isBound(input))) {
+            const QExtMouse3DProviderState &state =
+                providerState(devicesProvider);
+            input->updateFilters(state.filters);
+            input->updateSensitivity(state.sensitivity);
+            input->updateAggregation(state.aggregation);
+            if (state.motionSinkThread ==
+                    QExtMouse3DEventProvider::ReaderThreadSink)
+                input->updateMotionSink(state.motionSink);
+            else
+                input->updateMotionSink(0);
+            input->updateDelivery(state.delivery);
+        } else {
+            input->updateFilters(QExtMouse3DEventProvider::Translations |
+                                 QExtMouse3DEventProvider::Rotations);
+            input->updateSensitivity(1.0f);
+            input->updateAggregation(QExtMouse3DEventProvider::LastSample);
+            input->updateMotionSink(0);
+
+            // Bound providers that batch their motions need every sample.
+            if (devicesProvider)
+                input->updateDelivery(QExtMouse3DEventProvider::BatchedDelivery);
+            else
+                input->updateDelivery(QExtMouse3DEventProvider::SynchronousDelivery);
         }
     }
 }
@@ -159,33 +340,297 @@ void QExtMouse3DDeviceList::setWidget
 void QExtMouse3DDeviceList::updateFilters
     (QExtMouse3DEventProvider *provider, QExtMouse3DEventProvider::Filters value)
 {
-    if (currentProvider == provider) {
+    if (queueUpdate(provider))
+        return;
+    QList<QExtMouse3DDevice *> filtered = filteredDevices(provider);
+    for (int index = 0; index < filtered.size(); ++index)
+        filtered.at(index)->updateFilters(value);
+}
+
+void QExtMouse3DDeviceList::updateSensitivity
+    (QExtMouse3DEventProvider *provider, qreal value)
+{
+    if (queueUpdate(provider))
+        return;
+    QList<QExtMouse3DDevice *> filtered = filteredDevices(provider);
+    for (int index = 0; index < filtered.size(); ++index)
+        filtered.at(index)->updateSensitivity(value);
+}
+
+void QExtMouse3DDeviceList::updateReadMode
+    (QExtMouse3DEventProvider *provider,
+     QExtMouse3DEventProvider::ReadMode value)
+{
+    if (queueUpdate(provider))
+        return;
+    if (devicesProvider == provider) {
         for (int index = 0; index < devices.size(); ++index) {
             QExtMouse3DDevice *device = devices.at(index);
             if (device->isAvailable())
-                device->updateFilters(value);
+                device->updateReadMode(value);
         }
     }
 }
 
-void QExtMouse3DDeviceList::updateSensitivity
-    (QExtMouse3DEventProvider *provider, qreal value)
+void QExtMouse3DDeviceList::updateAggregation
+    (QExtMouse3DEventProvider *provider,
+     QExtMouse3DEventProvider::Aggregation value)
 {
-    if (currentProvider == provider) {
+    if (queueUpdate(provider))
+        return;
+    QList<QExtMouse3DDevice *> filtered = filteredDevices(provider);
+    for (int index = 0; index < filtered.size(); ++index)
+        filtered.at(index)->updateAggregation(value);
+}
+
+void QExtMouse3DDeviceList::updateKeepOpen
+    (QExtMouse3DEventProvider *provider, bool value)
+{
+    if (queueUpdate(provider))
+        return;
+    if (devicesProvider == provider) {
+        keepOpenProvider.fetchAndStoreOrdered(value ? provider : 0);
         for (int index = 0; index < devices.size(); ++index) {
             QExtMouse3DDevice *device = devices.at(index);
             if (device->isAvailable())
-                device->updateSensitivity(value);
+                device->updateKeepOpen(value);
         }
+    } else if (!value && keepOpenProvider.testAndSetOrdered(provider, 0)) {
+        // The devices were paused for this provider after its widget
+        // went away, and nothing else needs them any more.
+        releaseDevices();
     }
 }
 
-static QExtMouse3DDeviceList *deviceList = 0;
+// Closes the devices that were paused for a provider that no longer
+// wants them kept open, unless another provider is using them.
+void QExtMouse3DDeviceList::releaseDevices()
+{
+    if (devicesProvider)
+        return;
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDevice *device = devices.at(index);
+        if (device->isAvailable())
+            device->updateKeepOpen(false);
+    }
+}
+
+void QExtMouse3DDeviceList::updateAdaptiveCalibration
+    (QExtMouse3DEventProvider *provider, bool value)
+{
+    if (queueUpdate(provider))
+        return;
+    if (devicesProvider == provider) {
+        for (int index = 0; index < devices.size(); ++index) {
+            QExtMouse3DDevice *device = devices.at(index);
+            if (device->isAvailable())
+                device->updateAdaptiveCalibration(value);
+        }
+    }
+}
+
+void QExtMouse3DDeviceList::updateReaderOptions
+    (QExtMouse3DEventProvider *provider, const QExtMouse3DReaderOptions &value)
+{
+    if (queueUpdate(provider))
+        return;
+    if (devicesProvider == provider) {
+        for (int index = 0; index < devices.size(); ++index) {
+            QExtMouse3DDevice *device = devices.at(index);
+            if (device->isAvailable())
+                device->updateReaderOptions(value);
+        }
+    }
+}
+
+void QExtMouse3DDeviceList::updateWakeupRate
+    (QExtMouse3DEventProvider *provider, int value)
+{
+    if (queueUpdate(provider))
+        return;
+    if (devicesProvider == provider) {
+        for (int index = 0; index < devices.size(); ++index) {
+            QExtMouse3DDevice *device = devices.at(index);
+            if (device->isAvailable())
+                device->updateWakeupRate(value);
+        }
+    }
+}
+
+void QExtMouse3DDeviceList::updateMotionSink
+    (QExtMouse3DEventProvider *provider, QExtMouse3DMotionSink *value)
+{
+    if (queueUpdate(provider)) {
+        // The caller may destroy the previous sink as soon as we
+        // return, so wait until the devices have let go of it.
+        QMetaObject::invokeMethod
+            (this, "updateQueued", Qt::BlockingQueuedConnection);
+        return;
+    }
+    QList<QExtMouse3DDevice *> filtered = filteredDevices(provider);
+    for (int index = 0; index < filtered.size(); ++index)
+        filtered.at(index)->updateMotionSink(value);
+}
+
+void QExtMouse3DDeviceList::updateDelivery
+    (QExtMouse3DEventProvider *provider,
+     QExtMouse3DEventProvider::Delivery value)
+{
+    if (queueUpdate(provider))
+        return;
+    QList<QExtMouse3DDevice *> filtered = filteredDevices(provider);
+    for (int index = 0; index < filtered.size(); ++index)
+        filtered.at(index)->updateDelivery(value);
+}
+
+void QExtMouse3DDeviceList::updateRouting
+    (QExtMouse3DEventProvider *provider,
+     QExtMouse3DEventProvider::Routing value)
+{
+    if (queueUpdate(provider))
+        return;
+    applyRouting(provider, value);
+}
 
+void QExtMouse3DDeviceList::updateBinding
+    (QExtMouse3DEventProvider *provider, const QStringList &value)
+{
+    if (queueUpdate(provider))
+        return;
+    applyBinding(provider, value);
+}
+
+// Records a change to the settings of \a provider that are only used
+// while delivering events, such as the delivery mode or the target.
+void QExtMouse3DDeviceList::updateState(QExtMouse3DEventProvider *provider)
+{
+    queueUpdate(provider);
+}
+
+// Adds the widget of \a provider to the pointer index or removes it,
+// whether it is the current widget or not.
+void QExtMouse3DDeviceList::applyRouting
+    (QExtMouse3DEventProvider *provider,
+     QExtMouse3DEventProvider::Routing value)
+{
+    QWidget *widget = widgets.key(provider, 0);
+    if (!widget)
+        return;
+    if (value == QExtMouse3DEventProvider::PointerRouting)
+        indexWidget(widget);
+    else
+        pointerWidgets.remove(widget);
+}
+
+// Binds the device names in \a value to \a provider.  A name that
+// another provider has already bound stays with that provider.
+void QExtMouse3DDeviceList::applyBinding
+    (QExtMouse3DEventProvider *provider, const QStringList &value)
+{
+    QWidget *widget = widgets.key(provider, 0);
+    if (!widget)
+        return;
+    bool changed = unbindProvider(provider);
+    for (int index = 0; index < value.size(); ++index) {
+        const QString &name = value.at(index);
+        QExtMouse3DEventProvider *owner = boundNames.value(name, 0);
+        if (owner && owner != provider) {
+            qWarning("QExtMouse3DEventProvider: %s is already bound to another provider",
+                     qPrintable(name));
+            continue;
+        }
+        boundNames.insert(name, provider);
+    }
+    if (!value.isEmpty()) {
+        boundWidgets.insert(provider, widget);
+        changed = true;
+    }
+
+    // Open or close the devices if nothing else is holding them, and
+    // move the mice whose binding changed between the neutral settings
+    // and those of the current provider.
+    if (changed)
+        setWidget(currentProvider, currentWidget);
+}
+
+// Removes the device names that \a provider has bound.  Returns false
+// if it had not bound any.
+bool QExtMouse3DDeviceList::unbindProvider(QExtMouse3DEventProvider *provider)
+{
+    if (!boundWidgets.remove(provider))
+        return false;
+    QHash<QString, QExtMouse3DEventProvider *>::Iterator it = boundNames.begin();
+    while (it != boundNames.end()) {
+        if (it.value() == provider)
+            it = boundNames.erase(it);
+        else
+            ++it;
+    }
+    boundDevices.clear();
+    return true;
+}
+
+// Finds the provider and widget that input from \a device should go to.
+// If the device's name is bound to a provider with
+// QExtMouse3DEventProvider::setDeviceBinding(), they are returned in
+// \a provider and \a widget along with true.  Otherwise the current
+// provider and widget are returned, which are null when the devices
+// are only open because of other bound devices.
+bool QExtMouse3DDeviceList::boundTarget
+    (QExtMouse3DDevice *device, QExtMouse3DEventProvider **provider,
+     QWidget **widget)
+{
+    if (boundWidgets.isEmpty())
+        return false;
+
+    // The provider for each device is looked up once per binding change.
+    QExtMouse3DEventProvider *bound;
+    QHash<QExtMouse3DDevice *, QExtMouse3DEventProvider *>::ConstIterator it =
+        boundDevices.constFind(device);
+    if (it != boundDevices.constEnd()) {
+        bound = it.value();
+    } else {
+        bound = boundNames.value(device->deviceNames().value(0), 0);
+        boundDevices.insert(device, bound);
+        connect(device, SIGNAL(destroyed(QObject*)),
+                this, SLOT(deviceDestroyed(QObject*)),
+                Qt::UniqueConnection);
+    }
+    if (bound) {
+        *provider = bound;
+        *widget = boundWidgets.value(bound);
+        return true;
+    }
+    *provider = currentProvider;
+    *widget = currentWidget;
+    return false;
+}
+
+// Records the rectangle that a pointer-routed widget covers in its
+// window, or removes it from the index while it is hidden.
+void QExtMouse3DDeviceList::indexWidget(QWidget *widget)
+{
+    if (widget->isVisible()) {
+        QWidget *window = widget->window();
+        pointerWidgets.insert
+            (widget, window,
+             QRect(widget->mapTo(window, QPoint(0, 0)), widget->size()));
+    } else {
+        pointerWidgets.remove(widget);
+    }
+}
+
+// Providers can be created and destroyed in any thread, but the list
+// always lives in the GUI thread because the devices and the widget
+// event filter need it.
 QExtMouse3DDeviceList *QExtMouse3DDeviceList::attach()
 {
+    QMutexLocker locker(deviceListMutex());
     if (!deviceList) {
         deviceList = new QExtMouse3DDeviceList();
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && deviceList->thread() != app->thread())
+            deviceList->moveToThread(app->thread());
         return deviceList;
     }
     deviceList->ref.ref();
@@ -194,10 +639,113 @@ QExtMouse3DDeviceList *QExtMouse3DDeviceList::attach()
 
 void QExtMouse3DDeviceList::detach(QExtMouse3DDeviceList *list)
 {
+    QMutexLocker locker(deviceListMutex());
     if (!list->ref.deref()) {
-        delete list;
         deviceList = 0;
+        if (list->thread() == QThread::currentThread())
+            delete list;
+        else
+            list->deleteLater();
+    }
+}
+
+// Returns the copy of the settings of \a provider that events are
+// delivered with.  Only providers that have a widget have one.
+const QExtMouse3DProviderState &QExtMouse3DDeviceList::providerState
+    (QExtMouse3DEventProvider *provider) const
+{
+    QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState>::ConstIterator
+        it = states.constFind(provider);
+    Q_ASSERT(it != states.constEnd());
+    return it.value();
+}
+
+void QExtMouse3DDeviceList::attachQueued(QObject *provider, QWidget *widget)
+{
+    attachWidget(static_cast<QExtMouse3DEventProvider *>(provider), widget);
+}
+
+void QExtMouse3DDeviceList::detachQueued(QObject *provider, QWidget *widget)
+{
+    detachWidget(static_cast<QExtMouse3DEventProvider *>(provider), widget);
+}
+
+// Called by the update functions before they touch the devices, on
+// the thread that changed the settings of \a provider, to take a copy
+// of them there.  The copy is queued for updateQueued() if that is not
+// the list's thread.  Returns false if the caller should apply the
+// change itself.
+bool QExtMouse3DDeviceList::queueUpdate(QExtMouse3DEventProvider *provider)
+{
+    QExtMouse3DProviderState state = provider->state();
+    if (QThread::currentThread() == thread()) {
+        QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState>::Iterator
+            it = states.find(provider);
+        if (it != states.end())
+            it.value() = state;
+        return false;
+    }
+    QMutexLocker locker(&updateMutex);
+    queuedStates.insert(provider, state);
+    if (!updateQueuedPending) {
+        updateQueuedPending = true;
+        QMetaObject::invokeMethod(this, "updateQueued", Qt::QueuedConnection);
     }
+    return true;
+}
+
+// Applies the queued settings of each provider that was changed from
+// another thread, as if each of its setters had been called here.
+// Settings that were changed on this thread in the meantime, by the
+// keys of a device, are newer and are kept.
+void QExtMouse3DDeviceList::updateQueued()
+{
+    QMutexLocker locker(&updateMutex);
+    updateQueuedPending = false;
+    QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState>::ConstIterator it;
+    for (it = queuedStates.constBegin(); it != queuedStates.constEnd(); ++it) {
+        QExtMouse3DEventProvider *provider = it.key();
+        QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState>::Iterator
+            current = states.find(provider);
+        if (current == states.end()) {
+            // Copied again when it gets a widget.  Until then, it can
+            // only let go of the devices that it kept open.
+            if (!it.value().keepDevicesOpen &&
+                    keepOpenProvider.testAndSetOrdered(provider, 0))
+                releaseDevices();
+            continue;
+        }
+        QStringList binding = current.value().deviceBinding;
+        if (current.value().revision < it.value().revision)
+            current.value() = it.value();
+        const QExtMouse3DProviderState &state = current.value();
+        applyRouting(provider, state.routing);
+        if (state.deviceBinding != binding)
+            applyBinding(provider, state.deviceBinding);
+        if (provider != devicesProvider)
+            continue;
+        for (int index = 0; index < devices.size(); ++index) {
+            QExtMouse3DDevice *device = devices.at(index);
+            if (device->isAvailable())
+                updateDevice(device);
+        }
+    }
+    queuedStates.clear();
+}
+
+// Called by the provider's destructor, on whichever thread that runs.
+// The devices that it kept open after its widget went away are closed.
+void QExtMouse3DDeviceList::removeProvider(QExtMouse3DEventProvider *provider)
+{
+    QMutexLocker locker(&updateMutex);
+    queuedStates.remove(provider);
+    locker.unlock();
+    if (!keepOpenProvider.testAndSetOrdered(provider, 0))
+        return;
+    if (QThread::currentThread() == thread())
+        releaseDevices();
+    else
+        QMetaObject::invokeMethod(this, "releaseDevices", Qt::QueuedConnection);
 }
 
 void QExtMouse3DDeviceList::availableDeviceChanged()
@@ -206,37 +754,586 @@ void QExtMouse3DDeviceList::availableDeviceChanged()
     if (device && device->isAvailable()) {
         // Newly available devices need to be told the provider,
         // widget, filter state, and sensitivity state.
-        device->setProvider(currentProvider);
-        device->setWidget(currentWidget);
-        if (currentProvider) {
-            device->updateFilters(currentProvider->filters());
-            device->updateSensitivity(currentProvider->sensitivity());
+        updateDevice(device);
+    }
+    updateRegistry();
+    emit availableChanged();
+}
+
+// Rebuilds the registry from the available devices.  This is the
+// only place that queries the devices for their names and descriptors.
+void QExtMouse3DDeviceList::updateRegistry()
+{
+    // A device may report another name once it is available.
+    boundDevices.clear();
+
+    Registry registry;
+    for (int index = 0; index < devices.size(); ++index) {
+        QExtMouse3DDevice *device = devices.at(index);
+        if (!device->isAvailable())
+            continue;
+        registry.available = true;
+        registry.names += device->deviceNames();
+        registry.descriptors += device->deviceDescriptors();
+    }
+    QMutexLocker locker(&registryMutex);
+    registry.generation = currentRegistry.generation + 1;
+    currentRegistry = registry;
+}
+
+// Returns a copy of the registry, which shares its lists with the
+// registry until the next rebuild, so this is cheap from any thread.
+QExtMouse3DDeviceList::Registry QExtMouse3DDeviceList::registry() const
+{
+    QMutexLocker locker(&registryMutex);
+    return currentRegistry;
+}
+
+// Called by QExtMouse3DDevice::motion() when the mouse starts moving
+// after being at rest.  If the current provider routes by the pointer,
+// the registered widget under the pointer in the same window becomes
+// the current widget.
+void QExtMouse3DDeviceList::routeToPointer()
+{
+    if (!currentWidget || pointerWidgets.isEmpty())
+        return;
+    if (providerState(currentProvider).routing !=
+            QExtMouse3DEventProvider::PointerRouting)
+        return;
+    QWidget *window = currentWidget->window();
+    QPoint pos = window->mapFromGlobal(QCursor::pos());
+    QWidget *widget = pointerWidgets.widgetAt(window, pos);
+    if (!widget || !widget->rect().contains(widget->mapFrom(window, pos))) {
+        // Moving an ancestor does not send a move event to the widget,
+        // so the index can be out of date, either with a widget that
+        // has moved away from the pointer or with none where one has
+        // moved under it.  Refresh this window's rectangles and look
+        // again.
+        QList<QWidget *> stale = pointerWidgets.widgets(window);
+        for (int index = 0; index < stale.size(); ++index)
+            indexWidget(stale.at(index));
+        widget = pointerWidgets.widgetAt(window, pos);
+    }
+    if (widget && widget != currentWidget)
+        setWidget(widgets.value(widget), widget);
+}
+
+// Called by QExtMouse3DDevice::motion() when the current provider
+// merges the motions of several devices.  Records the deflection of
+// \a device and arranges for mergeTick() to deliver the combined
+// motion once control returns to the event loop.
+void QExtMouse3DDeviceList::mergeMotion
+    (QExtMouse3DDevice *device, QExtMouse3DEvent *event)
+{
+    int index = 0;
+    while (index < mergeStates.size() &&
+           mergeStates.at(index).device != device)
+        ++index;
+    if (index == mergeStates.size()) {
+        MergeState state;
+        state.device = device;
+        memset(state.values, 0, sizeof(state.values));
+        state.timestamp = 0;
+        state.activeSince = 0;
+        mergeStates.append(state);
+        connect(device, SIGNAL(destroyed(QObject*)),
+                this, SLOT(deviceDestroyed(QObject*)),
+                Qt::UniqueConnection);
+    }
+    MergeState &state = mergeStates[index];
+    int values[6] = {event->translateX(), event->translateY(),
+                     event->translateZ(), event->rotateX(),
+                     event->rotateY(), event->rotateZ()};
+    bool wasZero = true;
+    bool isZero = true;
+    for (int axis = 0; axis < 6; ++axis) {
+        wasZero = wasZero && state.values[axis] == 0;
+        isZero = isZero && values[axis] == 0;
+        state.values[axis] = values[axis];
+    }
+    if (wasZero && !isZero)
+        state.activeSince = ++mergeActivations;
+    state.timestamp = event->timestamp();
+    if (!mergeTickPending) {
+        mergeTickPending = true;
+        QMetaObject::invokeMethod(this, "mergeTick", Qt::QueuedConnection);
+    }
+}
+
+// Delivers the combined motion of all devices to the current widget,
+// or queues it like the motion of a single device with PostedDelivery
+// and BatchedDelivery.
+void QExtMouse3DDeviceList::mergeTick()
+{
+    mergeTickPending = false;
+    if (!currentProvider || !currentWidget)
+        return;
+    const QExtMouse3DProviderState &state = providerState(currentProvider);
+    QExtMouse3DEventProvider::Merging merging = state.merging;
+    const QStringList &priority = state.devicePriority;
+    qint64 sums[6] = {0, 0, 0, 0, 0, 0};
+    qint64 timestamp = 0;
+    int chosen = -1;
+    int chosenRank = 0;
+    int ranges[6] = {1, 1, 1, 1, 1, 1};
+    for (int index = 0; index < mergeStates.size(); ++index) {
+        const MergeState &state = mergeStates.at(index);
+        timestamp = qMax(timestamp, state.timestamp);
+        if (merging == QExtMouse3DEventProvider::SumMerging) {
+            // The sum is normalized with the widest range of the
+            // devices, so that no single device exceeds 1.0.
+            for (int axis = 0; axis < 6; ++axis) {
+                sums[axis] += state.values[axis];
+                ranges[axis] =
+                    qMax(ranges[axis], state.device->axisRange(axis));
+            }
+            continue;
+        }
+        bool isZero = true;
+        for (int axis = 0; axis < 6 && isZero; ++axis)
+            isZero = (state.values[axis] == 0);
+        if (isZero)
+            continue;
+        int rank;
+        if (merging == QExtMouse3DEventProvider::PriorityMerging) {
+            // Unlisted devices rank after the listed ones in the
+            // order that they were first moved.
+            rank = priority.indexOf(state.device->deviceNames().value(0));
+            if (rank < 0)
+                rank = priority.size() + index;
         } else {
-            device->updateFilters(QExtMouse3DEventProvider::Translations |
-                                  QExtMouse3DEventProvider::Rotations);
-            device->updateSensitivity(1.0f);
+            rank = -state.activeSince;
+        }
+        if (chosen < 0 || rank < chosenRank) {
+            chosen = index;
+            chosenRank = rank;
         }
     }
-    emit availableChanged();
+    if (chosen >= 0) {
+        const MergeState &state = mergeStates.at(chosen);
+        for (int axis = 0; axis < 6; ++axis) {
+            sums[axis] = state.values[axis];
+            ranges[axis] = state.device->axisRange(axis);
+        }
+        timestamp = state.timestamp;
+    }
+
+    // Only deliver the first of a run of zero motions, like the devices do.
+    bool isZero = true;
+    for (int axis = 0; axis < 6 && isZero; ++axis)
+        isZero = (sums[axis] == 0);
+    if (isZero && mergedWasZero)
+        return;
+    mergedWasZero = isZero;
+
+    int values[6];
+    for (int axis = 0; axis < 6; ++axis)
+        values[axis] = int(qBound(qint64(-32768), sums[axis], qint64(32767)));
+    QExtMouse3DEvent event(values[0], values[1], values[2],
+                           values[3], values[4], values[5]);
+    event.setTimestamp(timestamp);
+    if (!postMotion(currentProvider, currentWidget, &event, ranges))
+        deliverMotion(currentProvider, currentWidget, &event, ranges);
+}
+
+// Forgets the merge state and binding of a device that is destroyed.
+void QExtMouse3DDeviceList::deviceDestroyed(QObject *device)
+{
+    boundDevices.remove(static_cast<QExtMouse3DDevice *>(device));
+    for (int index = 0; index < mergeStates.size(); ++index) {
+        if (mergeStates.at(index).device == device) {
+            mergeStates.remove(index);
+            break;
+        }
+    }
+}
+
+// Called by QExtMouse3DDevice::motion() before it sends \a event to
+// \a widget.  Queues the motion for deliverPosted() if \a provider uses
+// PostedDelivery or BatchedDelivery, or if earlier events are still
+// waiting so that they keep their order.  A waiting motion for the same
+// widget that has nothing queued behind it is updated in place, or has
+// the motion added to it for BatchedDelivery.  Returns false if the
+// caller should send the event itself.  mergeTick() also posts the
+// merged motion here.
+bool QExtMouse3DDeviceList::postMotion
+    (QExtMouse3DEventProvider *provider, QWidget *widget,
+     QExtMouse3DEvent *event, const int ranges[6])
+{
+    const QExtMouse3DProviderState &state = providerState(provider);
+    if (state.motionSink ||
+            (state.delivery == QExtMouse3DEventProvider::SynchronousDelivery &&
+             !postedCount))
+        return false;
+    bool batched = (state.delivery == QExtMouse3DEventProvider::BatchedDelivery);
+    QEvent::Type type =
+        batched ? QExtMouse3DBatchEvent::type : QExtMouse3DEvent::type;
+    PostedEvent *entry = 0;
+    for (int count = postedCount; count > 0; --count) {
+        PostedEvent *last =
+            &posted[(postedHead + count - 1) % PostedPoolSize];
+        if (last->widget == widget) {
+            if (last->type == type)
+                entry = last;
+            break;
+        }
+    }
+    if (!entry) {
+        entry = queuePosted(provider, widget);
+        entry->type = type;
+        entry->key = 0;
+    }
+    if (batched) {
+        // Filter now, so that each sample sees the filters that were
+        // in effect when the mouse reported it.
+        int input[6] = {event->translateX(), event->translateY(),
+                        event->translateZ(), event->rotateX(),
+                        event->rotateY(), event->rotateZ()};
+        short values[6];
+        QExtMouse3DDevice::filterMotion
+            (state.filters, state.sensitivity, input, values);
+        provider->publishMotion(values, event->timestamp());
+        QExtMouse3DSample sample;
+        sample.translateX = values[0];
+        sample.translateY = values[1];
+        sample.translateZ = values[2];
+        sample.rotateX = values[3];
+        sample.rotateY = values[4];
+        sample.rotateZ = values[5];
+        sample.timestamp = event->timestamp();
+        batchSamples[entry - posted].append(sample);
+        return true;
+    }
+    entry->values[0] = event->translateX();
+    entry->values[1] = event->translateY();
+    entry->values[2] = event->translateZ();
+    entry->values[3] = event->rotateX();
+    entry->values[4] = event->rotateY();
+    entry->values[5] = event->rotateZ();
+    memcpy(entry->ranges, ranges, sizeof(entry->ranges));
+    entry->timestamp = event->timestamp();
+
+    // Like the batches, the motion is filtered with the settings that
+    // were in effect when the mouse reported it, not those that a key
+    // press queued ahead of it has changed by the time it is delivered.
+    entry->filters = state.filters;
+    entry->sensitivity = state.sensitivity;
+    return true;
+}
+
+// Called by QExtMouse3DDevice::keyPress() and keyRelease().  Queues the
+// key event behind any waiting motions, on the same terms as postMotion().
+bool QExtMouse3DDeviceList::postKey
+    (QExtMouse3DEventProvider *provider, QWidget *widget,
+     QEvent::Type type, int key)
+{
+    if (!provider ||
+            (providerState(provider).delivery ==
+                    QExtMouse3DEventProvider::SynchronousDelivery &&
+             !postedCount))
+        return false;
+    PostedEvent *entry = queuePosted(provider, widget);
+    entry->type = type;
+    entry->key = key;
+    memset(entry->values, 0, sizeof(entry->values));
+    entry->timestamp = 0;
+    return true;
+}
+
+// Returns a free entry at the end of the posted ring and makes sure
+// that deliverPosted() will run.  If the ring is full, the waiting
+// events are delivered first.
+QExtMouse3DDeviceList::PostedEvent *QExtMouse3DDeviceList::queuePosted
+    (QExtMouse3DEventProvider *provider, QWidget *widget)
+{
+    if (postedCount == PostedPoolSize)
+        deliverPosted();
+    PostedEvent *entry = &posted[(postedHead + postedCount) % PostedPoolSize];
+    ++postedCount;
+    entry->provider = provider;
+    entry->widget = widget;
+    if (!deliverPostedPending) {
+        deliverPostedPending = true;
+        QMetaObject::invokeMethod(this, "deliverPosted", Qt::QueuedConnection);
+    }
+    return entry;
+}
+
+// Drops the waiting events for \a widget when it is unregistered.
+void QExtMouse3DDeviceList::removePosted(QWidget *widget)
+{
+    int kept = 0;
+    for (int index = 0; index < postedCount; ++index) {
+        const PostedEvent &entry =
+            posted[(postedHead + index) % PostedPoolSize];
+        if (entry.widget == widget) {
+            batchSamples[(postedHead + index) % PostedPoolSize].resize(0);
+            continue;
+        }
+        int slot = (postedHead + kept++) % PostedPoolSize;
+        posted[slot] = entry;
+        qSwap(batchSamples[slot],
+              batchSamples[(postedHead + index) % PostedPoolSize]);
+    }
+    postedCount = kept;
+}
+
+// Delivers the waiting events in the order that they were posted.
+// Each entry leaves the ring before it is sent, so that events posted
+// by the widget's handler queue up behind the rest.
+void QExtMouse3DDeviceList::deliverPosted()
+{
+    deliverPostedPending = false;
+    while (postedCount > 0) {
+        int slot = postedHead;
+        PostedEvent entry = posted[slot];
+        postedHead = (postedHead + 1) % PostedPoolSize;
+        --postedCount;
+        if (entry.type == QExtMouse3DBatchEvent::type) {
+            // The slot may be reused while the event is being handled,
+            // so take its samples out and give the buffer back after.
+            QVector<QExtMouse3DSample> samples;
+            qSwap(samples, batchSamples[slot]);
+            QExtMouse3DBatchEvent event(samples.constData(), samples.size());
+            sendEvent(entry.provider, entry.widget, &event);
+            samples.reserve(samples.size());    // Keep it when emptied.
+            samples.resize(0);
+            if (batchSamples[slot].isEmpty())
+                qSwap(samples, batchSamples[slot]);
+        } else if (entry.type == QExtMouse3DEvent::type) {
+            QExtMouse3DEvent event(entry.values[0], entry.values[1],
+                                   entry.values[2], entry.values[3],
+                                   entry.values[4], entry.values[5]);
+            event.setTimestamp(entry.timestamp);
+            deliverMotion(entry.provider, entry.widget, &event, entry.ranges,
+                          entry.filters, entry.sensitivity);
+        } else {
+            QKeyEvent event(entry.type, entry.key, Qt::NoModifier);
+            sendEvent(entry.provider, entry.widget, &event);
+        }
+    }
+}
+
+// Filters \a event according to the settings of \a provider and sends
+// it to \a widget, or hands it to the provider's motion sink.  The axes
+// of the device that produced \a event reach full deflection at
+// \a ranges.  This is shared by QExtMouse3DDevice::motion() and the
+// merge stage.
+void QExtMouse3DDeviceList::deliverMotion
+    (QExtMouse3DEventProvider *provider, QWidget *widget,
+     QExtMouse3DEvent *event, const int ranges[6])
+{
+    const QExtMouse3DProviderState &state = providerState(provider);
+    deliverMotion(provider, widget, event, ranges,
+                  state.filters, state.sensitivity);
+}
+
+// Same as above, but filters \a event with \a filters and
+// \a sensitivity, which the posting stage took when it was queued.
+void QExtMouse3DDeviceList::deliverMotion
+    (QExtMouse3DEventProvider *provider, QWidget *widget,
+     QExtMouse3DEvent *event, const int ranges[6],
+     QExtMouse3DEventProvider::Filters filters, qreal sensitivity)
+{
+    const QExtMouse3DProviderState &state = providerState(provider);
+    int input[6] = {event->translateX(), event->translateY(),
+                    event->translateZ(), event->rotateX(),
+                    event->rotateY(), event->rotateZ()};
+    short values[6];
+    QExtMouse3DDevice::filterMotion(filters, sensitivity, input, values);
+    provider->publishMotion(values, event->timestamp());
+    if (state.motionSink) {
+        state.motionSink->motion(values, event->timestamp());
+        return;
+    }
+    if (state.normalizedMotion) {
+        qreal normalized[6];
+        QExtMouse3DDevice::filterNormalizedMotion
+            (filters, sensitivity, input, ranges, normalized);
+        QExtMouse3DNormalizedEvent ev(normalized[0], normalized[1],
+                                      normalized[2], normalized[3],
+                                      normalized[4], normalized[5]);
+        ev.setTimestamp(event->timestamp());
+        sendEvent(provider, widget, &ev);
+        return;
+    }
+    QExtMouse3DEvent ev(values[0], values[1], values[2],
+                        values[3], values[4], values[5]);
+    ev.setTimestamp(event->timestamp());
+    sendEvent(provider, widget, &ev);
+}
+
+// Sends \a event to \a widget, or queues a copy of it for the target
+// of \a provider, which may live in another thread.  Motions,
+// normalized motions, batches and key events are the only events
+// passed in here.
+void QExtMouse3DDeviceList::sendEvent
+    (QExtMouse3DEventProvider *provider, QWidget *widget, QEvent *event)
+{
+    if (!providerState(provider).target) {
+        QApplication::sendEvent(widget, event);
+        return;
+    }
+    QEvent *copy;
+    if (event->type() == QExtMouse3DEvent::type) {
+        QExtMouse3DEvent *mouse = static_cast<QExtMouse3DEvent *>(event);
+        QExtMouse3DEvent *ev = new QExtMouse3DEvent
+            (mouse->translateX(), mouse->translateY(), mouse->translateZ(),
+             mouse->rotateX(), mouse->rotateY(), mouse->rotateZ());
+        ev->setTimestamp(mouse->timestamp());
+        copy = ev;
+    } else if (event->type() == QExtMouse3DNormalizedEvent::type) {
+        QExtMouse3DNormalizedEvent *mouse =
+            static_cast<QExtMouse3DNormalizedEvent *>(event);
+        QExtMouse3DNormalizedEvent *ev = new QExtMouse3DNormalizedEvent
+            (mouse->translateX(), mouse->translateY(), mouse->translateZ(),
+             mouse->rotateX(), mouse->rotateY(), mouse->rotateZ());
+        ev->setTimestamp(mouse->timestamp());
+        copy = ev;
+    } else if (event->type() == QExtMouse3DBatchEvent::type) {
+        QExtMouse3DBatchEvent *batch =
+            static_cast<QExtMouse3DBatchEvent *>(event);
+        QVector<QExtMouse3DSample> samples(batch->count());
+        for (int index = 0; index < batch->count(); ++index)
+            samples[index] = batch->at(index);
+        copy = new QExtMouse3DBatchEvent(samples);
+    } else {
+        QKeyEvent *key = static_cast<QKeyEvent *>(event);
+        copy = new QKeyEvent(key->type(), key->key(), key->modifiers());
+    }
+    targetQueue(provider)->post(copy);
+}
+
+// Returns the queue for the current target of \a provider, replacing
+// the one for an earlier target.  Both hold the target with a guarded
+// pointer, so the queue of a destroyed target is never taken for the
+// queue of a new object at the same address.
+QExtMouse3DTargetQueue *QExtMouse3DDeviceList::targetQueue
+    (QExtMouse3DEventProvider *provider)
+{
+    QObject *target = providerState(provider).target;
+    QExtMouse3DTargetQueue *&queue = targetQueues[provider];
+    if (!queue || queue->target() != target) {
+        if (queue)
+            queue->deleteLater();
+        queue = new QExtMouse3DTargetQueue(target);
+    }
+    return queue;
 }
 
 bool QExtMouse3DDeviceList::eventFilter(QObject *watched, QEvent *event)
 {
-    QWidget *widget = qobject_cast<QWidget *>(watched);
+    // The filter sees every event for every registered widget, so get
+    // the paint, mouse and timer events out of the way before the
+    // widget lookup.  The filter is only installed on widgets.
+    QEvent::Type type = event->type();
+    switch (type) {
+    case QEvent::WindowActivate:
+    case QEvent::WindowDeactivate:
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+    case QEvent::ParentChange:
+        break;
+    default:
+        return false;
+    }
+    QWidget *widget = static_cast<QWidget *>(watched);
     QExtMouse3DEventProvider *provider = widgets.value(widget, 0);
-    if (event->type() == QEvent::WindowActivate) {
-        if (provider && widget != currentWidget)
+    if (!provider)
+        return false;
+    if (type == QEvent::WindowActivate) {
+        if (widget != currentWidget)
             setWidget(provider, widget);
-    } else if (event->type() == QEvent::WindowDeactivate) {
-        if (provider && widget == currentWidget) {
+    } else if (type == QEvent::WindowDeactivate) {
+        if (widget == currentWidget) {
             // Post a zero event to the deactivating widget to center
             // any actions that were in progress.
             QExtMouse3DEvent *mouse = new QExtMouse3DEvent(0, 0, 0, 0, 0, 0);
-            QApplication::postEvent(widget, mouse);
+            if (providerState(provider).target)
+                targetQueue(provider)->post(mouse);
+            else
+                QApplication::postEvent(widget, mouse);
             setWidget(0, 0);
         }
+    } else if (providerState(provider).routing ==
+                    QExtMouse3DEventProvider::PointerRouting) {
+        // Keep the widget's rectangle in the pointer index up to date.
+        if (type == QEvent::Hide)
+            pointerWidgets.remove(widget);
+        else
+            indexWidget(widget);
     }
     return false;
 }
 
+QExtMouse3DTargetQueue::QExtMouse3DTargetQueue(QObject *target)
+    : QObject()
+    , receiver(target)
+    , deliverPending(false)
+{
+    moveToThread(target->thread());
+}
+
+QExtMouse3DTargetQueue::~QExtMouse3DTargetQueue()
+{
+    qDeleteAll(events);
+}
+
+// Called on the list's thread.  Takes ownership of \a event.
+void QExtMouse3DTargetQueue::post(QEvent *event)
+{
+    QMutexLocker locker(&mutex);
+    QEvent::Type type = event->type();
+    if (!events.isEmpty() && events.last()->type() == type) {
+        if (type == QExtMouse3DEvent::type ||
+                type == QExtMouse3DNormalizedEvent::type) {
+            delete events.last();
+            events.last() = event;
+            return;
+        }
+        if (type == QExtMouse3DBatchEvent::type) {
+            // Keep every sample: join the batch to the waiting one.
+            QExtMouse3DBatchEvent *last =
+                static_cast<QExtMouse3DBatchEvent *>(events.last());
+            QExtMouse3DBatchEvent *batch =
+                static_cast<QExtMouse3DBatchEvent *>(event);
+            QVector<QExtMouse3DSample> samples;
+            samples.reserve(last->count() + batch->count());
+            for (int index = 0; index < last->count(); ++index)
+                samples.append(last->at(index));
+            for (int index = 0; index < batch->count(); ++index)
+                samples.append(batch->at(index));
+            delete last;
+            delete batch;
+            events.last() = new QExtMouse3DBatchEvent(samples);
+            return;
+        }
+    }
+    events.append(event);
+    if (!deliverPending) {
+        deliverPending = true;
+        QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+}
+
+// Sends the waiting events to the target on the target's thread.
+// The target may have been destroyed since the events were posted,
+// or while one of them was being handled, in which case the rest
+// are dropped.
+void QExtMouse3DTargetQueue::deliver()
+{
+    QList<QEvent *> pending;
+    mutex.lock();
+    qSwap(pending, events);
+    deliverPending = false;
+    mutex.unlock();
+    for (int index = 0; index < pending.size(); ++index) {
+        if (receiver)
+            QCoreApplication::sendEvent(receiver, pending.at(index));
+        delete pending.at(index);
+    }
+}
+
 QT_END_NAMESPACE
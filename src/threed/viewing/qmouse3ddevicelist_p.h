@@ -55,8 +55,12 @@
 
 #include "qmouse3ddevice_p.h"
 #include "qmouse3deventprovider.h"
+#include "qmouse3dwidgetindex_p.h"
 #include <QtCore/qatomic.h>
-#include <QtCore/qmap.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qpointer.h>
+#include <QtCore/qvector.h>
 
 QT_BEGIN_HEADER
 
@@ -64,6 +68,31 @@ QT_BEGIN_NAMESPACE
 
 QT_MODULE(Qt3d)
 
+// Events for the target() of a provider, which may live in another
+// thread.  They wait here until a queued call on the target's thread
+// sends them, and a newer motion replaces a waiting one that has no
+// key event behind it, like in the posted ring of the device list.
+// A slow target thread then does not fall further and further behind.
+class QExtMouse3DTargetQueue : public QObject
+{
+    Q_OBJECT
+public:
+    QExtMouse3DTargetQueue(QObject *target);
+    ~QExtMouse3DTargetQueue();
+
+    QObject *target() const { return receiver; }
+    void post(QEvent *event);
+
+private Q_SLOTS:
+    void deliver();
+
+private:
+    QPointer<QObject> receiver;
+    QMutex mutex;
+    QList<QEvent *> events;
+    bool deliverPending;
+};
+
 class QExtMouse3DDeviceList : public QObject
 {
     Q_OBJECT
@@ -73,19 +102,81 @@ public:
 
     QList<QExtMouse3DDevice *> devices;
 
+    // What the providers report about the devices.  It is rebuilt on
+    // the list's thread when devices come and go, and copied under
+    // the mutex so that it can be read from any thread.
+    struct Registry
+    {
+        Registry() : generation(0), available(false) {}
+
+        quint64 generation;
+        bool available;
+        QStringList names;
+        QList<QExtMouse3DDeviceDescriptor> descriptors;
+    };
+    Registry registry() const;
+
     static QExtMouse3DDeviceList *attach();
     static void detach(QExtMouse3DDeviceList *list);
 
     void attachWidget(QExtMouse3DEventProvider *provider, QWidget *widget);
     void detachWidget(QExtMouse3DEventProvider *provider, QWidget *widget);
+    void removeProvider(QExtMouse3DEventProvider *provider);
 
     void updateFilters(QExtMouse3DEventProvider *provider,
                        QExtMouse3DEventProvider::Filters value);
     void updateSensitivity
         (QExtMouse3DEventProvider *provider, qreal value);
+    void updateReadMode(QExtMouse3DEventProvider *provider,
+                        QExtMouse3DEventProvider::ReadMode value);
+    void updateAggregation(QExtMouse3DEventProvider *provider,
+                           QExtMouse3DEventProvider::Aggregation value);
+    void updateKeepOpen(QExtMouse3DEventProvider *provider, bool value);
+    void updateAdaptiveCalibration(QExtMouse3DEventProvider *provider,
+                                   bool value);
+    void updateReaderOptions(QExtMouse3DEventProvider *provider,
+                             const QExtMouse3DReaderOptions &value);
+    void updateWakeupRate(QExtMouse3DEventProvider *provider, int value);
+    void updateRouting(QExtMouse3DEventProvider *provider,
+                       QExtMouse3DEventProvider::Routing value);
+    void updateBinding(QExtMouse3DEventProvider *provider,
+                       const QStringList &value);
+    void updateMotionSink(QExtMouse3DEventProvider *provider,
+                          QExtMouse3DMotionSink *value);
+    void updateDelivery(QExtMouse3DEventProvider *provider,
+                        QExtMouse3DEventProvider::Delivery value);
+    void updateState(QExtMouse3DEventProvider *provider);
+
+    // The rest is only used on the list's thread.
+    const QExtMouse3DProviderState &providerState
+        (QExtMouse3DEventProvider *provider) const;
+    void routeToPointer();
+    void mergeMotion(QExtMouse3DDevice *device, QExtMouse3DEvent *event);
+    bool boundTarget(QExtMouse3DDevice *device,
+                     QExtMouse3DEventProvider **provider, QWidget **widget);
+    bool postMotion(QExtMouse3DEventProvider *provider, QWidget *widget,
+                    QExtMouse3DEvent *event, const int ranges[6]);
+    bool postKey(QExtMouse3DEventProvider *provider, QWidget *widget,
+                 QEvent::Type type, int key);
+    void deliverMotion(QExtMouse3DEventProvider *provider, QWidget *widget,
+                       QExtMouse3DEvent *event, const int ranges[6]);
+    void deliverMotion(QExtMouse3DEventProvider *provider, QWidget *widget,
+                       QExtMouse3DEvent *event, const int ranges[6],
+                       QExtMouse3DEventProvider::Filters filters,
+                       qreal sensitivity);
+    void sendEvent(QExtMouse3DEventProvider *provider, QWidget *widget,
+                   QEvent *event);
 
 private Q_SLOTS:
     void availableDeviceChanged();
+    void updateRegistry();
+    void mergeTick();
+    void deviceDestroyed(QObject *device);
+    void deliverPosted();
+    void attachQueued(QObject *provider, QWidget *widget);
+    void detachQueued(QObject *provider, QWidget *widget);
+    void updateQueued();
+    void releaseDevices();
 
 Q_SIGNALS:
     void availableChanged();
@@ -95,11 +186,82 @@ protected:
 
 private:
     void setWidget(QExtMouse3DEventProvider *provider, QWidget *widget);
+    void updateDevice(QExtMouse3DDevice *device);
+    bool isBound(QExtMouse3DDevice *input) const;
+    QList<QExtMouse3DDevice *> filteredDevices
+        (QExtMouse3DEventProvider *provider) const;
+    bool unbindProvider(QExtMouse3DEventProvider *provider);
+    void applyRouting(QExtMouse3DEventProvider *provider,
+                      QExtMouse3DEventProvider::Routing value);
+    void applyBinding(QExtMouse3DEventProvider *provider,
+                      const QStringList &value);
+    QExtMouse3DTargetQueue *targetQueue(QExtMouse3DEventProvider *provider);
+    void indexWidget(QWidget *widget);
+    struct PostedEvent;
+    PostedEvent *queuePosted(QExtMouse3DEventProvider *provider,
+                             QWidget *widget);
+    void removePosted(QWidget *widget);
+    bool queueUpdate(QExtMouse3DEventProvider *provider);
 
     QBasicAtomicInt ref;
     QWidget *currentWidget;
     QExtMouse3DEventProvider *currentProvider;
-    QMap<QWidget *, QExtMouse3DEventProvider *> widgets;
+    QWidget *devicesWidget;
+    QExtMouse3DEventProvider *devicesProvider;
+    QAtomicPointer<QExtMouse3DEventProvider> keepOpenProvider;
+    QHash<QExtMouse3DEventProvider *, QWidget *> boundWidgets;
+    QHash<QString, QExtMouse3DEventProvider *> boundNames;
+    QHash<QExtMouse3DDevice *, QExtMouse3DEventProvider *> boundDevices;
+    QHash<QWidget *, QExtMouse3DEventProvider *> widgets;
+    QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState> states;
+    QHash<QExtMouse3DEventProvider *, QExtMouse3DTargetQueue *> targetQueues;
+    QExtMouse3DWidgetIndex pointerWidgets;
+
+    // Latest deflection of each device for the merge stage.
+    struct MergeState
+    {
+        QExtMouse3DDevice *device;
+        int values[6];
+        qint64 timestamp;
+        int activeSince;
+    };
+    QVector<MergeState> mergeStates;
+    int mergeActivations;
+    bool mergeTickPending;
+    bool mergedWasZero;
+
+    // Events waiting for deliverPosted() with PostedDelivery, in a
+    // fixed ring so that posting does not allocate.  With BatchedDelivery
+    // the samples of a waiting batch are in the buffer of the same slot,
+    // which keeps its capacity from one batch to the next.
+    struct PostedEvent
+    {
+        QExtMouse3DEventProvider *provider;
+        QWidget *widget;
+        QEvent::Type type;
+        int key;
+        short values[6];
+        int ranges[6];
+        qint64 timestamp;
+        QExtMouse3DEventProvider::Filters filters;
+        qreal sensitivity;
+    };
+    enum { PostedPoolSize = 64 };
+    PostedEvent posted[PostedPoolSize];
+    QVector<QExtMouse3DSample> batchSamples[PostedPoolSize];
+    int postedHead;
+    int postedCount;
+    bool deliverPostedPending;
+
+    // Settings of providers in other threads that changed since the
+    // last updateQueued().  The mutex also keeps removeProvider() from
+    // returning while updateQueued() is applying them.
+    QMutex updateMutex;
+    QHash<QExtMouse3DEventProvider *, QExtMouse3DProviderState> queuedStates;
+    bool updateQueuedPending;
+
+    mutable QMutex registryMutex;
+    Registry currentRegistry;
 };
 
 QT_END_NAMESPACE
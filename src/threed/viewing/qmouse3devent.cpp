@@ -40,6 +40,12 @@
 ****************************************************************************/
 
 #include "qmouse3devent.h"
+#if defined(Q_OS_WIN)
+#include <QtCore/qt_windows.h>
+#elif defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+#include <QtCore/qelapsedtimer.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -89,6 +95,12 @@ QT_BEGIN_NAMESPACE
     }
     \endcode
 
+    Each event also carries the time at which the 3D mouse reported
+    the motion, in microseconds on a monotonic clock.  The age of the
+    sample can be determined by comparing timestamp() with
+    currentTimestamp(), which is useful for compensating for input
+    latency when rendering.
+
     \sa QExtMouse3DEventProvider
 */
 
@@ -100,11 +112,22 @@ QT_BEGIN_NAMESPACE
     \a rotateX, \a rotateY, and \a rotateZ.
 */
 
+// Holds the members that were added after the class layout was
+// fixed.  It is only allocated once one of them is set.
+class QExtMouse3DEventPrivate
+{
+public:
+    QExtMouse3DEventPrivate() : timestamp(0) {}
+
+    qint64 timestamp;
+};
+
 /*!
     Destroys this 3D mouse event.
 */
 QExtMouse3DEvent::~QExtMouse3DEvent()
 {
+    delete d_ptr;
 }
 
 /*!
@@ -188,4 +211,320 @@ const QEvent::Type QExtMouse3DEvent::type = QEvent::Type(750);
     \sa rotateX(), rotateY(), translateZ()
 */
 
+/*!
+    Returns the time at which the 3D mouse reported this motion,
+    in microseconds on the same clock as currentTimestamp().
+    Returns zero if the time is unknown.
+
+    On Linux, this is the time at which the kernel received the
+    motion from the device, rather than the time at which the
+    application read it.
+
+    \sa setTimestamp(), currentTimestamp()
+*/
+qint64 QExtMouse3DEvent::timestamp() const
+{
+    return d_ptr ? d_ptr->timestamp : 0;
+}
+
+/*!
+    Sets the \a timestamp at which the 3D mouse reported this motion,
+    in microseconds on the same clock as currentTimestamp().
+
+    \sa timestamp()
+*/
+void QExtMouse3DEvent::setTimestamp(qint64 timestamp)
+{
+    if (!d_ptr) {
+        if (!timestamp)
+            return;
+        d_ptr = new QExtMouse3DEventPrivate;
+    }
+    d_ptr->timestamp = timestamp;
+}
+
+/*!
+    Returns the current time in microseconds on the monotonic clock
+    that is used for timestamp().  The difference between the two
+    is the age of a 3D mouse event.
+
+    \sa timestamp()
+*/
+qint64 QExtMouse3DEvent::currentTimestamp()
+{
+#if defined(Q_OS_WIN)
+    static LARGE_INTEGER frequency = {{0, 0}};
+    if (!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return qint64(counter.QuadPart / frequency.QuadPart) * 1000000 +
+           qint64(counter.QuadPart % frequency.QuadPart) * 1000000 /
+                frequency.QuadPart;
+#elif defined(Q_OS_UNIX) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+    static QElapsedTimer timer;
+    if (!timer.isValid())
+        timer.start();
+    return timer.elapsed() * 1000;
+#endif
+}
+
+/*!
+    \class QExtMouse3DNormalizedEvent
+    \brief The QExtMouse3DNormalizedEvent class represents a motion in 3D space with each axis scaled to the range of the 3D mouse.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    When QExtMouse3DEventProvider::normalizedMotion() is true, widgets
+    receive QExtMouse3DNormalizedEvent instead of QExtMouse3DEvent.
+    Each axis is divided by the range that the device reports for it,
+    so that a full deflection is 1.0 or -1.0 whichever model of 3D mouse
+    is attached.  The filters and the sensitivity of the provider are
+    applied as for QExtMouse3DEvent, but the result is not rounded or
+    clamped, so a high sensitivity can take an axis beyond 1.0 and a
+    low sensitivity keeps the fine steps of slow movements.
+
+    The axes have the same directions as those of QExtMouse3DEvent.
+
+    \sa QExtMouse3DEvent, QExtMouse3DEventProvider::setNormalizedMotion()
+*/
+
+/*!
+    \fn QExtMouse3DNormalizedEvent::QExtMouse3DNormalizedEvent(qreal translateX, qreal translateY, qreal translateZ, qreal rotateX, qreal rotateY, qreal rotateZ)
+
+    Constructs an event representing a motion in 3D space for the six
+    normalized degrees of freedom given by \a translateX, \a translateY,
+    \a translateZ, \a rotateX, \a rotateY, and \a rotateZ.
+*/
+
+/*!
+    Destroys this normalized 3D mouse event.
+*/
+QExtMouse3DNormalizedEvent::~QExtMouse3DNormalizedEvent()
+{
+}
+
+/*!
+    \variable QExtMouse3DNormalizedEvent::type
+
+    This constant defines the QEvent::type() for normalized 3D mouse
+    events.
+*/
+const QEvent::Type QExtMouse3DNormalizedEvent::type = QEvent::Type(752);
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::translateX() const
+
+    Returns the X axis translation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::translateX() for the direction.
+*/
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::translateY() const
+
+    Returns the Y axis translation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::translateY() for the direction.
+*/
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::translateZ() const
+
+    Returns the Z axis translation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::translateZ() for the direction.
+*/
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::rotateX() const
+
+    Returns the X axis rotation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::rotateX() for the direction.
+*/
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::rotateY() const
+
+    Returns the Y axis rotation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::rotateY() for the direction.
+*/
+
+/*!
+    \fn qreal QExtMouse3DNormalizedEvent::rotateZ() const
+
+    Returns the Z axis rotation, as a fraction of the range of the
+    device.  See QExtMouse3DEvent::rotateZ() for the direction.
+*/
+
+/*!
+    \fn qint64 QExtMouse3DNormalizedEvent::timestamp() const
+
+    Returns the time at which the 3D mouse reported this motion,
+    as for QExtMouse3DEvent::timestamp().
+
+    \sa setTimestamp()
+*/
+
+/*!
+    \fn void QExtMouse3DNormalizedEvent::setTimestamp(qint64 timestamp)
+
+    Sets the \a timestamp at which the 3D mouse reported this motion.
+
+    \sa timestamp()
+*/
+
+/*!
+    \class QExtMouse3DSample
+    \brief The QExtMouse3DSample structure holds one filtered motion of a 3D mouse within a QExtMouse3DBatchEvent.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    The members have the same meaning as the functions of the same
+    name in QExtMouse3DEvent.
+
+    \sa QExtMouse3DBatchEvent
+*/
+
+/*!
+    \variable QExtMouse3DSample::translateX
+    The X axis translation value, as for QExtMouse3DEvent::translateX().
+*/
+
+/*!
+    \variable QExtMouse3DSample::translateY
+    The Y axis translation value, as for QExtMouse3DEvent::translateY().
+*/
+
+/*!
+    \variable QExtMouse3DSample::translateZ
+    The Z axis translation value, as for QExtMouse3DEvent::translateZ().
+*/
+
+/*!
+    \variable QExtMouse3DSample::rotateX
+    The X axis rotation value, as for QExtMouse3DEvent::rotateX().
+*/
+
+/*!
+    \variable QExtMouse3DSample::rotateY
+    The Y axis rotation value, as for QExtMouse3DEvent::rotateY().
+*/
+
+/*!
+    \variable QExtMouse3DSample::rotateZ
+    The Z axis rotation value, as for QExtMouse3DEvent::rotateZ().
+*/
+
+/*!
+    \variable QExtMouse3DSample::timestamp
+    The time at which the 3D mouse reported the motion, as for
+    QExtMouse3DEvent::timestamp().
+*/
+
+/*!
+    \class QExtMouse3DBatchEvent
+    \brief The QExtMouse3DBatchEvent class carries every 3D mouse motion that was reported since the widget last received one.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    When QExtMouse3DEventProvider::delivery() is
+    QExtMouse3DEventProvider::BatchedDelivery, the widget receives at
+    most one QExtMouse3DBatchEvent per pass of the event loop instead
+    of one QExtMouse3DEvent per motion.  The event holds the filtered
+    samples in the order in which the 3D mouse reported them, which
+    suits applications that integrate the motion over time and
+    cannot afford to dispatch an event per sample:
+
+    \code
+    bool MyWidget::event(QEvent *e)
+    {
+        if (e->type() == QExtMouse3DBatchEvent::type) {
+            QExtMouse3DBatchEvent *batch = static_cast<QExtMouse3DBatchEvent *>(e);
+            for (int index = 0; index < batch->count(); ++index)
+                integrate(batch->at(index));
+            return true;
+        }
+        return QWidget::event(e);
+    }
+    \endcode
+
+    Unless the event was constructed with a copy of the samples, they
+    belong to the sender and are only valid while the event is being
+    delivered.
+
+    \sa QExtMouse3DSample, QExtMouse3DEvent
+*/
+
+/*!
+    \fn QExtMouse3DBatchEvent::QExtMouse3DBatchEvent(const QExtMouse3DSample *samples, int count)
+
+    Constructs a batch event for the \a count motions in \a samples.
+    The array is not copied, so it must outlive the event.
+*/
+
+class QExtMouse3DBatchEventPrivate
+{
+public:
+    QVector<QExtMouse3DSample> samples;
+};
+
+/*!
+    Constructs a batch event that holds a copy of \a samples, which
+    must not be empty.  This is the form to use when the event is
+    posted with QCoreApplication::postEvent().
+*/
+QExtMouse3DBatchEvent::QExtMouse3DBatchEvent
+        (const QVector<QExtMouse3DSample> &samples)
+    : QEvent(QExtMouse3DBatchEvent::type)
+    , d_ptr(new QExtMouse3DBatchEventPrivate)
+{
+    d_ptr->samples = samples;
+    m_samples = d_ptr->samples.constData();
+    m_count = d_ptr->samples.size();
+}
+
+/*!
+    Destroys this 3D mouse batch event.
+*/
+QExtMouse3DBatchEvent::~QExtMouse3DBatchEvent()
+{
+    delete d_ptr;
+}
+
+/*!
+    \variable QExtMouse3DBatchEvent::type
+
+    This constant defines the QEvent::type() for 3D mouse batch events.
+*/
+const QEvent::Type QExtMouse3DBatchEvent::type = QEvent::Type(751);
+
+/*!
+    \fn int QExtMouse3DBatchEvent::count() const
+
+    Returns the number of samples in this event, which is at least one.
+
+    \sa samples(), at()
+*/
+
+/*!
+    \fn const QExtMouse3DSample *QExtMouse3DBatchEvent::samples() const
+
+    Returns the samples in this event, oldest first.
+
+    \sa count(), at()
+*/
+
+/*!
+    \fn const QExtMouse3DSample &QExtMouse3DBatchEvent::at(int index) const
+
+    Returns the sample at \a index, where zero is the oldest sample.
+
+    \sa count(), samples()
+*/
+
 QT_END_NAMESPACE
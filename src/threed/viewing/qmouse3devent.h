@@ -43,6 +43,7 @@
 #define QMOUSE3DEVENT_H
 
 #include <QtCore/qcoreevent.h>
+#include <QtCore/qvector.h>
 #include "qt3dglobal.h"
 
 QT_BEGIN_HEADER
@@ -52,6 +53,8 @@ QT_BEGIN_NAMESPACE
 QT_MODULE(Qt3d)
 
 class QExtMouse3DEventPrivate;
+class QExtMouse3DBatchEventPrivate;
+class QExtMouse3DNormalizedEventPrivate;
 
 class Q_QT3D_EXPORT QExtMouse3DEvent : public QEvent
 {
@@ -70,10 +73,15 @@ public:
     short rotateY() const { return m_rotateY; }
     short rotateZ() const { return m_rotateZ; }
 
+    qint64 timestamp() const;
+    void setTimestamp(qint64 timestamp);
+
+    static qint64 currentTimestamp();
+
 private:
     short m_translateX, m_translateY, m_translateZ;
     short m_rotateX, m_rotateY, m_rotateZ;
-    QExtMouse3DEventPrivate *d_ptr;    // For future expansion.
+    QExtMouse3DEventPrivate *d_ptr;
 
     Q_DISABLE_COPY(QExtMouse3DEvent)   // d_ptr is not default-copiable.
 };
@@ -92,6 +100,88 @@ inline QExtMouse3DEvent::QExtMouse3DEvent
 {
 }
 
+class Q_QT3D_EXPORT QExtMouse3DNormalizedEvent : public QEvent
+{
+public:
+    QExtMouse3DNormalizedEvent(qreal translateX, qreal translateY,
+                               qreal translateZ, qreal rotateX,
+                               qreal rotateY, qreal rotateZ);
+    ~QExtMouse3DNormalizedEvent();
+
+    static const QEvent::Type type;
+
+    qreal translateX() const { return m_translateX; }
+    qreal translateY() const { return m_translateY; }
+    qreal translateZ() const { return m_translateZ; }
+
+    qreal rotateX() const { return m_rotateX; }
+    qreal rotateY() const { return m_rotateY; }
+    qreal rotateZ() const { return m_rotateZ; }
+
+    qint64 timestamp() const { return m_timestamp; }
+    void setTimestamp(qint64 timestamp) { m_timestamp = timestamp; }
+
+private:
+    qreal m_translateX, m_translateY, m_translateZ;
+    qreal m_rotateX, m_rotateY, m_rotateZ;
+    qint64 m_timestamp;
+    QExtMouse3DNormalizedEventPrivate *d_ptr;    // For future expansion.
+
+    Q_DISABLE_COPY(QExtMouse3DNormalizedEvent)
+};
+
+inline QExtMouse3DNormalizedEvent::QExtMouse3DNormalizedEvent
+        (qreal translateX, qreal translateY, qreal translateZ,
+         qreal rotateX, qreal rotateY, qreal rotateZ)
+    : QEvent(QExtMouse3DNormalizedEvent::type)
+    , m_translateX(translateX)
+    , m_translateY(translateY)
+    , m_translateZ(translateZ)
+    , m_rotateX(rotateX)
+    , m_rotateY(rotateY)
+    , m_rotateZ(rotateZ)
+    , m_timestamp(0)
+    , d_ptr(0)
+{
+}
+
+struct QExtMouse3DSample
+{
+    short translateX, translateY, translateZ;
+    short rotateX, rotateY, rotateZ;
+    qint64 timestamp;
+};
+
+class Q_QT3D_EXPORT QExtMouse3DBatchEvent : public QEvent
+{
+public:
+    QExtMouse3DBatchEvent(const QExtMouse3DSample *samples, int count);
+    explicit QExtMouse3DBatchEvent(const QVector<QExtMouse3DSample> &samples);
+    ~QExtMouse3DBatchEvent();
+
+    static const QEvent::Type type;
+
+    int count() const { return m_count; }
+    const QExtMouse3DSample *samples() const { return m_samples; }
+    const QExtMouse3DSample &at(int index) const { return m_samples[index]; }
+
+private:
+    const QExtMouse3DSample *m_samples;
+    int m_count;
+    QExtMouse3DBatchEventPrivate *d_ptr;    // For future expansion.
+
+    Q_DISABLE_COPY(QExtMouse3DBatchEvent)
+};
+
+inline QExtMouse3DBatchEvent::QExtMouse3DBatchEvent
+        (const QExtMouse3DSample *samples, int count)
+    : QEvent(QExtMouse3DBatchEvent::type)
+    , m_samples(samples)
+    , m_count(count)
+    , d_ptr(0)
+{
+}
+
 QT_END_NAMESPACE
 
 QT_END_HEADER
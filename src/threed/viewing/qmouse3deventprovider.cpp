@@ -42,6 +42,8 @@
 #include "qmouse3deventprovider.h"
 #include "qmouse3ddevice_p.h"
 #include "qmouse3ddevicelist_p.h"
+#include "qmouse3dseqlock_p.h"
+#include <string.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -62,6 +64,9 @@ QT_BEGIN_NAMESPACE
     the presence of a 3D mouse with isAvailable() and availableChanged().
     If there are multiple 3D mice attached to the machine, then this
     class will make it appear as though there is a single event source.
+    By default each mouse delivers its own motions, which interleave
+    when several are moved at once; setMerging() combines them into
+    one motion instead.
 
     Motions in 3D are delivered to widget() in the form of a QExtMouse3DEvent
     and special purpose buttons are delivered to widget() in the form of a
@@ -113,19 +118,31 @@ QT_BEGIN_NAMESPACE
     widget(), which can help the user navigate through 3D space
     more reliably.
 
+    A provider can be created, configured and destroyed in any thread.
+    The devices are always read on the GUI thread, and changes that are
+    made from other threads are applied there when it next returns to
+    its event loop.  Setting the widget or destroying a provider that
+    has one from another thread waits for the GUI thread to process the
+    change, so the GUI thread must not be blocked waiting for that
+    thread at the time.  Use setTarget() to have the events delivered
+    to an object in the provider's own thread.
+
     \sa QExtMouse3DEvent
 */
 
+struct QExtMouse3DMotionState
+{
+    short values[6];
+    qint64 timestamp;
+    quint64 sequence;
+};
+
 class QExtMouse3DEventProviderPrivate
 {
 public:
     QExtMouse3DEventProviderPrivate()
         : widget(0)
-        , filters(QExtMouse3DEventProvider::Translations |
-                  QExtMouse3DEventProvider::Rotations |
-                  QExtMouse3DEventProvider::Sensitivity)
-        , keyFilters(QExtMouse3DEventProvider::AllFilters)
-        , sensitivity(1.0f)
+        , motionSequence(0)
     {
         devices = QExtMouse3DDeviceList::attach();
     }
@@ -136,9 +153,19 @@ public:
 
     QWidget *widget;
     QExtMouse3DDeviceList *devices;
-    QExtMouse3DEventProvider::Filters filters;
-    QExtMouse3DEventProvider::Filters keyFilters;
-    qreal sensitivity;
+
+    // The settings are read by the device list on the GUI thread and
+    // may be changed on the provider's thread, so they are only
+    // accessed with the mutex held.
+    mutable QMutex mutex;
+    QExtMouse3DProviderState state;
+
+    // Motions are published on the GUI thread, and on the reader
+    // thread by devices that call a motion sink there, so writers
+    // take the publish mutex.  Readers only use the sequence lock.
+    QMutex publishMutex;
+    quint64 motionSequence;
+    QExtMouse3DSeqLock<QExtMouse3DMotionState> latestMotion;
 };
 
 /*!
@@ -162,6 +189,7 @@ QExtMouse3DEventProvider::~QExtMouse3DEventProvider()
     Q_D(QExtMouse3DEventProvider);
     if (d->widget)
         d->devices->detachWidget(this, d->widget);
+    d->devices->removeProvider(this);
 }
 
 /*!
@@ -176,12 +204,7 @@ QExtMouse3DEventProvider::~QExtMouse3DEventProvider()
 bool QExtMouse3DEventProvider::isAvailable() const
 {
     Q_D(const QExtMouse3DEventProvider);
-    QList<QExtMouse3DDevice *> devices = d->devices->devices;
-    for (int index = 0; index < devices.size(); ++index) {
-        if (devices[index]->isAvailable())
-            return true;
-    }
-    return false;
+    return d->devices->registry().available;
 }
 
 /*!
@@ -195,13 +218,48 @@ bool QExtMouse3DEventProvider::isAvailable() const
 QStringList QExtMouse3DEventProvider::deviceNames() const
 {
     Q_D(const QExtMouse3DEventProvider);
-    QList<QExtMouse3DDevice *> devices = d->devices->devices;
-    QStringList names;
-    for (int index = 0; index < devices.size(); ++index) {
-        if (devices[index]->isAvailable())
-            names += devices[index]->deviceNames();
-    }
-    return names;
+    return d->devices->registry().names;
+}
+
+/*!
+    Returns a descriptor for each of the 3D mouse devices that are
+    attached to the machine and currently available, with the name,
+    USB identifiers, axis ranges, number of buttons and LCD screen of
+    the device.  Values that the device has not reported yet, usually
+    because it has not been opened, are zero.
+
+    If \a generation is not null, it is set to deviceGeneration() for
+    the returned descriptors.
+
+    \sa deviceGeneration(), deviceNames()
+*/
+QList<QExtMouse3DDeviceDescriptor> QExtMouse3DEventProvider::deviceDescriptors
+    (quint64 *generation) const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QExtMouse3DDeviceList::Registry registry = d->devices->registry();
+    if (generation)
+        *generation = registry.generation;
+    return registry.descriptors;
+}
+
+/*!
+    Returns a number that increases every time that isAvailable(),
+    deviceNames() or deviceDescriptors() may have changed.  Comparing
+    it with the value from an earlier call tells whether the devices
+    need to be looked at again.
+
+    isAvailable(), deviceNames(), deviceDescriptors() and this function
+    can be called from any thread.  They return a copy of information
+    that is gathered when devices are plugged in or unplugged, so they
+    are cheap enough to be polled and do not query the devices.
+
+    \sa availableChanged()
+*/
+quint64 QExtMouse3DEventProvider::deviceGeneration() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    return d->devices->registry().generation;
 }
 
 /*!
@@ -235,6 +293,51 @@ void QExtMouse3DEventProvider::setWidget(QWidget *widget)
     }
 }
 
+/*!
+    Returns the object that 3D mouse events are posted to instead of
+    being sent to widget(); or null if they are sent to widget().
+
+    \sa setTarget()
+*/
+QObject *QExtMouse3DEventProvider::target() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.target;
+}
+
+/*!
+    Sets the \a target object that QExtMouse3DEvent and QKeyEvent
+    events go to instead of widget().  The events are queued for
+    \a target and sent to it with QCoreApplication::sendEvent() on
+    the thread that it lives in, for example a render thread that
+    runs its own event loop.  widget() must still be set, because
+    it decides when the 3D mouse input goes to this provider.
+
+    While a motion is waiting for \a target's thread, a newer motion
+    replaces it, so a busy thread gets the latest deflection of the
+    mouse rather than a backlog.  Key events are kept in order with the
+    motions around them, and the samples of waiting batches are joined.
+
+    The provider does not take ownership of \a target.  If \a target
+    is destroyed, the events that are waiting for it are dropped and
+    later events are sent to widget() again, as they are after passing
+    null.
+
+    \sa target(), setWidget()
+*/
+void QExtMouse3DEventProvider::setTarget(QObject *target)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.target == target)
+        return;
+    d->state.target = target;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateState(this);
+}
+
 /*!
     \enum QExtMouse3DEventProvider::Filter
     This enum defines filters that can be applied to incoming
@@ -257,7 +360,8 @@ void QExtMouse3DEventProvider::setWidget(QWidget *widget)
 QExtMouse3DEventProvider::Filters QExtMouse3DEventProvider::filters() const
 {
     Q_D(const QExtMouse3DEventProvider);
-    return d->filters;
+    QMutexLocker locker(&d->mutex);
+    return d->state.filters;
 }
 
 /*!
@@ -272,11 +376,14 @@ void QExtMouse3DEventProvider::setFilters
     Q_D(QExtMouse3DEventProvider);
     if ((filters & (Translations | Rotations)) == 0)
         filters |= Rotations;   // Need at least 1 of these set.
-    if (d->filters != filters) {
-        d->filters = filters;
-        d->devices->updateFilters(this, filters);
-        emit filtersChanged();
-    }
+    QMutexLocker locker(&d->mutex);
+    if (d->state.filters == filters)
+        return;
+    d->state.filters = filters;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateFilters(this, filters);
+    emit filtersChanged();
 }
 
 /*!
@@ -289,8 +396,7 @@ void QExtMouse3DEventProvider::setFilters
 void QExtMouse3DEventProvider::toggleFilter
     (QExtMouse3DEventProvider::Filter filter)
 {
-    Q_D(QExtMouse3DEventProvider);
-    QExtMouse3DEventProvider::Filters newFilters = d->filters ^ filter;
+    QExtMouse3DEventProvider::Filters newFilters = filters() ^ filter;
     if ((newFilters & (QExtMouse3DEventProvider::Translations |
                        QExtMouse3DEventProvider::Rotations)) == 0) {
         // Cannot turn off both Translations and Rotations, so turn
@@ -321,7 +427,8 @@ void QExtMouse3DEventProvider::toggleFilter
 QExtMouse3DEventProvider::Filters QExtMouse3DEventProvider::keyFilters() const
 {
     Q_D(const QExtMouse3DEventProvider);
-    return d->keyFilters;
+    QMutexLocker locker(&d->mutex);
+    return d->state.keyFilters;
 }
 
 /*!
@@ -334,7 +441,13 @@ void QExtMouse3DEventProvider::setKeyFilters
     (QExtMouse3DEventProvider::Filters filters)
 {
     Q_D(QExtMouse3DEventProvider);
-    d->keyFilters = filters;
+    QMutexLocker locker(&d->mutex);
+    if (d->state.keyFilters == filters)
+        return;
+    d->state.keyFilters = filters;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateState(this);
 }
 
 /*!
@@ -356,7 +469,8 @@ void QExtMouse3DEventProvider::setKeyFilters
 qreal QExtMouse3DEventProvider::sensitivity() const
 {
     Q_D(const QExtMouse3DEventProvider);
-    return d->sensitivity;
+    QMutexLocker locker(&d->mutex);
+    return d->state.sensitivity;
 }
 
 /*!
@@ -379,11 +493,838 @@ void QExtMouse3DEventProvider::setSensitivity(qreal value)
 
     // Clamp the value to the range 1/64 to 64.
     value = qMin(qMax(value, qreal(1.0f / 64.0f)), qreal(64.0f));
-    if (d->sensitivity != value) {
-        d->sensitivity = value;
-        d->devices->updateSensitivity(this, d->sensitivity);
-        emit sensitivityChanged();
-    }
+    QMutexLocker locker(&d->mutex);
+    if (d->state.sensitivity == value)
+        return;
+    d->state.sensitivity = value;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateSensitivity(this, value);
+    emit sensitivityChanged();
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::ReadMode
+    This enum defines where the low-level 3D mouse devices are read.
+
+    \value GuiThreadRead Devices are read on the GUI thread whenever
+        the event loop notices that new input is pending.  If the GUI
+        thread is busy, only the most recent position is delivered.
+    \value ReaderThreadRead Devices are read and decoded on a dedicated
+        background thread, and the decoded samples are queued for delivery
+        on the GUI thread.  Samples that arrive while the GUI thread is
+        busy are kept and delivered in order, unless setAggregation()
+        asks for them to be combined.  Plug-ins that do not
+        support a reader thread fall back to \l GuiThreadRead.
+    \value AsyncRead Reads for all devices are submitted to the kernel
+        ahead of time and complete into pre-registered buffers, so that
+        the GUI thread is woken once for any number of completed reads
+        and no read() system call is made per device.  On Linux this
+        uses io_uring; if it is not available in the kernel or was not
+        enabled at build time, \l GuiThreadRead is used instead.
+*/
+
+/*!
+    Returns the mode that is used to read the 3D mouse devices while
+    widget() is receiving events.  The default is \l GuiThreadRead.
+
+    \sa setReadMode()
+*/
+QExtMouse3DEventProvider::ReadMode QExtMouse3DEventProvider::readMode() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.readMode;
+}
+
+/*!
+    Sets the \a mode that is used to read the 3D mouse devices while
+    widget() is receiving events.
+
+    \sa readMode()
+*/
+void QExtMouse3DEventProvider::setReadMode
+    (QExtMouse3DEventProvider::ReadMode mode)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.readMode == mode)
+        return;
+    d->state.readMode = mode;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateReadMode(this, mode);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::Aggregation
+    This enum defines how the samples that a 3D mouse reported while
+    the application was busy are combined into the next motion that
+    is delivered to widget().
+
+    \value LastSample Only the most recent sample is delivered and the
+        others are discarded.  This is the default.  With
+        \l ReaderThreadRead, the samples are kept and every one of
+        them is delivered instead.
+    \value TimeWeightedAverage The samples are averaged, with each one
+        weighted by the time for which the mouse held that position.
+        The delivered motion reflects the average deflection during
+        the delay rather than the deflection at the end of it.
+    \value IntegratedDisplacement The samples are integrated over time
+        and expressed in units of the mouse's normal reporting interval,
+        so that a motion delivered after a delay is correspondingly
+        larger.  Navigation speed then stays proportional to the mouse
+        deflection no matter how late the motion is delivered.
+        Values are clamped to the range -32768 to 32767.
+*/
+
+/*!
+    Returns the way in which samples that arrive while the application
+    is busy are combined into a single motion.  The default is
+    \l LastSample.
+
+    Aggregation only applies to devices whose plug-in has access to
+    the timing of individual samples; others always use \l LastSample.
+    With \l BatchedDelivery the samples are not combined, as the
+    batch holds every one of them.
+
+    \sa setAggregation()
+*/
+QExtMouse3DEventProvider::Aggregation QExtMouse3DEventProvider::aggregation() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.aggregation;
+}
+
+/*!
+    Sets the way in which samples that arrive while the application
+    is busy are combined into a single motion to \a aggregation.
+
+    \sa aggregation()
+*/
+void QExtMouse3DEventProvider::setAggregation
+    (QExtMouse3DEventProvider::Aggregation aggregation)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.aggregation == aggregation)
+        return;
+    d->state.aggregation = aggregation;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateAggregation(this, aggregation);
+}
+
+/*!
+    Returns true if the 3D mouse devices are kept open while no widget
+    is active, so that they can resume delivering events immediately
+    when widget() is activated again; false otherwise.  The default
+    is false, which closes the devices on deactivation.
+
+    \sa setKeepDevicesOpen()
+*/
+bool QExtMouse3DEventProvider::keepDevicesOpen() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.keepDevicesOpen;
+}
+
+/*!
+    Sets the flag that keeps the 3D mouse devices open while no widget
+    is active to \a value.  Applications that switch between several
+    top-level windows should set this to avoid reopening and probing
+    the devices every time a window is activated.  Other applications
+    are still able to use the devices while the widget is inactive.
+
+    Devices that are kept open for this provider are closed when the
+    flag is cleared or the provider is destroyed, even if widget() has
+    already been deactivated.
+
+    \sa keepDevicesOpen()
+*/
+void QExtMouse3DEventProvider::setKeepDevicesOpen(bool value)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.keepDevicesOpen == value)
+        return;
+    d->state.keepDevicesOpen = value;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateKeepOpen(this, value);
+}
+
+/*!
+    Returns true if the 3D mouse devices learn their zero offset and
+    noise while they are used, so that a worn device that does not
+    rest exactly at its center is not reported as moving and the dead
+    zone follows the noise of the device; false if the dead zones that
+    the devices report are used as they are.  The default is true.
+
+    This only applies to devices whose plug-in calibrates the raw axis
+    values itself.
+
+    \sa setAdaptiveCalibration()
+*/
+bool QExtMouse3DEventProvider::adaptiveCalibration() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.adaptiveCalibration;
+}
+
+/*!
+    Enables or disables learning of the zero offset and noise of the
+    3D mouse devices according to \a value.  Applications that need
+    the output of the device to depend only on its current deflection,
+    such as for measurements, should disable this.
+
+    \sa adaptiveCalibration()
+*/
+void QExtMouse3DEventProvider::setAdaptiveCalibration(bool value)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.adaptiveCalibration == value)
+        return;
+    d->state.adaptiveCalibration = value;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateAdaptiveCalibration(this, value);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::Scheduling
+    This enum defines the scheduling policy of the background thread
+    that reads the 3D mouse devices in \l ReaderThreadRead mode.
+
+    \value NormalScheduling The thread is scheduled like any other
+        thread in the application.  This is the default.
+    \value FifoScheduling The thread uses the real-time \c SCHED_FIFO
+        policy and preempts all normally scheduled threads as soon as
+        input arrives.
+    \value RoundRobinScheduling The thread uses the real-time
+        \c SCHED_RR policy, which is like \l FifoScheduling but shares
+        the processor with other real-time threads of the same priority.
+*/
+
+/*!
+    Returns the scheduling policy of the background thread that reads
+    the 3D mouse devices.  The default is \l NormalScheduling.
+
+    \sa readerPriority(), setReaderScheduling()
+*/
+QExtMouse3DEventProvider::Scheduling QExtMouse3DEventProvider::readerScheduling() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.readerOptions.scheduling;
+}
+
+/*!
+    Returns the real-time priority of the background thread that reads
+    the 3D mouse devices, or zero if readerScheduling() is
+    \l NormalScheduling.
+
+    \sa readerScheduling(), setReaderScheduling()
+*/
+int QExtMouse3DEventProvider::readerPriority() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.readerOptions.priority;
+}
+
+/*!
+    Sets the scheduling policy of the background thread that reads the
+    3D mouse devices to \a scheduling, with the real-time \a priority.
+    Under Linux, real-time priorities range from 1 to 99 and
+    \a priority is ignored for \l NormalScheduling.
+
+    Real-time scheduling keeps the reader from being starved when the
+    application keeps every processor busy, but the process needs the
+    \c CAP_SYS_NICE capability or a large enough \c RLIMIT_RTPRIO
+    resource limit to use it.  If the policy cannot be applied, a
+    warning that includes the current limit is printed and the thread
+    continues with normal scheduling.
+
+    This setting only has an effect in \l ReaderThreadRead mode.
+
+    \sa readerScheduling(), readerPriority(), setReadMode()
+*/
+void QExtMouse3DEventProvider::setReaderScheduling
+    (QExtMouse3DEventProvider::Scheduling scheduling, int priority)
+{
+    Q_D(QExtMouse3DEventProvider);
+    if (scheduling == NormalScheduling)
+        priority = 0;
+    QMutexLocker locker(&d->mutex);
+    if (d->state.readerOptions.scheduling == scheduling &&
+            d->state.readerOptions.priority == priority)
+        return;
+    d->state.readerOptions.scheduling = scheduling;
+    d->state.readerOptions.priority = priority;
+    ++d->state.revision;
+    QExtMouse3DReaderOptions options = d->state.readerOptions;
+    locker.unlock();
+    d->devices->updateReaderOptions(this, options);
+}
+
+/*!
+    Returns the list of processors that the background thread that
+    reads the 3D mouse devices may run on.  The default is an empty
+    list, which allows the thread to run on any processor.
+
+    \sa setReaderCpus()
+*/
+QList<int> QExtMouse3DEventProvider::readerCpus() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.readerOptions.cpus;
+}
+
+/*!
+    Restricts the background thread that reads the 3D mouse devices
+    to the processors in \a cpus, numbered from zero.  Pinning the
+    reader to a processor that the application keeps free of heavy
+    computation reduces the delay before input is decoded.  An empty
+    list allows the thread to run on any processor again.
+
+    This setting only has an effect in \l ReaderThreadRead mode.
+
+    \sa readerCpus(), setReaderScheduling()
+*/
+void QExtMouse3DEventProvider::setReaderCpus(const QList<int> &cpus)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.readerOptions.cpus == cpus)
+        return;
+    d->state.readerOptions.cpus = cpus;
+    ++d->state.revision;
+    QExtMouse3DReaderOptions options = d->state.readerOptions;
+    locker.unlock();
+    d->devices->updateReaderOptions(this, options);
+}
+
+/*!
+    Returns the number of microseconds for which the background thread
+    that reads the 3D mouse devices keeps polling for more input after
+    a report arrives, instead of going to sleep.  The default is zero,
+    which disables busy polling.
+
+    \sa setReaderBusyPollTime()
+*/
+int QExtMouse3DEventProvider::readerBusyPollTime() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.readerOptions.busyPollTime;
+}
+
+/*!
+    Sets the number of microseconds for which the background thread
+    that reads the 3D mouse devices keeps polling for more input after
+    a report arrives to \a usecs.  While the mouse is in use, the
+    reader then picks up each report without waiting to be woken by
+    the scheduler, at the cost of keeping a processor busy.  Setting
+    \a usecs to a value slightly larger than the reporting interval
+    of the device keeps the reader polling for as long as the mouse
+    is moving.
+
+    This setting only has an effect in \l ReaderThreadRead mode.
+
+    \sa readerBusyPollTime()
+*/
+void QExtMouse3DEventProvider::setReaderBusyPollTime(int usecs)
+{
+    Q_D(QExtMouse3DEventProvider);
+    usecs = qMax(usecs, 0);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.readerOptions.busyPollTime == usecs)
+        return;
+    d->state.readerOptions.busyPollTime = usecs;
+    ++d->state.revision;
+    QExtMouse3DReaderOptions options = d->state.readerOptions;
+    locker.unlock();
+    d->devices->updateReaderOptions(this, options);
+}
+
+/*!
+    Returns the maximum number of times per second that the GUI thread
+    is woken up to read the 3D mouse devices.  The default is zero,
+    which reads the devices as soon as each report arrives.
+
+    \sa setMaximumWakeupRate()
+*/
+int QExtMouse3DEventProvider::maximumWakeupRate() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.maximumWakeupRate;
+}
+
+/*!
+    Sets the maximum number of times per second that the GUI thread is
+    woken up to read the 3D mouse devices to \a rate.  While the mouse
+    is moving, the devices are then read on a timer at \a rate instead
+    of whenever a report arrives, and the reports that arrived since
+    the last read are combined according to aggregation().  The first
+    report after the mouse has been at rest is still read immediately.
+
+    Applications that only repaint at a fixed frame rate, such as
+    kiosk-style viewers, can set \a rate to that frame rate to avoid
+    waking up at the reporting rate of the device, which saves
+    processor time and power.  A \a rate of zero removes the limit.
+
+    This setting only has an effect in \l GuiThreadRead mode.
+
+    \sa maximumWakeupRate(), setAggregation()
+*/
+void QExtMouse3DEventProvider::setMaximumWakeupRate(int rate)
+{
+    Q_D(QExtMouse3DEventProvider);
+    rate = qMax(rate, 0);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.maximumWakeupRate == rate)
+        return;
+    d->state.maximumWakeupRate = rate;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateWakeupRate(this, rate);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::Routing
+    This enum defines how 3D mouse input is routed between the widgets
+    of the active window that have an event provider.
+
+    \value ActiveWidgetRouting Input goes to the widget that was most
+        recently activated.  This is the default.
+    \value PointerRouting Each time the 3D mouse starts moving after
+        being at rest, input is sent to the registered widget under the
+        mouse pointer, so that each viewport of a multi-viewport window
+        can be navigated by hovering over it.
+*/
+
+/*!
+    Returns the routing policy for the widget of this provider.
+    The default is \l ActiveWidgetRouting.
+
+    \sa setRouting()
+*/
+QExtMouse3DEventProvider::Routing QExtMouse3DEventProvider::routing() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.routing;
+}
+
+/*!
+    Sets the routing policy for the widget of this provider to
+    \a routing.  When several viewports in one window each have a
+    provider with \l PointerRouting, the viewport under the mouse
+    pointer receives the 3D mouse input.  The pointer is only consulted
+    when the 3D mouse starts moving, so a movement is never split
+    between two viewports, and the positions of the viewports are
+    tracked from their move and resize events.
+
+    \sa routing(), setWidget()
+*/
+void QExtMouse3DEventProvider::setRouting
+    (QExtMouse3DEventProvider::Routing routing)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.routing == routing)
+        return;
+    d->state.routing = routing;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateRouting(this, routing);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::Merging
+    This enum defines how the motions of several 3D mice that are
+    moved at the same time are combined.
+
+    \value NoMerging Each mouse delivers its motions as they arrive,
+        so the motions of two mice that are moved together interleave.
+        This is the default.
+    \value SumMerging The deflections of all mice are added together.
+    \value PriorityMerging Only the mouse that comes first in
+        devicePriority() of those that are deflected is used.
+    \value MostRecentMerging Only the mouse that started moving most
+        recently is used, until it comes to rest.
+*/
+
+/*!
+    Returns the policy for combining the motions of several 3D mice.
+    The default is \l NoMerging.
+
+    \sa setMerging(), devicePriority()
+*/
+QExtMouse3DEventProvider::Merging QExtMouse3DEventProvider::merging() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.merging;
+}
+
+/*!
+    Sets the policy for combining the motions of several 3D mice to
+    \a merging.  With any policy other than \l NoMerging, the latest
+    deflection of each mouse is collected and widget() receives a single
+    combined motion per pass of the event loop, however many mice are
+    moving and however fast they report.
+
+    \sa merging(), setDevicePriority()
+*/
+void QExtMouse3DEventProvider::setMerging
+    (QExtMouse3DEventProvider::Merging merging)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.merging == merging)
+        return;
+    d->state.merging = merging;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateState(this);
+}
+
+/*!
+    Returns the names of the 3D mice in order of priority for
+    \l PriorityMerging.  The default is an empty list.
+
+    \sa setDevicePriority(), deviceNames()
+*/
+QStringList QExtMouse3DEventProvider::devicePriority() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.devicePriority;
+}
+
+/*!
+    Sets the names of the 3D mice in order of priority for
+    \l PriorityMerging to \a deviceNames, which are names from
+    deviceNames().  Mice that are not in the list come after those
+    that are, in the order in which they were first moved.
+
+    \sa devicePriority(), setMerging()
+*/
+void QExtMouse3DEventProvider::setDevicePriority(const QStringList &deviceNames)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.devicePriority == deviceNames)
+        return;
+    d->state.devicePriority = deviceNames;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateState(this);
+}
+
+/*!
+    Returns the names of the 3D mice that are bound to this provider.
+    The default is an empty list.
+
+    \sa setDeviceBinding()
+*/
+QStringList QExtMouse3DEventProvider::deviceBinding() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.deviceBinding;
+}
+
+/*!
+    Binds the 3D mice named in \a deviceNames to this provider, so that
+    their motions and buttons always go to widget(), whichever window
+    is active and even when none of the application's windows are.
+    This lets several people share one workstation with a 3D mouse
+    and a viewport each.  Mice that are not bound to any provider
+    keep following window activation.
+
+    The names are the ones reported by deviceNames().  Under Linux
+    with udev these are USB serial identifiers, which include the
+    vendor, model and serial number, so two mice of the same model
+    can be told apart.  An empty list removes the binding.
+
+    A mouse can only be bound to one provider.  If another provider
+    has already bound one of \a deviceNames, a warning is printed and
+    that mouse stays with the other provider.
+
+    The bound mice report every sample on all axes at full sensitivity,
+    and the filters(), sensitivity() and motion sink of the provider
+    they are bound to are applied when a motion is delivered, on the
+    GUI thread; its aggregation() and \l ReaderThreadSink settings are
+    not used for them.  The mice that are not bound keep all of the
+    settings of the provider of the active window.  The readMode(),
+    maximumWakeupRate(), keepDevicesOpen() and scheduling settings
+    apply to all of the mice, and are taken from the provider of the
+    active window, or from one of the bound providers when none of its
+    windows are active.
+
+    \sa deviceBinding(), setWidget()
+*/
+void QExtMouse3DEventProvider::setDeviceBinding(const QStringList &deviceNames)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.deviceBinding == deviceNames)
+        return;
+    d->state.deviceBinding = deviceNames;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateBinding(this, deviceNames);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::Delivery
+    This enum defines how 3D mouse events reach widget().
+
+    \value SynchronousDelivery Events are sent to widget() as soon as the
+        device reports them, so the device is not read again until the
+        widget has handled the event.
+    \value PostedDelivery Events are queued and delivered to widget()
+        when control returns to the event loop.  While a motion is
+        waiting, later motions for the same widget update it instead
+        of being queued behind it.
+    \value BatchedDelivery Like \l PostedDelivery, but widget() receives
+        a QExtMouse3DBatchEvent with every filtered motion since the
+        previous one, instead of a QExtMouse3DEvent with only the latest.
+*/
+
+/*!
+    Returns how 3D mouse events are delivered to widget().
+    The default is \l SynchronousDelivery.
+
+    \sa setDelivery()
+*/
+QExtMouse3DEventProvider::Delivery QExtMouse3DEventProvider::delivery() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.delivery;
+}
+
+/*!
+    Sets how 3D mouse events are delivered to widget() to \a delivery.
+
+    With \l PostedDelivery a slow widget no longer holds up the reading
+    of the devices.  There is at most one waiting motion per widget,
+    however slowly the widget handles them, and it always holds the
+    latest deflection of the mouse.  Buttons keep their order relative
+    to motions: a motion that arrives after a button press is queued
+    behind the press rather than merged into an earlier motion.
+    A waiting motion is filtered with the filters() and sensitivity()
+    that were in effect when the mouse reported it, so a button that
+    changes them only affects the motions that follow it.
+
+    With \l BatchedDelivery, each motion is filtered as it arrives and
+    added to the waiting QExtMouse3DBatchEvent for widget(), so that
+    the widget sees every sample with a single event per pass of the
+    event loop.  The devices then report every sample that they read,
+    whatever the aggregation() setting, and the motion that
+    setMerging() combines on each pass of the event loop is added to
+    the batch as one sample.
+
+    \sa delivery()
+*/
+void QExtMouse3DEventProvider::setDelivery
+    (QExtMouse3DEventProvider::Delivery delivery)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.delivery == delivery)
+        return;
+    d->state.delivery = delivery;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateDelivery(this, delivery);
+}
+
+/*!
+    Returns true if motions are delivered to widget() as
+    QExtMouse3DNormalizedEvent objects; false if they are delivered
+    as QExtMouse3DEvent objects.  The default is false.
+
+    \sa setNormalizedMotion()
+*/
+bool QExtMouse3DEventProvider::normalizedMotion() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.normalizedMotion;
+}
+
+/*!
+    Sets whether motions are delivered to widget() as
+    QExtMouse3DNormalizedEvent objects to \a value.
+
+    QExtMouse3DEvent holds each axis as a short, so sensitivity() values
+    above 1 saturate at 32767 and values below 1 round slow movements
+    to a few coarse steps.  The axes of QExtMouse3DNormalizedEvent are
+    floating-point values scaled with the range that each device
+    reports, so they are neither clamped nor rounded, and a full
+    deflection is 1.0 on every model of 3D mouse.
+
+    This applies to the QExtMouse3DEvent objects that would be sent
+    to widget().  QExtMouse3DBatchEvent, motionSink() and latestMotion()
+    keep using short values.
+
+    \sa normalizedMotion(), QExtMouse3DNormalizedEvent
+*/
+void QExtMouse3DEventProvider::setNormalizedMotion(bool value)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    if (d->state.normalizedMotion == value)
+        return;
+    d->state.normalizedMotion = value;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateState(this);
+}
+
+/*!
+    \enum QExtMouse3DEventProvider::SinkThread
+    This enum defines the thread on which motionSink() is called.
+
+    \value GuiThreadSink The sink is called on the GUI thread, where
+        the motion would otherwise be sent to widget().
+    \value ReaderThreadSink The sink is called on the thread that reads
+        the devices, as soon as each report has been decoded.  This only
+        differs from \l GuiThreadSink when readMode() is
+        \l ReaderThreadRead and the device supports it.
+*/
+
+/*!
+    Returns the sink that receives 3D mouse motions instead of widget(),
+    or null if motions are delivered to widget() as events.
+
+    \sa setMotionSink(), motionSinkThread()
+*/
+QExtMouse3DMotionSink *QExtMouse3DEventProvider::motionSink() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.motionSink;
+}
+
+/*!
+    Returns the thread on which motionSink() is called.
+    The default is \l GuiThreadSink.
+
+    \sa setMotionSink(), motionSink()
+*/
+QExtMouse3DEventProvider::SinkThread
+    QExtMouse3DEventProvider::motionSinkThread() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state.motionSinkThread;
+}
+
+/*!
+    Sets the \a sink that receives the motions of the 3D mouse instead
+    of widget(), and the \a thread on which it is called.  The sink is
+    handed the filtered axis values and timestamp of each motion
+    directly, without constructing a QExtMouse3DEvent, going through
+    QApplication::sendEvent() or running event filters.  Buttons are
+    still delivered to widget() as QKeyEvent objects, and widget() must
+    still be set so that the devices are opened.
+
+    With \l ReaderThreadSink, filters() and sensitivity() are applied
+    on the reader thread, and aggregation(), delivery() and merging()
+    do not apply to those motions.  latestMotion() is updated on the
+    reader thread as well.  Once this function returns, the previous
+    sink is no longer being called on the reader thread and can be
+    destroyed.  If it is called from a thread other than the GUI
+    thread, it blocks until the GUI thread has handed the new sink to
+    the devices, so the GUI thread must not be waiting for the calling
+    thread at the time.
+
+    Passing a null \a sink delivers motions to widget() again.  The
+    provider does not take ownership of \a sink.
+
+    \sa motionSink(), motionSinkThread()
+*/
+void QExtMouse3DEventProvider::setMotionSink
+    (QExtMouse3DMotionSink *sink, QExtMouse3DEventProvider::SinkThread thread)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    d->state.motionSink = sink;
+    d->state.motionSinkThread = thread;
+    ++d->state.revision;
+    locker.unlock();
+    d->devices->updateMotionSink
+        (this, thread == ReaderThreadSink ? sink : 0);
+}
+
+/*!
+    Copies the most recent motion that was delivered to widget() or
+    motionSink() into \a values, in the order translate X, Y, Z and
+    rotate X, Y, Z, and its QExtMouse3DEvent::timestamp() into
+    \a timestamp if it is not null.  The values are the ones seen by widget(), after filters()
+    and sensitivity() have been applied.
+
+    Returns the sequence number of the motion, which increases by one
+    for every motion that is delivered, or zero if no motion has been
+    delivered yet; in that case \a values are all zero.  Comparing the
+    sequence number with the one from the previous call tells whether
+    the state has changed.
+
+    This function can be called from any thread.  It never blocks the
+    thread that delivers 3D mouse events and does not go through the
+    event loop, so a render thread can sample the 3D mouse once per
+    frame at the point where it uses the values.  Motions are
+    still delivered to widget() as QExtMouse3DEvent objects.
+
+    \sa widget()
+*/
+quint64 QExtMouse3DEventProvider::latestMotion
+    (short values[6], qint64 *timestamp) const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QExtMouse3DMotionState state;
+    d->latestMotion.read(&state);
+    memcpy(values, state.values, sizeof(state.values));
+    if (timestamp)
+        *timestamp = state.timestamp;
+    return state.sequence;
+}
+
+// Returns a copy of the settings for the device list.  The copy is
+// taken on the thread that changed the settings, so that the list
+// never reads the settings while they are being changed.
+QExtMouse3DProviderState QExtMouse3DEventProvider::state() const
+{
+    Q_D(const QExtMouse3DEventProvider);
+    QMutexLocker locker(&d->mutex);
+    return d->state;
+}
+
+// Records the filtered motion that is about to be sent to widget()
+// or the motion sink for latestMotion().  Called on the thread that
+// delivers events, or the reader thread for ReaderThreadSink.
+void QExtMouse3DEventProvider::publishMotion
+    (const short values[6], qint64 timestamp)
+{
+    Q_D(QExtMouse3DEventProvider);
+    QExtMouse3DMotionState state;
+    memcpy(state.values, values, sizeof(state.values));
+    state.timestamp = timestamp;
+    QMutexLocker locker(&d->publishMutex);
+    state.sequence = ++(d->motionSequence);
+    d->latestMotion.write(state);
 }
 
 /*!
@@ -417,4 +1358,97 @@ void QExtMouse3DEventProvider::setSensitivity(qreal value)
     \sa sensitivity(), setSensitivity()
 */
 
+/*!
+    \class QExtMouse3DMotionSink
+    \brief The QExtMouse3DMotionSink class receives 3D mouse motions without going through the Qt event system.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    Applications that integrate 3D mouse input into their own simulation
+    loop can subclass QExtMouse3DMotionSink and register it with
+    QExtMouse3DEventProvider::setMotionSink().  The sink is then handed
+    each motion as soon as it has been filtered, which avoids the cost
+    of constructing and dispatching a QExtMouse3DEvent.
+
+    \sa QExtMouse3DEventProvider::setMotionSink()
+*/
+
+/*!
+    Destroys this motion sink.
+*/
+QExtMouse3DMotionSink::~QExtMouse3DMotionSink()
+{
+}
+
+/*!
+    \fn void QExtMouse3DMotionSink::motion(const short values[6], qint64 timestamp)
+
+    Called for each 3D mouse motion with the filtered axis \a values,
+    in the order translate X, Y, Z and rotate X, Y, Z, and the
+    QExtMouse3DEvent::timestamp() of the motion in \a timestamp.
+
+    This is called on the thread chosen with
+    QExtMouse3DEventProvider::setMotionSink() and should return quickly,
+    as the device is not read again until it does.
+*/
+
+/*!
+    \class QExtMouse3DDeviceDescriptor
+    \brief The QExtMouse3DDeviceDescriptor structure describes one 3D mouse device that is attached to the machine.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    \sa QExtMouse3DEventProvider::deviceDescriptors()
+*/
+
+/*!
+    \fn QExtMouse3DDeviceDescriptor::QExtMouse3DDeviceDescriptor()
+    Constructs a descriptor with an empty name and all values zero.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::name
+    The name of the device, as reported by
+    QExtMouse3DEventProvider::deviceNames().
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::vendorId
+    The USB vendor identifier of the device, or zero if it is not known.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::productId
+    The USB product identifier of the device, or zero if it is not known.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::axisRanges
+    The largest value that the device reports for each axis, in the
+    order translate X, Y, Z and rotate X, Y, Z.  These are the values
+    that QExtMouse3DNormalizedEvent is scaled with.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::buttonCount
+    The number of buttons on the device, or zero if it is not known.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::hasLcd
+    True if the device has an LCD screen that shows the state of the
+    application; false otherwise.
+*/
+
+/*!
+    \variable QExtMouse3DDeviceDescriptor::droppedSyncs
+    The number of times that the operating system has dropped input
+    from the device because it was not read quickly enough, so that
+    its state had to be read again.  A count that keeps growing means
+    that the application is not reading the device often enough, for
+    example because widget() takes too long to handle each event.
+*/
+
 QT_END_NAMESPACE
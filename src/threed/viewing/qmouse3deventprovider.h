@@ -54,9 +54,37 @@ QT_BEGIN_NAMESPACE
 QT_MODULE(Qt3d)
 
 class QExtMouse3DEventProviderPrivate;
+struct QExtMouse3DProviderState;
 
 class QWidget;
 
+class Q_QT3D_EXPORT QExtMouse3DMotionSink
+{
+public:
+    virtual ~QExtMouse3DMotionSink();
+
+    virtual void motion(const short values[6], qint64 timestamp) = 0;
+};
+
+struct QExtMouse3DDeviceDescriptor
+{
+    QExtMouse3DDeviceDescriptor()
+        : vendorId(0), productId(0), buttonCount(0), hasLcd(false)
+        , droppedSyncs(0)
+    {
+        for (int axis = 0; axis < 6; ++axis)
+            axisRanges[axis] = 0;
+    }
+
+    QString name;
+    int vendorId;
+    int productId;
+    int axisRanges[6];
+    int buttonCount;
+    bool hasLcd;
+    quint64 droppedSyncs;
+};
+
 class Q_QT3D_EXPORT QExtMouse3DEventProvider : public QObject
 {
     Q_OBJECT
@@ -66,10 +94,16 @@ public:
 
     bool isAvailable() const;
     QStringList deviceNames() const;
+    QList<QExtMouse3DDeviceDescriptor> deviceDescriptors
+        (quint64 *generation = 0) const;
+    quint64 deviceGeneration() const;
 
     QWidget *widget() const;
     void setWidget(QWidget *widget);
 
+    QObject *target() const;
+    void setTarget(QObject *target);
+
     enum Filter
     {
         NoFilters       = 0x0000,
@@ -91,6 +125,106 @@ public:
     qreal sensitivity() const;
     void setSensitivity(qreal value);
 
+    enum ReadMode
+    {
+        GuiThreadRead,
+        ReaderThreadRead,
+        AsyncRead
+    };
+
+    QExtMouse3DEventProvider::ReadMode readMode() const;
+    void setReadMode(QExtMouse3DEventProvider::ReadMode mode);
+
+    enum Aggregation
+    {
+        LastSample,
+        TimeWeightedAverage,
+        IntegratedDisplacement
+    };
+
+    QExtMouse3DEventProvider::Aggregation aggregation() const;
+    void setAggregation(QExtMouse3DEventProvider::Aggregation aggregation);
+
+    bool keepDevicesOpen() const;
+    void setKeepDevicesOpen(bool value);
+
+    bool adaptiveCalibration() const;
+    void setAdaptiveCalibration(bool value);
+
+    enum Scheduling
+    {
+        NormalScheduling,
+        FifoScheduling,
+        RoundRobinScheduling
+    };
+
+    QExtMouse3DEventProvider::Scheduling readerScheduling() const;
+    int readerPriority() const;
+    void setReaderScheduling
+        (QExtMouse3DEventProvider::Scheduling scheduling, int priority = 1);
+
+    QList<int> readerCpus() const;
+    void setReaderCpus(const QList<int> &cpus);
+
+    int readerBusyPollTime() const;
+    void setReaderBusyPollTime(int usecs);
+
+    int maximumWakeupRate() const;
+    void setMaximumWakeupRate(int rate);
+
+    enum Routing
+    {
+        ActiveWidgetRouting,
+        PointerRouting
+    };
+
+    QExtMouse3DEventProvider::Routing routing() const;
+    void setRouting(QExtMouse3DEventProvider::Routing routing);
+
+    enum Merging
+    {
+        NoMerging,
+        SumMerging,
+        PriorityMerging,
+        MostRecentMerging
+    };
+
+    QExtMouse3DEventProvider::Merging merging() const;
+    void setMerging(QExtMouse3DEventProvider::Merging merging);
+
+    QStringList devicePriority() const;
+    void setDevicePriority(const QStringList &deviceNames);
+
+    QStringList deviceBinding() const;
+    void setDeviceBinding(const QStringList &deviceNames);
+
+    enum Delivery
+    {
+        SynchronousDelivery,
+        PostedDelivery,
+        BatchedDelivery
+    };
+
+    QExtMouse3DEventProvider::Delivery delivery() const;
+    void setDelivery(QExtMouse3DEventProvider::Delivery delivery);
+
+    enum SinkThread
+    {
+        GuiThreadSink,
+        ReaderThreadSink
+    };
+
+    bool normalizedMotion() const;
+    void setNormalizedMotion(bool value);
+
+    QExtMouse3DMotionSink *motionSink() const;
+    QExtMouse3DEventProvider::SinkThread motionSinkThread() const;
+    void setMotionSink(QExtMouse3DMotionSink *sink,
+                       QExtMouse3DEventProvider::SinkThread thread =
+                            QExtMouse3DEventProvider::GuiThreadSink);
+
+    quint64 latestMotion(short values[6], qint64 *timestamp = 0) const;
+
 Q_SIGNALS:
     void availableChanged();
     void filtersChanged();
@@ -99,6 +233,12 @@ Q_SIGNALS:
 private:
     QScopedPointer<QExtMouse3DEventProviderPrivate> d_ptr;
 
+    QExtMouse3DProviderState state() const;
+    void publishMotion(const short values[6], qint64 timestamp);
+
+    friend class QExtMouse3DDevice;
+    friend class QExtMouse3DDeviceList;
+
     Q_DISABLE_COPY(QExtMouse3DEventProvider)
     Q_DECLARE_PRIVATE(QExtMouse3DEventProvider)
 };
@@ -0,0 +1,426 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dhidparser_p.h"
+#include "qglnamespace.h"
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QExtMouse3DHidParser
+    \internal
+    \brief The QExtMouse3DHidParser class decodes the HID input reports of 3Dconnexion 3D mice.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    3Dconnexion devices send their state in three HID input reports.
+    Report 1 holds the translation and report 2 the rotation, each as
+    three signed 16-bit little-endian values, and report 3 holds a
+    bitmask of the buttons that are held down.  Some devices send all
+    six axes in report 1 instead.  The reports are the same whichever
+    operating system interface delivers them, so the device plug-ins
+    hand the raw bytes to QExtMouse3DHidParser and only deal with
+    fetching the reports themselves.
+
+    A motion is reported once both halves of a sample have arrived.
+    The axis values are passed through calibration() before they are
+    made available with values().  Button reports are compared with
+    the previous one, so that changedButtons() lists each button that
+    was pressed or released exactly once.  Use buttonKey() and keyCode()
+    to turn a button number into a Qt key code.
+*/
+
+/*!
+    \enum QExtMouse3DHidParser::Result
+    This enum defines what was decoded from a report by parse().
+
+    \value NoResult Nothing needs to be delivered.
+    \value Motion values() holds a new motion.
+    \value Buttons changedButtons() holds the buttons that were
+        pressed or released.
+*/
+
+/*!
+    \enum QExtMouse3DHidParser::ProductId
+    This enum defines the USB product identifiers of the 3Dconnexion
+    devices whose buttons need special treatment.
+
+    \value UnknownProduct The product is not known.
+    \value SpacePilot 3Dconnexion SpacePilot.
+    \value SpaceNavigator 3Dconnexion SpaceNavigator.
+    \value SpaceExplorer 3Dconnexion SpaceExplorer.
+    \value SpaceNavigatorNotebook 3Dconnexion SpaceNavigator for Notebooks.
+    \value SpacePilotPRO 3Dconnexion SpacePilot PRO.
+*/
+
+/*!
+    \enum QExtMouse3DHidParser::Key
+    This enum defines the functions of the 3Dconnexion buttons.  The
+    values are the same as the low bits of the \c MSC_SCAN codes that
+    the Linux input layer reports for the buttons.
+
+    \value NoKey The button has no function.
+    \value MenuKey Menu, or the left button on a SpaceNavigator.
+    \value FitKey Fit to view, or the right button on a SpaceNavigator.
+    \value TopViewKey Switch to the top view.
+    \value LeftViewKey Switch to the left view.
+    \value RightViewKey Switch to the right view.
+    \value FrontViewKey Switch to the front view.
+    \value BottomViewKey Switch to the bottom view.
+    \value BackViewKey Switch to the back view.
+    \value RotateCW90Key Rotate 90 degrees clockwise.
+    \value RotateCCW90Key Rotate 90 degrees counter-clockwise.
+    \value ISO1Key Isometric top/front/right view.
+    \value ISO2Key Isometric top/back/left view.
+    \value Button1Key Custom function key 1.
+    \value Button2Key Custom function key 2.
+    \value Button3Key Custom function key 3.
+    \value Button4Key Custom function key 4.
+    \value Button5Key Custom function key 5.
+    \value Button6Key Custom function key 6.
+    \value Button7Key Custom function key 7.
+    \value Button8Key Custom function key 8.
+    \value Button9Key Custom function key 9.
+    \value Button10Key Custom function key 10.
+    \value EscapeKey Escape.
+    \value AltKey Alt.
+    \value ShiftKey Shift.
+    \value ControlKey Control.
+    \value RotationKey Toggle rotations on and off.
+    \value PanKey Toggle translations on and off.
+    \value DominantKey Toggle the dominant axis filter.
+    \value IncreaseSensitivityKey Increase the sensitivity.
+    \value DecreaseSensitivityKey Decrease the sensitivity.
+*/
+
+// Functions of the buttons, in bit order, on devices that do not
+// number their buttons in the order of QExtMouse3DHidParser::Key.
+static const QExtMouse3DHidParser::Key spaceExplorerKeys[] =
+{
+    QExtMouse3DHidParser::Button1Key,
+    QExtMouse3DHidParser::Button2Key,
+    QExtMouse3DHidParser::TopViewKey,
+    QExtMouse3DHidParser::LeftViewKey,
+    QExtMouse3DHidParser::RightViewKey,
+    QExtMouse3DHidParser::FrontViewKey,
+    QExtMouse3DHidParser::EscapeKey,
+    QExtMouse3DHidParser::AltKey,
+    QExtMouse3DHidParser::ShiftKey,
+    QExtMouse3DHidParser::ControlKey,
+    QExtMouse3DHidParser::FitKey,
+    QExtMouse3DHidParser::MenuKey,
+    QExtMouse3DHidParser::IncreaseSensitivityKey,
+    QExtMouse3DHidParser::DecreaseSensitivityKey,
+    QExtMouse3DHidParser::RotationKey
+};
+
+static const QExtMouse3DHidParser::Key spacePilotKeys[] =
+{
+    QExtMouse3DHidParser::Button1Key,
+    QExtMouse3DHidParser::Button2Key,
+    QExtMouse3DHidParser::Button3Key,
+    QExtMouse3DHidParser::Button4Key,
+    QExtMouse3DHidParser::Button5Key,
+    QExtMouse3DHidParser::Button6Key,
+    QExtMouse3DHidParser::TopViewKey,
+    QExtMouse3DHidParser::LeftViewKey,
+    QExtMouse3DHidParser::RightViewKey,
+    QExtMouse3DHidParser::FrontViewKey,
+    QExtMouse3DHidParser::EscapeKey,
+    QExtMouse3DHidParser::AltKey,
+    QExtMouse3DHidParser::ShiftKey,
+    QExtMouse3DHidParser::ControlKey,
+    QExtMouse3DHidParser::FitKey,
+    QExtMouse3DHidParser::MenuKey,
+    QExtMouse3DHidParser::IncreaseSensitivityKey,
+    QExtMouse3DHidParser::DecreaseSensitivityKey,
+    QExtMouse3DHidParser::DominantKey,
+    QExtMouse3DHidParser::RotationKey
+};
+
+/*!
+    Constructs a parser for an unknown product with the default
+    calibration, which passes axis values through unchanged.
+*/
+QExtMouse3DHidParser::QExtMouse3DHidParser()
+    : m_productId(UnknownProduct)
+{
+    reset();
+}
+
+/*!
+    \fn int QExtMouse3DHidParser::productId() const
+
+    Returns the USB product identifier of the device, which determines
+    the function of each button.
+
+    \sa setProductId(), buttonKey()
+*/
+
+/*!
+    \fn void QExtMouse3DHidParser::setProductId(int productId)
+
+    Sets the USB product identifier of the device to \a productId.
+
+    \sa productId()
+*/
+
+/*!
+    \fn QExtMouse3DCalibration *QExtMouse3DHidParser::calibration()
+
+    Returns the calibration that is applied to the axis values.
+*/
+
+/*!
+    Clears the axis values, the button state, and any half of a
+    sample that is waiting for the other half.
+*/
+void QExtMouse3DHidParser::reset()
+{
+    memset(m_values, 0, sizeof(m_values));
+    memset(m_tempValues, 0, sizeof(m_tempValues));
+    m_sawTranslate = false;
+    m_buttons = 0;
+    m_changedButtons = 0;
+}
+
+static inline int readShort(const uchar *data)
+{
+    return short(data[0] | (data[1] << 8));
+}
+
+void QExtMouse3DHidParser::setTranslation()
+{
+    m_calibration.calibrate(0, m_tempValues, m_values);
+    m_sawTranslate = false;
+}
+
+/*!
+    Decodes the input \a report of \a size bytes, starting with the
+    report number.  Returns a combination of Result flags that says
+    whether values() or changedButtons() have new contents.
+
+    A translation report is held until the matching rotation report
+    arrives, so that both halves of a sample are delivered together.
+    If another translation report arrives first, the held one is
+    reported on its own.  Reports that are too short or that are not
+    known are ignored.
+*/
+int QExtMouse3DHidParser::parse(const uchar *report, int size)
+{
+    if (size < 1)
+        return NoResult;
+    int result = NoResult;
+    switch (report[0]) {
+    case 0x01:
+        if (size < 7)
+            break;
+        if (m_sawTranslate) {
+            setTranslation();
+            result |= Motion;
+        }
+        m_tempValues[0] = readShort(report + 1);
+        m_tempValues[1] = readShort(report + 3);
+        m_tempValues[2] = readShort(report + 5);
+        if (size >= 13) {
+            // All six axes in a single report.
+            m_tempValues[3] = readShort(report + 7);
+            m_tempValues[4] = readShort(report + 9);
+            m_tempValues[5] = readShort(report + 11);
+            setTranslation();
+            m_calibration.calibrate(3, m_tempValues + 3, m_values + 3);
+            result |= Motion;
+        } else {
+            m_sawTranslate = true;
+        }
+        break;
+
+    case 0x02:
+        if (size < 7)
+            break;
+        m_tempValues[3] = readShort(report + 1);
+        m_tempValues[4] = readShort(report + 3);
+        m_tempValues[5] = readShort(report + 5);
+        if (m_sawTranslate)
+            setTranslation();
+        m_calibration.calibrate(3, m_tempValues + 3, m_values + 3);
+        result |= Motion;
+        break;
+
+    case 0x03:
+    {
+        quint32 buttons = 0;
+        for (int index = 1; index < size && index <= 4; ++index)
+            buttons |= quint32(report[index]) << ((index - 1) * 8);
+        m_changedButtons = buttons ^ m_buttons;
+        m_buttons = buttons;
+        if (m_changedButtons)
+            result |= Buttons;
+        break;
+    }
+
+    default: break;
+    }
+    return result;
+}
+
+/*!
+    \fn const int *QExtMouse3DHidParser::values() const
+
+    Returns the six calibrated axis values of the last motion:
+    the translations along X, Y and Z, followed by the rotations
+    around X, Y and Z.
+*/
+
+/*!
+    \fn quint32 QExtMouse3DHidParser::buttons() const
+
+    Returns the bitmask of the buttons that are held down, with
+    button 0 in the least significant bit.
+
+    \sa changedButtons()
+*/
+
+/*!
+    \fn quint32 QExtMouse3DHidParser::changedButtons() const
+
+    Returns the bitmask of the buttons that were pressed or released
+    by the last button report.
+
+    \sa buttons()
+*/
+
+/*!
+    Returns the function of \a button, numbered from zero in the
+    order of the bits in buttons(), on the device with productId().
+*/
+QExtMouse3DHidParser::Key QExtMouse3DHidParser::buttonKey(int button) const
+{
+    if (button < 0)
+        return NoKey;
+    switch (m_productId) {
+    case SpacePilot:
+        if (button < int(sizeof(spacePilotKeys) / sizeof(spacePilotKeys[0])))
+            return spacePilotKeys[button];
+        return NoKey;
+    case SpaceExplorer:
+        if (button < int(sizeof(spaceExplorerKeys) / sizeof(spaceExplorerKeys[0])))
+            return spaceExplorerKeys[button];
+        return NoKey;
+    default: break;
+    }
+    if (button + 1 > DecreaseSensitivityKey)
+        return NoKey;
+    return Key(button + 1);
+}
+
+/*!
+    Returns the number of buttons on the device with productId(), or
+    zero if the product is not known.
+*/
+int QExtMouse3DHidParser::buttonCount() const
+{
+    switch (m_productId) {
+    case SpaceNavigator:
+    case SpaceNavigatorNotebook:
+        return 2;
+    case SpacePilot:
+        return int(sizeof(spacePilotKeys) / sizeof(spacePilotKeys[0]));
+    case SpaceExplorer:
+        return int(sizeof(spaceExplorerKeys) / sizeof(spaceExplorerKeys[0]));
+    case SpacePilotPRO:
+        return int(DecreaseSensitivityKey);
+    default: break;
+    }
+    return 0;
+}
+
+/*!
+    Returns the Qt key code for \a key, or -1 if \a key has no key
+    code.  The result is either a Qt::Key or a QGL::Mouse3DKeys value.
+    On a SpaceNavigator, which has only two buttons, \a spaceNavigator
+    should be true so that the buttons are used as translation and
+    rotation locks instead of MenuKey and FitKey.
+*/
+int QExtMouse3DHidParser::keyCode(Key key, bool spaceNavigator)
+{
+    switch (key) {
+    case MenuKey:
+        return spaceNavigator ? int(QGL::Key_Translations) : int(Qt::Key_Menu);
+    case FitKey:
+        return spaceNavigator ? int(QGL::Key_Rotations) : int(QGL::Key_Fit);
+    case TopViewKey:                return QGL::Key_TopView;
+    case LeftViewKey:               return QGL::Key_LeftView;
+    case RightViewKey:              return QGL::Key_RightView;
+    case FrontViewKey:              return QGL::Key_FrontView;
+    case BottomViewKey:             return QGL::Key_BottomView;
+    case BackViewKey:               return QGL::Key_BackView;
+    case RotateCW90Key:             return QGL::Key_RotateCW90;
+    case RotateCCW90Key:            return QGL::Key_RotateCCW90;
+    case ISO1Key:                   return QGL::Key_ISO1;
+    case ISO2Key:                   return QGL::Key_ISO2;
+    case Button1Key:                return QGL::Key_Button1;
+    case Button2Key:                return QGL::Key_Button2;
+    case Button3Key:                return QGL::Key_Button3;
+    case Button4Key:                return QGL::Key_Button4;
+    case Button5Key:                return QGL::Key_Button5;
+    case Button6Key:                return QGL::Key_Button6;
+    case Button7Key:                return QGL::Key_Button7;
+    case Button8Key:                return QGL::Key_Button8;
+    case Button9Key:                return QGL::Key_Button9;
+    case Button10Key:               return QGL::Key_Button10;
+    case EscapeKey:                 return Qt::Key_Escape;
+    case AltKey:                    return Qt::Key_Alt;
+    case ShiftKey:                  return Qt::Key_Shift;
+    case ControlKey:                return Qt::Key_Control;
+    case RotationKey:               return QGL::Key_Rotations;
+    case PanKey:                    return QGL::Key_Translations;
+    case DominantKey:               return QGL::Key_DominantAxis;
+    case IncreaseSensitivityKey:    return QGL::Key_IncreaseSensitivity;
+    case DecreaseSensitivityKey:    return QGL::Key_DecreaseSensitivity;
+    default: break;
+    }
+    return -1;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DHIDPARSER_P_H
+#define QMOUSE3DHIDPARSER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qmouse3dcalibration_p.h"
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+QT_MODULE(Qt3d)
+
+class Q_QT3D_EXPORT QExtMouse3DHidParser
+{
+public:
+    QExtMouse3DHidParser();
+
+    enum Result
+    {
+        NoResult        = 0x0000,
+        Motion          = 0x0001,
+        Buttons         = 0x0002
+    };
+
+    enum ProductId
+    {
+        UnknownProduct          = 0x0000,
+        SpacePilot              = 0xc625,
+        SpaceNavigator          = 0xc626,
+        SpaceExplorer           = 0xc627,
+        SpaceNavigatorNotebook  = 0xc628,
+        SpacePilotPRO           = 0xc629
+    };
+
+    enum Key
+    {
+        NoKey,
+        MenuKey,
+        FitKey,
+        TopViewKey,
+        LeftViewKey,
+        RightViewKey,
+        FrontViewKey,
+        BottomViewKey,
+        BackViewKey,
+        RotateCW90Key,
+        RotateCCW90Key,
+        ISO1Key,
+        ISO2Key,
+        Button1Key,
+        Button2Key,
+        Button3Key,
+        Button4Key,
+        Button5Key,
+        Button6Key,
+        Button7Key,
+        Button8Key,
+        Button9Key,
+        Button10Key,
+        EscapeKey,
+        AltKey,
+        ShiftKey,
+        ControlKey,
+        RotationKey,
+        PanKey,
+        DominantKey,
+        IncreaseSensitivityKey,
+        DecreaseSensitivityKey
+    };
+
+    int productId() const { return m_productId; }
+    void setProductId(int productId) { m_productId = productId; }
+
+    QExtMouse3DCalibration *calibration() { return &m_calibration; }
+
+    void reset();
+    int parse(const uchar *report, int size);
+
+    const int *values() const { return m_values; }
+    quint32 buttons() const { return m_buttons; }
+    quint32 changedButtons() const { return m_changedButtons; }
+
+    Key buttonKey(int button) const;
+    int buttonCount() const;
+    static int keyCode(Key key, bool spaceNavigator);
+
+private:
+    int m_productId;
+    QExtMouse3DCalibration m_calibration;
+    int m_values[6];
+    int m_tempValues[6];
+    bool m_sawTranslate;
+    quint32 m_buttons;
+    quint32 m_changedButtons;
+
+    void setTranslation();
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
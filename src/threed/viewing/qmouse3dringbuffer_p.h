@@ -0,0 +1,124 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DRINGBUFFER_P_H
+#define QMOUSE3DRINGBUFFER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+#include "qt3dglobal.h"
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+QT_MODULE(Qt3d)
+
+// Bounded single-producer/single-consumer queue.  One thread may call
+// push() and one other thread may call pop() without any locking.
+// Size must be a power of two; one slot is always kept free to tell
+// a full ring from an empty one.
+template <typename T, int Size>
+class QExtMouse3DRingBuffer
+{
+public:
+    QExtMouse3DRingBuffer() : head(0), tail(0) {}
+
+    bool push(const T &value);
+    bool pop(T *value);
+
+    bool isEmpty() const;
+
+private:
+    QAtomicInt head;    // Written by the producer only.
+    char padding[64 - sizeof(QAtomicInt)];
+    QAtomicInt tail;    // Written by the consumer only.
+    T items[Size];
+
+    Q_DISABLE_COPY(QExtMouse3DRingBuffer)
+};
+
+template <typename T, int Size>
+Q_INLINE_TEMPLATE bool QExtMouse3DRingBuffer<T, Size>::push(const T &value)
+{
+    int current = head;
+    int next = (current + 1) & (Size - 1);
+    if (next == tail.fetchAndAddAcquire(0))
+        return false;   // Full.
+    items[current] = value;
+    head.fetchAndStoreRelease(next);
+    return true;
+}
+
+template <typename T, int Size>
+Q_INLINE_TEMPLATE bool QExtMouse3DRingBuffer<T, Size>::pop(T *value)
+{
+    int current = tail;
+    if (current == head.fetchAndAddAcquire(0))
+        return false;   // Empty.
+    *value = items[current];
+    tail.fetchAndStoreRelease((current + 1) & (Size - 1));
+    return true;
+}
+
+template <typename T, int Size>
+Q_INLINE_TEMPLATE bool QExtMouse3DRingBuffer<T, Size>::isEmpty() const
+{
+    QAtomicInt *h = const_cast<QAtomicInt *>(&head);
+    QAtomicInt *t = const_cast<QAtomicInt *>(&tail);
+    return h->fetchAndAddAcquire(0) == t->fetchAndAddAcquire(0);
+}
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
@@ -0,0 +1,114 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DSEQLOCK_P_H
+#define QMOUSE3DSEQLOCK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/qatomic.h>
+#include "qt3dglobal.h"
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+QT_MODULE(Qt3d)
+
+// Single-writer sequence lock.  One thread may call write() while any
+// number of other threads call read() without blocking the writer.
+// The sequence is odd while a write is in progress; a reader retries
+// until it has copied the value between two identical even sequences.
+// T must be a plain value type that can be copied while being written.
+template <typename T>
+class QExtMouse3DSeqLock
+{
+public:
+    QExtMouse3DSeqLock() : sequence(0), value() {}
+
+    void write(const T &newValue);
+    void read(T *result) const;
+
+private:
+    QAtomicInt sequence;
+    T value;
+
+    Q_DISABLE_COPY(QExtMouse3DSeqLock)
+};
+
+template <typename T>
+Q_INLINE_TEMPLATE void QExtMouse3DSeqLock<T>::write(const T &newValue)
+{
+    sequence.fetchAndAddOrdered(1);
+    value = newValue;
+    sequence.fetchAndAddRelease(1);
+}
+
+template <typename T>
+Q_INLINE_TEMPLATE void QExtMouse3DSeqLock<T>::read(T *result) const
+{
+    QAtomicInt *seq = const_cast<QAtomicInt *>(&sequence);
+    int before, after;
+    do {
+        before = seq->fetchAndAddAcquire(0);
+        if (before & 1)
+            continue;   // Write in progress.
+        *result = value;
+        after = seq->fetchAndAddOrdered(0);
+        if (before == after)
+            return;
+    } while (true);
+}
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
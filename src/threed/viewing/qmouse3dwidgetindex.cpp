@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qmouse3dwidgetindex_p.h"
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QExtMouse3DWidgetIndex
+    \internal
+    \brief The QExtMouse3DWidgetIndex class finds the registered widget under a point.
+    \since 4.8
+    \ingroup qt3d
+    \ingroup qt3d::viewing
+
+    QExtMouse3DDeviceList uses this class to route 3D mouse input to
+    the widget under the pointer.  Each widget is stored with its
+    window and its rectangle in that window's coordinates, so moving
+    a whole window does not invalidate the index.
+
+    The rectangles are bucketed into a grid of square cells that are
+    CellSize pixels wide.  widgetAt() only looks at the widgets in the
+    cell that contains the point, and insert() and remove() only touch
+    the cells that the widget covers, so the index can be kept up to
+    date from the move and resize events of the individual widgets.
+*/
+
+// Rounds towards negative infinity so that cells do not straddle zero.
+static inline int cellOf(int value)
+{
+    const int size = QExtMouse3DWidgetIndex::CellSize;
+    return value >= 0 ? value / size : -((-value - 1) / size) - 1;
+}
+
+static inline quint64 cellKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint64(quint32(y));
+}
+
+/*!
+    Returns the rectangle of \a widget in its window's coordinates,
+    or a null rectangle if \a widget is not in the index.
+*/
+QRect QExtMouse3DWidgetIndex::rect(QWidget *widget) const
+{
+    QHash<QWidget *, Entry>::ConstIterator it = entries.constFind(widget);
+    if (it == entries.constEnd())
+        return QRect();
+    return it.value().rect;
+}
+
+/*!
+    Returns the widgets in the index that belong to \a window.
+*/
+QList<QWidget *> QExtMouse3DWidgetIndex::widgets(QWidget *window) const
+{
+    QList<QWidget *> result;
+    QHash<QWidget *, Entry>::ConstIterator it;
+    for (it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (it.value().window == window)
+            result.append(it.key());
+    }
+    return result;
+}
+
+/*!
+    Adds \a widget to the index, covering \a rect in the coordinates
+    of \a window.  If \a widget is already in the index, its previous
+    window and rectangle are replaced.
+*/
+void QExtMouse3DWidgetIndex::insert
+    (QWidget *widget, QWidget *window, const QRect &rect)
+{
+    QHash<QWidget *, Entry>::Iterator it = entries.find(widget);
+    if (it != entries.end()) {
+        if (it.value().window == window && it.value().rect == rect)
+            return;
+        removeFromCells(widget, it.value().rect);
+    } else {
+        it = entries.insert(widget, Entry());
+    }
+    it.value().window = window;
+    it.value().rect = rect;
+    addToCells(widget, rect);
+}
+
+/*!
+    Removes \a widget from the index.
+*/
+void QExtMouse3DWidgetIndex::remove(QWidget *widget)
+{
+    QHash<QWidget *, Entry>::Iterator it = entries.find(widget);
+    if (it == entries.end())
+        return;
+    removeFromCells(widget, it.value().rect);
+    entries.erase(it);
+}
+
+/*!
+    Removes all widgets from the index.
+*/
+void QExtMouse3DWidgetIndex::clear()
+{
+    entries.clear();
+    cells.clear();
+}
+
+/*!
+    Returns the widget of \a window whose rectangle contains \a pos,
+    in the coordinates of \a window, or null if there is none.  If
+    several rectangles contain \a pos, as happens when one registered
+    widget is nested in another, the smallest one is returned.
+*/
+QWidget *QExtMouse3DWidgetIndex::widgetAt
+    (QWidget *window, const QPoint &pos) const
+{
+    QHash<quint64, QVector<QWidget *> >::ConstIterator cell =
+        cells.constFind(cellKey(cellOf(pos.x()), cellOf(pos.y())));
+    if (cell == cells.constEnd())
+        return 0;
+    QWidget *result = 0;
+    qint64 resultArea = 0;
+    const QVector<QWidget *> &candidates = cell.value();
+    for (int index = 0; index < candidates.size(); ++index) {
+        QWidget *widget = candidates.at(index);
+        const Entry &entry = entries[widget];
+        if (entry.window != window || !entry.rect.contains(pos))
+            continue;
+        qint64 area = qint64(entry.rect.width()) * entry.rect.height();
+        if (!result || area < resultArea) {
+            result = widget;
+            resultArea = area;
+        }
+    }
+    return result;
+}
+
+void QExtMouse3DWidgetIndex::addToCells(QWidget *widget, const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+    int right = cellOf(rect.right());
+    int bottom = cellOf(rect.bottom());
+    for (int y = cellOf(rect.top()); y <= bottom; ++y) {
+        for (int x = cellOf(rect.left()); x <= right; ++x)
+            cells[cellKey(x, y)].append(widget);
+    }
+}
+
+void QExtMouse3DWidgetIndex::removeFromCells(QWidget *widget, const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+    int right = cellOf(rect.right());
+    int bottom = cellOf(rect.bottom());
+    for (int y = cellOf(rect.top()); y <= bottom; ++y) {
+        for (int x = cellOf(rect.left()); x <= right; ++x) {
+            QHash<quint64, QVector<QWidget *> >::Iterator cell =
+                cells.find(cellKey(x, y));
+            if (cell == cells.end())
+                continue;
+            QVector<QWidget *> &list = cell.value();
+            int index = list.indexOf(widget);
+            if (index >= 0)
+                list.remove(index);
+            if (list.isEmpty())
+                cells.erase(cell);
+        }
+    }
+}
+
+QT_END_NAMESPACE
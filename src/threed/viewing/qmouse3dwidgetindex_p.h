@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QMOUSE3DWIDGETINDEX_P_H
+#define QMOUSE3DWIDGETINDEX_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "qt3dglobal.h"
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qrect.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_HEADER
+
+QT_BEGIN_NAMESPACE
+
+QT_MODULE(Qt3d)
+
+class QWidget;
+
+class Q_QT3D_EXPORT QExtMouse3DWidgetIndex
+{
+public:
+    QExtMouse3DWidgetIndex() {}
+
+    // Edge length of the square cells of the grid, in pixels.
+    enum { CellSize = 128 };
+
+    bool isEmpty() const { return entries.isEmpty(); }
+    bool contains(QWidget *widget) const { return entries.contains(widget); }
+    QRect rect(QWidget *widget) const;
+    QList<QWidget *> widgets(QWidget *window) const;
+
+    void insert(QWidget *widget, QWidget *window, const QRect &rect);
+    void remove(QWidget *widget);
+    void clear();
+
+    QWidget *widgetAt(QWidget *window, const QPoint &pos) const;
+
+private:
+    struct Entry
+    {
+        QWidget *window;
+        QRect rect;
+    };
+
+    QHash<QWidget *, Entry> entries;
+    QHash<quint64, QVector<QWidget *> > cells;
+
+    void addToCells(QWidget *widget, const QRect &rect);
+    void removeFromCells(QWidget *widget, const QRect &rect);
+};
+
+QT_END_NAMESPACE
+
+QT_END_HEADER
+
+#endif
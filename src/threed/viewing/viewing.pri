@@ -7,13 +7,21 @@ HEADERS += \
     qmouse3deventprovider.h
 
 SOURCES += \
+    qmouse3dcalibration.cpp \
     qmouse3ddevice.cpp \
     qmouse3ddevicelist.cpp \
     qmouse3ddeviceplugin.cpp \
     qmouse3devent.cpp \
-    qmouse3deventprovider.cpp
+    qmouse3deventprovider.cpp \
+    qmouse3dhidparser.cpp \
+    qmouse3dwidgetindex.cpp
 
 PRIVATE_HEADERS += \
+    qmouse3dcalibration_p.h \
     qmouse3ddevice_p.h \
     qmouse3ddevicelist_p.h \
-    qmouse3ddeviceplugin_p.h
+    qmouse3ddeviceplugin_p.h \
+    qmouse3dhidparser_p.h \
+    qmouse3dringbuffer_p.h \
+    qmouse3dseqlock_p.h \
+    qmouse3dwidgetindex_p.h
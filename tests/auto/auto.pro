@@ -1,2 +1,3 @@
 TEMPLATE = subdirs
 SUBDIRS = threed
+linux*:SUBDIRS += linuxinput linuxinputdevice
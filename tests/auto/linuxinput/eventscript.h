@@ -0,0 +1,122 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef EVENTSCRIPT_H
+#define EVENTSCRIPT_H
+
+#include <QtCore/qvector.h>
+#include <linux/input.h>
+#include <string.h>
+#include <unistd.h>
+
+// Builds a stream of struct input_event records, as a 3D mouse
+// would report them, that can be written to a socket, pipe or FIFO
+// and then read back by the parser or the device.  Shared by the
+// linuxinput and linuxinputdevice tests.
+class EventScript
+{
+public:
+    EventScript() : time(1000000) {}
+
+    void abs(int code, int value) { append(EV_ABS, code, value); }
+    void motion(int x, int y, int z, int rx, int ry, int rz);
+    void translate(int x, int y, int z);
+    void key(int scanCode, bool press);
+    void report() { append(EV_SYN, SYN_REPORT, 0); time += 8000; }
+    void dropped() { append(EV_SYN, SYN_DROPPED, 0); }
+
+    int size() const { return events.size(); }
+    bool writeTo(int fd) const;
+
+    // Timestamp of the next SYN_REPORT, in microseconds.
+    qint64 time;
+
+private:
+    QVector<struct input_event> events;
+
+    void append(int type, int code, int value);
+};
+
+inline void EventScript::append(int type, int code, int value)
+{
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.time.tv_sec = time / 1000000;
+    event.time.tv_usec = time % 1000000;
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    events.append(event);
+}
+
+inline void EventScript::motion(int x, int y, int z, int rx, int ry, int rz)
+{
+    abs(ABS_X, x);
+    abs(ABS_Y, y);
+    abs(ABS_Z, z);
+    abs(ABS_RX, rx);
+    abs(ABS_RY, ry);
+    abs(ABS_RZ, rz);
+    report();
+}
+
+inline void EventScript::translate(int x, int y, int z)
+{
+    abs(ABS_X, x);
+    abs(ABS_Y, y);
+    abs(ABS_Z, z);
+    report();
+}
+
+inline void EventScript::key(int scanCode, bool press)
+{
+    append(EV_MSC, MSC_SCAN, scanCode);
+    append(EV_KEY, BTN_0 + (scanCode & 0x1f) - 1, press ? 1 : 0);
+    report();
+}
+
+inline bool EventScript::writeTo(int fd) const
+{
+    int size = events.size() * sizeof(struct input_event);
+    return ::write(fd, events.constData(), size) == size;
+}
+
+#endif
@@ -0,0 +1,16 @@
+load(qttest_p4.prf)
+TEMPLATE=app
+QT += testlib
+CONFIG += unittest warn_on
+
+TARGET = tst_qmouse3dlinuxinputparser
+
+LINUXINPUT = ../../../src/plugins/mouse3d/linuxinput
+INCLUDEPATH += $$LINUXINPUT
+HEADERS += eventscript.h
+SOURCES += tst_qmouse3dlinuxinputparser.cpp \
+           $$LINUXINPUT/qmouse3dlinuxinputparser.cpp
+
+LIBS += -L../../../lib -L../../../bin
+
+include(../../../src/threed/threed_dep.pri)
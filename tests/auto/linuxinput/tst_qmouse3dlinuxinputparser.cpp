@@ -0,0 +1,411 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include "qmouse3dlinuxinputparser.h"
+#include "qglnamespace.h"
+#include "eventscript.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+class tst_QExtMouse3DLinuxInputParser : public QObject
+{
+    Q_OBJECT
+public:
+    tst_QExtMouse3DLinuxInputParser() {}
+    ~tst_QExtMouse3DLinuxInputParser() {}
+
+private slots:
+    void init();
+    void cleanup();
+    void motion();
+    void partialMotion();
+    void maskedAxes();
+    void flatFiltering_data();
+    void flatFiltering();
+    void keys();
+    void keyCode_data();
+    void keyCode();
+    void droppedEvents();
+    void batchBoundaries();
+    void parseThroughput();
+
+private:
+    int fds[2];
+
+    QList<QExtMouse3DLinuxInputPacket> readPackets
+        (QExtMouse3DLinuxInputParser *parser);
+};
+
+// Each test gets a fresh socket pair: the test writes the scripted
+// events to fds[1] and the parser reads them from fds[0], which is
+// non-blocking like the /dev/input nodes that the plug-in opens.
+void tst_QExtMouse3DLinuxInputParser::init()
+{
+    QVERIFY(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+}
+
+void tst_QExtMouse3DLinuxInputParser::cleanup()
+{
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// Drains the socket the way QExtMouse3DLinuxInputDevice::readyRead()
+// does and returns the decoded packets.
+QList<QExtMouse3DLinuxInputPacket> tst_QExtMouse3DLinuxInputParser::readPackets
+    (QExtMouse3DLinuxInputParser *parser)
+{
+    QList<QExtMouse3DLinuxInputPacket> packets;
+    QExtMouse3DLinuxInputPacket packet;
+    int count;
+    do {
+        count = parser->readEvents(fds[0]);
+        while (parser->nextPacket(&packet))
+            packets.append(packet);
+    } while (count == QExtMouse3DLinuxInputParser::BatchSize);
+    return packets;
+}
+
+void tst_QExtMouse3DLinuxInputParser::motion()
+{
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    qint64 time = script.time;
+    script.motion(10, -20, 30, -40, 50, -60);
+    script.motion(100, 200, 300, 400, 500, 600);
+    QVERIFY(script.writeTo(fds[1]));
+
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 2);
+
+    QCOMPARE(packets[0].type, int(QExtMouse3DLinuxInputPacket::Motion));
+    QCOMPARE(packets[0].values[0], 10);
+    QCOMPARE(packets[0].values[1], -20);
+    QCOMPARE(packets[0].values[2], 30);
+    QCOMPARE(packets[0].values[3], -40);
+    QCOMPARE(packets[0].values[4], 50);
+    QCOMPARE(packets[0].values[5], -60);
+    QCOMPARE(packets[0].timestamp, time);
+
+    QCOMPARE(packets[1].type, int(QExtMouse3DLinuxInputPacket::Motion));
+    QCOMPARE(packets[1].values[0], 100);
+    QCOMPARE(packets[1].values[5], 600);
+    QCOMPARE(packets[1].timestamp, time + 8000);
+
+    QCOMPARE(parser.eventsRead(), quint64(script.size()));
+}
+
+// A report that only moves the translation axes keeps the last
+// rotation values, and vice versa.
+void tst_QExtMouse3DLinuxInputParser::partialMotion()
+{
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    script.motion(10, 20, 30, 40, 50, 60);
+    script.translate(-1, -2, -3);
+    script.abs(ABS_RY, 7);
+    script.report();
+    QVERIFY(script.writeTo(fds[1]));
+
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 3);
+
+    QCOMPARE(packets[1].values[0], -1);
+    QCOMPARE(packets[1].values[1], -2);
+    QCOMPARE(packets[1].values[2], -3);
+    QCOMPARE(packets[1].values[3], 40);
+    QCOMPARE(packets[1].values[4], 50);
+    QCOMPARE(packets[1].values[5], 60);
+
+    QCOMPARE(packets[2].values[0], -1);
+    QCOMPARE(packets[2].values[3], 0);
+    QCOMPARE(packets[2].values[4], 7);
+    QCOMPARE(packets[2].values[5], 0);
+}
+
+// Axes that the event mask hides read as centered from then on, even
+// when resync() or events that were queued before the mask was set
+// report them, so that the mouse can still go flat.
+void tst_QExtMouse3DLinuxInputParser::maskedAxes()
+{
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    script.motion(10, 20, 30, 40, 50, 60);
+    QVERIFY(script.writeTo(fds[1]));
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 1);
+    QCOMPARE(packets[0].values[3], 40);
+
+    parser.setMaskedAxes(false, true);
+    EventScript translations;
+    translations.translate(-1, -2, -3);
+    translations.abs(ABS_RX, 45);
+    translations.report();
+    translations.translate(0, 0, 0);
+    QVERIFY(translations.writeTo(fds[1]));
+    packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 3);
+    QCOMPARE(packets[0].values[0], -1);
+    QCOMPARE(packets[0].values[3], 0);
+    QCOMPARE(packets[0].values[4], 0);
+    QCOMPARE(packets[0].values[5], 0);
+    QCOMPARE(packets[1].values[3], 0);
+    for (int axis = 0; axis < 6; ++axis)
+        QCOMPARE(packets[2].values[axis], 0);
+
+    // Once unmasked, the rotations are tracked again.
+    parser.setMaskedAxes(false, false);
+    EventScript rotations;
+    rotations.abs(ABS_RY, 7);
+    rotations.report();
+    QVERIFY(rotations.writeTo(fds[1]));
+    packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 1);
+    QCOMPARE(packets[0].values[4], 7);
+}
+
+void tst_QExtMouse3DLinuxInputParser::flatFiltering_data()
+{
+    QTest::addColumn<int>("x");
+    QTest::addColumn<int>("y");
+    QTest::addColumn<int>("z");
+    QTest::addColumn<bool>("flat");
+
+    QTest::newRow("center") << 0 << 0 << 0 << true;
+    QTest::newRow("noise") << 5 << -7 << 3 << true;
+    QTest::newRow("edge") << 16 << 0 << 0 << true;
+    QTest::newRow("diagonal noise") << 8 << 8 << -8 << true;
+    QTest::newRow("push") << 40 << 0 << 0 << false;
+    QTest::newRow("diagonal push") << 15 << 15 << 15 << false;
+    QTest::newRow("full") << -500 << 0 << 0 << false;
+}
+
+// The socket cannot answer EVIOCGABS, so probeAxes() falls back to
+// a range of -500 to 500 with a radial dead zone of 16.
+void tst_QExtMouse3DLinuxInputParser::flatFiltering()
+{
+    QFETCH(int, x);
+    QFETCH(int, y);
+    QFETCH(int, z);
+    QFETCH(bool, flat);
+
+    QExtMouse3DLinuxInputParser parser;
+    parser.probeAxes(fds[0]);
+    QCOMPARE(parser.calibration()->deadZone(0), 16);
+    QCOMPARE(parser.calibration()->maximum(5), 500);
+
+    EventScript script;
+    script.translate(x, y, z);
+    QVERIFY(script.writeTo(fds[1]));
+
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 1);
+    const int *values = packets[0].values;
+    bool isFlat = (values[0] == 0 && values[1] == 0 && values[2] == 0);
+    QCOMPARE(isFlat, flat);
+    if (!flat) {
+        // Values outside the dead zone keep their sign and never
+        // grow beyond the raw value.
+        QVERIFY(values[0] * x >= 0 && qAbs(values[0]) <= qAbs(x));
+        QVERIFY(values[1] * y >= 0 && qAbs(values[1]) <= qAbs(y));
+        QVERIFY(values[2] * z >= 0 && qAbs(values[2]) <= qAbs(z));
+    }
+    if (qAbs(x) == 500)
+        QCOMPARE(qAbs(values[0]), 500);
+}
+
+void tst_QExtMouse3DLinuxInputParser::keys()
+{
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    script.key(0x90003, true);
+    script.key(0x90003, false);
+    script.key(0x12345, true);
+    script.motion(1, 2, 3, 4, 5, 6);
+    script.key(0x9001f, true);
+
+    // Keys are ignored unless the device is known to report them.
+    QVERIFY(script.writeTo(fds[1]));
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 1);
+    QCOMPARE(packets[0].type, int(QExtMouse3DLinuxInputPacket::Motion));
+
+    parser.reset();
+    parser.setDecodeKeys(true);
+    QVERIFY(script.writeTo(fds[1]));
+    packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 4);
+    QCOMPARE(packets[0].type, int(QExtMouse3DLinuxInputPacket::KeyPress));
+    QCOMPARE(packets[0].key, 0x90003);
+    QCOMPARE(packets[1].type, int(QExtMouse3DLinuxInputPacket::KeyRelease));
+    QCOMPARE(packets[1].key, 0x90003);
+    QCOMPARE(packets[2].type, int(QExtMouse3DLinuxInputPacket::Motion));
+    QCOMPARE(packets[3].type, int(QExtMouse3DLinuxInputPacket::KeyPress));
+    QCOMPARE(packets[3].key, 0x9001f);
+}
+
+void tst_QExtMouse3DLinuxInputParser::keyCode_data()
+{
+    QTest::addColumn<int>("scanCode");
+    QTest::addColumn<bool>("spaceNavigator");
+    QTest::addColumn<int>("key");
+
+    QTest::newRow("menu") << 0x90001 << false << int(Qt::Key_Menu);
+    QTest::newRow("menu (SpaceNavigator)")
+        << 0x90001 << true << int(QGL::Key_Translations);
+    QTest::newRow("fit") << 0x90002 << false << int(QGL::Key_Fit);
+    QTest::newRow("fit (SpaceNavigator)")
+        << 0x90002 << true << int(QGL::Key_Rotations);
+    QTest::newRow("top view") << 0x90003 << false << int(QGL::Key_TopView);
+    QTest::newRow("iso2") << 0x9000c << false << int(QGL::Key_ISO2);
+    QTest::newRow("F1") << 0x9000d << false << int(QGL::Key_Button1);
+    QTest::newRow("F10") << 0x90016 << false << int(QGL::Key_Button10);
+    QTest::newRow("escape") << 0x90017 << false << int(Qt::Key_Escape);
+    QTest::newRow("control") << 0x9001a << false << int(Qt::Key_Control);
+    QTest::newRow("rotation") << 0x9001b << false << int(QGL::Key_Rotations);
+    QTest::newRow("pan") << 0x9001c << true << int(QGL::Key_Translations);
+    QTest::newRow("dominant") << 0x9001d << false << int(QGL::Key_DominantAxis);
+    QTest::newRow("increase")
+        << 0x9001e << false << int(QGL::Key_IncreaseSensitivity);
+    QTest::newRow("decrease")
+        << 0x9001f << false << int(QGL::Key_DecreaseSensitivity);
+    QTest::newRow("unknown") << 0x90020 << false << -1;
+}
+
+void tst_QExtMouse3DLinuxInputParser::keyCode()
+{
+    QFETCH(int, scanCode);
+    QFETCH(bool, spaceNavigator);
+    QFETCH(int, key);
+
+    QCOMPARE(QExtMouse3DLinuxInputParser::keyCode(scanCode, spaceNavigator), key);
+}
+
+// Everything between SYN_DROPPED and the next SYN_REPORT is thrown
+// away and replaced by a Resync packet.
+void tst_QExtMouse3DLinuxInputParser::droppedEvents()
+{
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    script.motion(10, 20, 30, 40, 50, 60);
+    script.abs(ABS_X, 111);
+    script.dropped();
+    script.abs(ABS_Y, 222);
+    script.report();
+    script.motion(1, 2, 3, 4, 5, 6);
+    QVERIFY(script.writeTo(fds[1]));
+
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), 3);
+    QCOMPARE(packets[0].type, int(QExtMouse3DLinuxInputPacket::Motion));
+    QCOMPARE(packets[1].type, int(QExtMouse3DLinuxInputPacket::Resync));
+    QCOMPARE(packets[2].type, int(QExtMouse3DLinuxInputPacket::Motion));
+    QCOMPARE(packets[2].values[0], 1);
+    QCOMPARE(packets[2].values[5], 6);
+    QCOMPARE(parser.droppedSyncs(), quint64(1));
+
+    // The socket has no absolute axis state, so resync() reports
+    // the axes as being at rest.
+    QExtMouse3DLinuxInputPacket packet = packets[1];
+    parser.resync(fds[0], &packet);
+    QCOMPARE(packet.type, int(QExtMouse3DLinuxInputPacket::Motion));
+    for (int index = 0; index < 6; ++index)
+        QCOMPARE(packet.values[index], 0);
+}
+
+// Packets that straddle two read() calls are put back together.
+void tst_QExtMouse3DLinuxInputParser::batchBoundaries()
+{
+    const int count = 100;
+    QExtMouse3DLinuxInputParser parser;
+    EventScript script;
+    for (int index = 0; index < count; ++index)
+        script.motion(index, -index, index, -index, index, -index);
+    QVERIFY(script.writeTo(fds[1]));
+
+    QList<QExtMouse3DLinuxInputPacket> packets = readPackets(&parser);
+    QCOMPARE(packets.size(), count);
+    for (int index = 0; index < count; ++index) {
+        QCOMPARE(packets[index].values[0], index);
+        QCOMPARE(packets[index].values[5], -index);
+    }
+
+    int batches = (script.size() + QExtMouse3DLinuxInputParser::BatchSize - 1) /
+                  QExtMouse3DLinuxInputParser::BatchSize;
+    QCOMPARE(parser.readCalls(), quint64(batches));
+    QCOMPARE(parser.eventsRead(), quint64(script.size()));
+}
+
+// Feeds a mix of motions, noise and keys through the socket with the
+// same calibration that the plug-in uses for a device.
+void tst_QExtMouse3DLinuxInputParser::parseThroughput()
+{
+    QExtMouse3DLinuxInputParser parser;
+    parser.probeAxes(fds[0]);
+    parser.calibration()->setAdaptive(true);
+    parser.setDecodeKeys(true);
+
+    EventScript script;
+    for (int index = 0; index < 64; ++index) {
+        if ((index % 16) == 15)
+            script.key(0x9000d + (index / 16), (index % 32) == 15);
+        else if ((index % 4) == 0)
+            script.motion(3, -2, 1, 0, -1, 2);
+        else
+            script.motion(index * 5, -index * 3, index, index * 2, 0, -index);
+    }
+
+    int packetCount = 0;
+    QBENCHMARK {
+        QVERIFY(script.writeTo(fds[1]));
+        packetCount = readPackets(&parser).size();
+    }
+    QCOMPARE(packetCount, 64);
+}
+
+QTEST_MAIN(tst_QExtMouse3DLinuxInputParser)
+
+#include "tst_qmouse3dlinuxinputparser.moc"
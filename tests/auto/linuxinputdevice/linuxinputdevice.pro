@@ -0,0 +1,33 @@
+load(qttest_p4.prf)
+TEMPLATE=app
+QT += testlib
+CONFIG += unittest warn_on
+
+TARGET = tst_qmouse3dlinuxinputdevice
+
+# The device is built from the plug-in's sources and reads recorded
+# events from a FIFO instead of a /dev/input node.
+LINUXINPUT = ../../../src/plugins/mouse3d/linuxinput
+INCLUDEPATH += $$LINUXINPUT ../linuxinput
+HEADERS += ../linuxinput/eventscript.h \
+           $$LINUXINPUT/qmouse3dlinuxinputdevice.h \
+           $$LINUXINPUT/qmouse3dlinuxinputreader.h \
+           $$LINUXINPUT/qmouse3dlcdscreen.h
+SOURCES += tst_qmouse3dlinuxinputdevice.cpp \
+           $$LINUXINPUT/qmouse3dlinuxinputdevice.cpp \
+           $$LINUXINPUT/qmouse3dlinuxinputparser.cpp \
+           $$LINUXINPUT/qmouse3dlinuxinputreader.cpp \
+           $$LINUXINPUT/qmouse3dlcdscreen.cpp
+
+DEFINES += QT_HAVE_LIBUSB
+LIBS += -lusb
+
+have_io_uring {
+    DEFINES += QT_HAVE_IO_URING
+    HEADERS += $$LINUXINPUT/qmouse3dlinuxinputuring.h
+    SOURCES += $$LINUXINPUT/qmouse3dlinuxinputuring.cpp
+}
+
+LIBS += -L../../../lib -L../../../bin
+
+include(../../../src/threed/threed_dep.pri)
@@ -0,0 +1,606 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include "qmouse3dlinuxinputdevice.h"
+#include "qmouse3deventprovider.h"
+#include "qmouse3devent.h"
+#include "eventscript.h"
+#include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+// Records the translations that reach the widget, one per motion or
+// batch sample.
+class TestMouse3DWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    TestMouse3DWidget(QWidget *parent = 0)
+        : QWidget(parent), batchesSeen(0), releaseOnMotion(0) {}
+
+    QList<int> motions;
+    QList<int> samples;
+    QList<int> keys;
+    int batchesSeen;
+
+    // Deactivated on the next motion, which closes the device while
+    // it is delivering.
+    QExtMouse3DEventProvider *releaseOnMotion;
+
+    int seen() const { return motions.size() + samples.size(); }
+
+protected:
+    bool event(QEvent *e);
+    void keyPressEvent(QKeyEvent *e) { keys.append(e->key()); }
+};
+
+bool TestMouse3DWidget::event(QEvent *e)
+{
+    if (e->type() == QExtMouse3DEvent::type) {
+        motions.append(static_cast<QExtMouse3DEvent *>(e)->translateX());
+        if (releaseOnMotion) {
+            releaseOnMotion->setWidget(0);
+            releaseOnMotion = 0;
+        }
+        return true;
+    } else if (e->type() == QExtMouse3DBatchEvent::type) {
+        QExtMouse3DBatchEvent *batch = static_cast<QExtMouse3DBatchEvent *>(e);
+        ++batchesSeen;
+        for (int index = 0; index < batch->count(); ++index)
+            samples.append(batch->at(index).translateX);
+        return true;
+    }
+    return QWidget::event(e);
+}
+
+// Counts the motions that are handed to it on the reader thread.
+class TestMotionSink : public QExtMouse3DMotionSink
+{
+public:
+    TestMotionSink() : lastX(0) {}
+
+    void motion(const short values[6], qint64)
+    {
+        lastX = values[0];
+        count.ref();
+    }
+
+    volatile int lastX;
+    QAtomicInt count;
+};
+
+// Records the scheduling policy of the reader thread, which is the
+// thread that calls it.
+class TestSchedulingSink : public QExtMouse3DMotionSink
+{
+public:
+    TestSchedulingSink() : policy(-1), priority(-1) {}
+
+    void motion(const short *, qint64)
+    {
+        struct sched_param param;
+        int value;
+        if (::pthread_getschedparam(::pthread_self(), &value, &param) == 0) {
+            policy = value;
+            priority = param.sched_priority;
+        }
+        count.ref();
+    }
+
+    volatile int policy;
+    volatile int priority;
+    QAtomicInt count;
+};
+
+class tst_QExtMouse3DLinuxInputDevice : public QObject
+{
+    Q_OBJECT
+public:
+    tst_QExtMouse3DLinuxInputDevice() : device(0), writer(-1) {}
+    ~tst_QExtMouse3DLinuxInputDevice() {}
+
+private slots:
+    void init();
+    void cleanup();
+    void aggregation_data();
+    void aggregation();
+    void batchedDelivery_data();
+    void batchedDelivery();
+    void wakeupRate();
+    void filterKeys_data();
+    void filterKeys();
+    void readerThreadSink();
+    void readerScheduling();
+    void droppedSyncs_data();
+    void droppedSyncs();
+
+private:
+    QByteArray path;
+    QExtMouse3DLinuxInputDevice *device;
+    int writer;
+
+    bool openWriter();
+    bool waitForMotions(TestMouse3DWidget *widget, int count);
+};
+
+// Each test gets a fresh device that reads from a FIFO, into which the
+// test writes recorded events.  The ioctl() calls that the device makes
+// fail on a FIFO, so it has no grab or event mask and calibrates the
+// axes for -500 to 500 with a dead zone of 16.  A single translation
+// of (16 + 0.968 * n) then comes out as n.
+void tst_QExtMouse3DLinuxInputDevice::init()
+{
+    path = QFile::encodeName
+        (QDir::tempPath() +
+         QString::fromLatin1("/tst_qmouse3dlinuxinputdevice.%1")
+            .arg(QCoreApplication::applicationPid()));
+    ::unlink(path.constData());
+    QVERIFY(::mkfifo(path.constData(), 0600) == 0);
+    device = new QExtMouse3DLinuxInputDevice
+        (QString::fromLocal8Bit(path.constData()),
+         QLatin1String("3Dconnexion Test 3D Mouse"));
+    QExtMouse3DDevice::testDevice1 = device;
+}
+
+void tst_QExtMouse3DLinuxInputDevice::cleanup()
+{
+    if (writer >= 0)
+        ::close(writer);
+    writer = -1;
+    QExtMouse3DDevice::testDevice1 = 0;
+    delete device;
+    device = 0;
+    ::unlink(path.constData());
+}
+
+// Opens the writing end of the FIFO, once the device has opened the
+// reading end.  It stays open until cleanup() so that the device does
+// not see the end of the file.
+bool tst_QExtMouse3DLinuxInputDevice::openWriter()
+{
+    writer = ::open(path.constData(), O_WRONLY | O_NONBLOCK);
+    return writer >= 0;
+}
+
+// Runs the event loop until \a widget has seen \a count motions or
+// batch samples, or a second has passed.
+bool tst_QExtMouse3DLinuxInputDevice::waitForMotions
+    (TestMouse3DWidget *widget, int count)
+{
+    for (int tries = 0; tries < 100 && widget->seen() < count; ++tries)
+        QTest::qWait(10);
+    return widget->seen() >= count;
+}
+
+void tst_QExtMouse3DLinuxInputDevice::aggregation_data()
+{
+    QTest::addColumn<int>("readMode");
+    QTest::addColumn<int>("aggregation");
+    QTest::addColumn<int>("gap");
+    QTest::addColumn<QList<int> >("motions");
+
+    int gui = int(QExtMouse3DEventProvider::GuiThreadRead);
+    int reader = int(QExtMouse3DEventProvider::ReaderThreadRead);
+    int last = int(QExtMouse3DEventProvider::LastSample);
+    int average = int(QExtMouse3DEventProvider::TimeWeightedAverage);
+    int integrated = int(QExtMouse3DEventProvider::IntegratedDisplacement);
+
+    // The samples are 125, 250 and 500, 8 ms apart, with "gap" more
+    // microseconds before the last.  The first sample after an idle
+    // period counts for one report interval of 8 ms.  A gap of 24 ms
+    // moves the measured interval to (7 * 8 + 32) / 8 = 11 ms, which is
+    // then the weight of the last sample.
+    QTest::newRow("last sample")
+        << gui << last << 0 << (QList<int>() << 500);
+    QTest::newRow("average")
+        << gui << average << 0 << (QList<int>() << (875 * 8) / 24);
+    QTest::newRow("average with gap")
+        << gui << average << 24000
+        << (QList<int>() << (125 * 8 + 250 * 8 + 500 * 11) / 27);
+    QTest::newRow("integrated")
+        << gui << integrated << 0 << (QList<int>() << 875);
+    QTest::newRow("integrated with gap")
+        << gui << integrated << 24000
+        << (QList<int>() << (125 * 8 + 250 * 8 + 500 * 11) / 11);
+    QTest::newRow("reader thread last sample")
+        << reader << last << 0 << (QList<int>() << 125 << 250 << 500);
+    QTest::newRow("reader thread average")
+        << reader << average << 24000
+        << (QList<int>() << (125 * 8 + 250 * 8 + 500 * 11) / 27);
+#ifdef QT_HAVE_IO_URING
+    // A completed read holds the whole backlog, as on the GUI thread.
+    int async = int(QExtMouse3DEventProvider::AsyncRead);
+    QTest::newRow("async last sample")
+        << async << last << 0 << (QList<int>() << 500);
+    QTest::newRow("async average")
+        << async << average << 24000
+        << (QList<int>() << (125 * 8 + 250 * 8 + 500 * 11) / 27);
+#endif
+}
+
+// A backlog of samples is combined according to the aggregation mode.
+void tst_QExtMouse3DLinuxInputDevice::aggregation()
+{
+    QFETCH(int, readMode);
+    QFETCH(int, aggregation);
+    QFETCH(int, gap);
+    QFETCH(QList<int>, motions);
+
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReadMode(readMode));
+    provider.setAggregation
+        (QExtMouse3DEventProvider::Aggregation(aggregation));
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    EventScript script;
+    script.translate(137, 0, 0);
+    script.translate(258, 0, 0);
+    script.time += gap;
+    script.translate(500, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, motions.size()));
+    QTest::qWait(50);
+    QCOMPARE(widget.motions, motions);
+
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DLinuxInputDevice::batchedDelivery_data()
+{
+    QTest::addColumn<int>("readMode");
+
+    QTest::newRow("gui thread")
+        << int(QExtMouse3DEventProvider::GuiThreadRead);
+    QTest::newRow("reader thread")
+        << int(QExtMouse3DEventProvider::ReaderThreadRead);
+}
+
+// With BatchedDelivery, every packet in a backlog reaches the widget,
+// even though the aggregation mode would combine them otherwise.
+void tst_QExtMouse3DLinuxInputDevice::batchedDelivery()
+{
+    QFETCH(int, readMode);
+
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReadMode(readMode));
+    provider.setAggregation(QExtMouse3DEventProvider::TimeWeightedAverage);
+    provider.setDelivery(QExtMouse3DEventProvider::BatchedDelivery);
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    EventScript script;
+    script.translate(137, 0, 0);
+    script.translate(258, 0, 0);
+    script.translate(500, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 3));
+    QVERIFY(widget.motions.isEmpty());
+    QCOMPARE(widget.samples, QList<int>() << 125 << 250 << 500);
+
+    // The same holds for a backlog that the wakeup timer picks up.
+    provider.setMaximumWakeupRate(10);
+    EventScript first;
+    first.time = script.time;
+    first.translate(500, 0, 0);
+    QVERIFY(first.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 4));
+    EventScript backlog;
+    backlog.time = first.time;
+    backlog.translate(258, 0, 0);
+    backlog.translate(137, 0, 0);
+    QVERIFY(backlog.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 6));
+    QVERIFY(widget.motions.isEmpty());
+    QCOMPARE(widget.samples, QList<int>()
+             << 125 << 250 << 500 << 500 << 250 << 125);
+
+    provider.setWidget(0);
+}
+
+// Once the mouse starts moving, the device is read on every tick of
+// the wakeup timer instead of whenever the notifier fires.  The motions
+// in between are combined, and the notifier takes over again once a
+// tick finds the mouse at rest.
+void tst_QExtMouse3DLinuxInputDevice::wakeupRate()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setMaximumWakeupRate(10);
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    EventScript script;
+    script.translate(137, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 1));
+
+    // The next tick is 100 ms after the first motion.
+    static const int values[] = {258, 137, 500};
+    for (int index = 0; index < 3; ++index) {
+        EventScript next;
+        next.time = script.time;
+        next.translate(values[index], 0, 0);
+        script.time = next.time;
+        QVERIFY(next.writeTo(writer));
+        QTest::qWait(10);
+    }
+    QVERIFY(waitForMotions(&widget, 2));
+    QTest::qWait(250);
+    QCOMPARE(widget.motions, QList<int>() << 125 << 500);
+
+    // At rest, the notifier delivers the next motion right away, and
+    // the device can be closed from within that delivery.
+    widget.releaseOnMotion = &provider;
+    EventScript last;
+    last.time = script.time;
+    last.translate(258, 0, 0);
+    QVERIFY(last.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 3));
+    QCOMPARE(widget.motions, QList<int>() << 125 << 500 << 250);
+    QVERIFY(!provider.widget());
+    QTest::qWait(20);
+}
+
+void tst_QExtMouse3DLinuxInputDevice::filterKeys_data()
+{
+    QTest::addColumn<int>("readMode");
+
+    QTest::newRow("gui thread") << int(QExtMouse3DEventProvider::GuiThreadRead);
+    QTest::newRow("reader thread") << int(QExtMouse3DEventProvider::ReaderThreadRead);
+#ifdef QT_HAVE_IO_URING
+    QTest::newRow("async") << int(QExtMouse3DEventProvider::AsyncRead);
+#endif
+}
+
+// The pan key toggles the translation filter while the device is
+// delivering from its own slots, which changes the device's filters
+// underneath them.  Reading carries on with the new filters.
+void tst_QExtMouse3DLinuxInputDevice::filterKeys()
+{
+    QFETCH(int, readMode);
+
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReadMode(readMode));
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    const int panKey = 0x9001c;
+    EventScript script;
+    script.translate(137, 0, 0);
+    script.key(panKey, true);
+    script.key(panKey, false);
+    QVERIFY(script.writeTo(writer));
+    QVERIFY(waitForMotions(&widget, 1));
+    for (int tries = 0; tries < 100 &&
+            (provider.filters() & QExtMouse3DEventProvider::Translations) != 0;
+            ++tries)
+        QTest::qWait(10);
+    QVERIFY((provider.filters() & QExtMouse3DEventProvider::Translations) == 0);
+    QCOMPARE(widget.motions, QList<int>() << 125);
+
+    EventScript filtered;
+    filtered.time = script.time;
+    filtered.translate(258, 0, 0);
+    filtered.key(panKey, true);
+    filtered.key(panKey, false);
+    filtered.translate(500, 0, 0);
+    QVERIFY(filtered.writeTo(writer));
+    for (int tries = 0; tries < 100 && !widget.motions.contains(500); ++tries)
+        QTest::qWait(10);
+    QVERIFY((provider.filters() & QExtMouse3DEventProvider::Translations) != 0);
+    QCOMPARE(widget.motions.first(), 125);
+    QCOMPARE(widget.motions.last(), 500);
+    QVERIFY(!widget.motions.contains(250));
+
+    provider.setWidget(0);
+}
+
+// Motions that go to a sink on the reader thread are still recorded
+// for latestMotion().
+void tst_QExtMouse3DLinuxInputDevice::readerThreadSink()
+{
+    TestMouse3DWidget widget;
+    TestMotionSink sink;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReaderThreadRead);
+    provider.setMotionSink(&sink, QExtMouse3DEventProvider::ReaderThreadSink);
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    EventScript script;
+    script.translate(137, 0, 0);
+    script.translate(500, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    for (int tries = 0; tries < 100 && sink.lastX != 500; ++tries)
+        QTest::qWait(10);
+    QCOMPARE(int(sink.lastX), 500);
+    QTest::qWait(50);
+    QVERIFY(widget.motions.isEmpty());
+
+    short values[6];
+    qint64 timestamp = 0;
+    QCOMPARE(provider.latestMotion(values, &timestamp), quint64(sink.count));
+    QCOMPARE(int(values[0]), 500);
+    QVERIFY(timestamp != 0);
+
+    provider.setMotionSink(0);
+    provider.setWidget(0);
+}
+
+static void *tryFifoScheduling(void *result)
+{
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = ::sched_get_priority_max(SCHED_FIFO);
+    *static_cast<bool *>(result) =
+        (::pthread_setschedparam(::pthread_self(), SCHED_FIFO, &param) == 0);
+    return 0;
+}
+
+// Returns true if this process may run a thread with SCHED_FIFO at
+// the highest priority.
+static bool fifoSchedulingPermitted()
+{
+    bool permitted = false;
+    pthread_t thread;
+    if (::pthread_create(&thread, 0, tryFifoScheduling, &permitted) != 0)
+        return false;
+    ::pthread_join(thread, 0);
+    return permitted;
+}
+
+// The reader thread switches to the requested policy with the priority
+// clamped to the valid range, or carries on reading with normal
+// scheduling if the kernel refuses it.
+void tst_QExtMouse3DLinuxInputDevice::readerScheduling()
+{
+    TestMouse3DWidget widget;
+    TestSchedulingSink sink;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReaderThreadRead);
+    provider.setMotionSink(&sink, QExtMouse3DEventProvider::ReaderThreadSink);
+    provider.setReaderScheduling
+        (QExtMouse3DEventProvider::FifoScheduling, 1000);
+    int maximum = ::sched_get_priority_max(SCHED_FIFO);
+    bool permitted = fifoSchedulingPermitted();
+    QTest::ignoreMessage(QtWarningMsg, QString::fromLatin1
+        ("QExtMouse3DLinuxInputReader: SCHED_FIFO priority 1000 is out of "
+         "range, using %1").arg(maximum).toLatin1().constData());
+    if (!permitted) {
+        QString message = QString::fromLatin1
+            ("QExtMouse3DLinuxInputReader: not permitted to use SCHED_FIFO "
+             "priority %1").arg(maximum);
+        struct rlimit limit;
+        if (::getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+                limit.rlim_cur != RLIM_INFINITY) {
+            message += QString::fromLatin1(", RLIMIT_RTPRIO is %1")
+                            .arg(quint64(limit.rlim_cur));
+        }
+        QTest::ignoreMessage(QtWarningMsg, message.toLatin1().constData());
+    }
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+
+    EventScript script;
+    script.translate(137, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    for (int tries = 0; tries < 100 && int(sink.count) < 1; ++tries)
+        QTest::qWait(10);
+    QCOMPARE(int(sink.count), 1);
+    if (permitted) {
+        QCOMPARE(int(sink.policy), int(SCHED_FIFO));
+        QCOMPARE(int(sink.priority), maximum);
+    } else {
+        QCOMPARE(int(sink.policy), int(SCHED_OTHER));
+    }
+
+    // Going back to normal scheduling applies before the next input
+    // is read.
+    provider.setReaderScheduling(QExtMouse3DEventProvider::NormalScheduling);
+    EventScript next;
+    next.time = script.time;
+    next.translate(500, 0, 0);
+    QVERIFY(next.writeTo(writer));
+    for (int tries = 0; tries < 100 && int(sink.count) < 2; ++tries)
+        QTest::qWait(10);
+    QCOMPARE(int(sink.count), 2);
+    QCOMPARE(int(sink.policy), int(SCHED_OTHER));
+
+    provider.setMotionSink(0);
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DLinuxInputDevice::droppedSyncs_data()
+{
+    QTest::addColumn<int>("readMode");
+
+    QTest::newRow("gui thread")
+        << int(QExtMouse3DEventProvider::GuiThreadRead);
+    QTest::newRow("reader thread")
+        << int(QExtMouse3DEventProvider::ReaderThreadRead);
+#ifdef QT_HAVE_IO_URING
+    QTest::newRow("async") << int(QExtMouse3DEventProvider::AsyncRead);
+#endif
+}
+
+// Each time the kernel drops events, the device resyncs and the count
+// in its descriptor goes up, whichever thread read the drop.
+void tst_QExtMouse3DLinuxInputDevice::droppedSyncs()
+{
+    QFETCH(int, readMode);
+
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setReadMode(QExtMouse3DEventProvider::ReadMode(readMode));
+    provider.setWidget(&widget);
+    QVERIFY(openWriter());
+    QCOMPARE(provider.deviceDescriptors().value(0).droppedSyncs, quint64(0));
+
+    // The rest of the dropped stretch is thrown away up to its report.
+    EventScript script;
+    script.translate(137, 0, 0);
+    script.dropped();
+    script.abs(ABS_X, 258);
+    script.report();
+    script.translate(500, 0, 0);
+    QVERIFY(script.writeTo(writer));
+    for (int tries = 0; tries < 100 && !widget.motions.contains(500); ++tries)
+        QTest::qWait(10);
+    QVERIFY(widget.motions.contains(500));
+    QVERIFY(!widget.motions.contains(258));
+    QCOMPARE(provider.deviceDescriptors().value(0).droppedSyncs, quint64(1));
+
+    provider.setWidget(0);
+}
+
+QTEST_MAIN(tst_QExtMouse3DLinuxInputDevice)
+
+#include "tst_qmouse3dlinuxinputdevice.moc"
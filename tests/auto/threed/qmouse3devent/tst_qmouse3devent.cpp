@@ -43,8 +43,13 @@
 #include "qmouse3devent.h"
 #include "qmouse3deventprovider.h"
 #include "qmouse3ddevice_p.h"
+#include "qmouse3dcalibration_p.h"
+#include "qmouse3dhidparser_p.h"
+#include "qmouse3dwidgetindex_p.h"
 #include "qglnamespace.h"
 #include <QtGui/qevent.h>
+#include <QtCore/qthread.h>
+#include <string.h>
 
 class TestMouse3DDevice;
 
@@ -61,6 +66,29 @@ private slots:
     void availableDevice();
     void deliverEvents();
     void filterEvents();
+    void aggregation();
+    void keepDevicesOpen();
+    void readerOptions();
+    void wakeupRate();
+    void routing();
+    void pointerRouting();
+    void widgetIndex();
+    void mergeDevices();
+    void bindDevices();
+    void latestMotion();
+    void postedDelivery();
+    void motionSink();
+    void batchedDelivery();
+    void normalizedMotion();
+    void workerThreads();
+    void destroyedTarget();
+    void deviceRegistry();
+    void deviceKeys();
+    void hidReports();
+    void hidButtons();
+    void calibration();
+    void adaptiveCalibration();
+    void calibrationSetting();
 
 private:
     TestMouse3DDevice *device1;
@@ -85,6 +113,29 @@ public:
     void sendMotion(QExtMouse3DEvent *event) { motion(event); }
     void sendKeyPress(int key) { keyPress(key); }
     void sendKeyRelease(int key) { keyRelease(key); }
+    void sendDeviceKey(int key, bool press) { deviceKey(key, press); }
+    void setRanges(const int ranges[6]) { setAxisRanges(ranges); }
+    void setInfo(int vendorId, int productId, int buttonCount, bool hasLcd)
+        { setDeviceInfo(vendorId, productId, buttonCount, hasLcd); }
+
+    void updateAggregation(QExtMouse3DEventProvider::Aggregation value)
+        { aggregation = value; }
+    void updateKeepOpen(bool value) { keepOpen = value; }
+    void updateAdaptiveCalibration(bool value) { adaptive = value; }
+    void updateReaderOptions(const QExtMouse3DReaderOptions &value)
+        { readerOptions = value; }
+    void updateWakeupRate(int value) { wakeupRate = value; }
+    void updateMotionSink(QExtMouse3DMotionSink *value) { motionSink = value; }
+    void updateDelivery(QExtMouse3DEventProvider::Delivery value)
+        { delivery = value; }
+
+    QExtMouse3DEventProvider::Aggregation aggregation;
+    QExtMouse3DEventProvider::Delivery delivery;
+    bool keepOpen;
+    bool adaptive;
+    QExtMouse3DReaderOptions readerOptions;
+    int wakeupRate;
+    QExtMouse3DMotionSink *motionSink;
 
 private:
     bool available;
@@ -93,6 +144,12 @@ private:
 
 TestMouse3DDevice::TestMouse3DDevice(QObject *parent)
     : QExtMouse3DDevice(parent)
+    , aggregation(QExtMouse3DEventProvider::LastSample)
+    , delivery(QExtMouse3DEventProvider::SynchronousDelivery)
+    , keepOpen(false)
+    , adaptive(true)
+    , wakeupRate(0)
+    , motionSink(0)
     , available(false)
 {
 }
@@ -112,10 +169,16 @@ public:
     int rotateX;
     int rotateY;
     int rotateZ;
+    qint64 timestamp;
     int keyPressesSeen;
     int keyPressed;
     int keyReleasesSeen;
     int keyReleased;
+    QList<int> eventsSeen;
+    int batchesSeen;
+    QVector<QExtMouse3DSample> samples;
+    int normalizedSeen;
+    qreal normalized[6];
 
     void clear();
 
@@ -140,10 +203,17 @@ void TestMouse3DWidget::clear()
     rotateX = 0;
     rotateY = 0;
     rotateZ = 0;
+    timestamp = 0;
     keyPressesSeen = 0;
     keyPressed = 0;
     keyReleasesSeen = 0;
     keyReleased = 0;
+    eventsSeen.clear();
+    batchesSeen = 0;
+    samples.clear();
+    normalizedSeen = 0;
+    for (int axis = 0; axis < 6; ++axis)
+        normalized[axis] = 0.0f;
 }
 
 void TestMouse3DWidget::keyPressEvent(QKeyEvent *e)
@@ -171,6 +241,28 @@ bool TestMouse3DWidget::event(QEvent *e)
         rotateX = event->rotateX();
         rotateY = event->rotateY();
         rotateZ = event->rotateZ();
+        timestamp = event->timestamp();
+        eventsSeen.append(int(e->type()));
+    } else if (e->type() == QExtMouse3DNormalizedEvent::type) {
+        QExtMouse3DNormalizedEvent *event =
+            static_cast<QExtMouse3DNormalizedEvent *>(e);
+        ++normalizedSeen;
+        normalized[0] = event->translateX();
+        normalized[1] = event->translateY();
+        normalized[2] = event->translateZ();
+        normalized[3] = event->rotateX();
+        normalized[4] = event->rotateY();
+        normalized[5] = event->rotateZ();
+        timestamp = event->timestamp();
+    } else if (e->type() == QExtMouse3DBatchEvent::type) {
+        QExtMouse3DBatchEvent *batch = static_cast<QExtMouse3DBatchEvent *>(e);
+        ++batchesSeen;
+        for (int index = 0; index < batch->count(); ++index)
+            samples.append(batch->at(index));
+        eventsSeen.append(int(e->type()));
+    } else if (e->type() == QEvent::KeyPress ||
+               e->type() == QEvent::KeyRelease) {
+        eventsSeen.append(int(e->type()));
     }
     return QWidget::event(e);
 }
@@ -192,6 +284,13 @@ void tst_QExtMouse3DEvent::createEvent()
     QCOMPARE(event.rotateX(), short(-4));
     QCOMPARE(event.rotateY(), short(5));
     QCOMPARE(event.rotateZ(), short(-6));
+    QCOMPARE(event.timestamp(), qint64(0));
+
+    event.setTimestamp(Q_INT64_C(1234567890123));
+    QCOMPARE(event.timestamp(), Q_INT64_C(1234567890123));
+
+    qint64 now = QExtMouse3DEvent::currentTimestamp();
+    QVERIFY(QExtMouse3DEvent::currentTimestamp() >= now);
 }
 
 void tst_QExtMouse3DEvent::availableDevice()
@@ -247,6 +346,7 @@ void tst_QExtMouse3DEvent::deliverEvents()
     QVERIFY(device2->widget() == 0);    // device not available
 
     QExtMouse3DEvent event(1, -2, 3, -4, 5, -6);
+    event.setTimestamp(Q_INT64_C(42000));
     device1->sendMotion(&event);
 
     QCOMPARE(widget.motionsSeen, 1);
@@ -256,6 +356,7 @@ void tst_QExtMouse3DEvent::deliverEvents()
     QCOMPARE(widget.rotateX, -4);
     QCOMPARE(widget.rotateY, 5);
     QCOMPARE(widget.rotateZ, -6);
+    QCOMPARE(widget.timestamp, Q_INT64_C(42000));
 
     device1->sendKeyPress(QGL::Key_TopView);
     QCOMPARE(widget.keyPressesSeen, 1);
@@ -551,6 +652,1334 @@ void tst_QExtMouse3DEvent::filterEvents()
     QCOMPARE(sensitivitySpy.size(), 3);
 }
 
+void tst_QExtMouse3DEvent::aggregation()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.aggregation(), QExtMouse3DEventProvider::LastSample);
+
+    device1->aggregation = QExtMouse3DEventProvider::IntegratedDisplacement;
+    provider.setWidget(&widget);
+    QCOMPARE(device1->aggregation, QExtMouse3DEventProvider::LastSample);
+
+    provider.setAggregation(QExtMouse3DEventProvider::TimeWeightedAverage);
+    QCOMPARE(provider.aggregation(),
+             QExtMouse3DEventProvider::TimeWeightedAverage);
+    QCOMPARE(device1->aggregation,
+             QExtMouse3DEventProvider::TimeWeightedAverage);
+
+    // Providers that are not attached to the device do not affect it.
+    QExtMouse3DEventProvider provider2;
+    provider2.setAggregation(QExtMouse3DEventProvider::IntegratedDisplacement);
+    QCOMPARE(device1->aggregation,
+             QExtMouse3DEventProvider::TimeWeightedAverage);
+}
+
+void tst_QExtMouse3DEvent::keepDevicesOpen()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QVERIFY(!provider.keepDevicesOpen());
+
+    provider.setWidget(&widget);
+    QVERIFY(!device1->keepOpen);
+
+    provider.setKeepDevicesOpen(true);
+    QVERIFY(provider.keepDevicesOpen());
+    QVERIFY(device1->keepOpen);
+
+    // The device keeps the setting after the widget goes away,
+    // so that it knows to pause rather than close.
+    provider.setWidget(0);
+    QVERIFY(device1->widget() == 0);
+    QVERIFY(device1->keepOpen);
+
+    // Other providers do not release the paused devices.
+    QExtMouse3DEventProvider provider2;
+    provider2.setKeepDevicesOpen(true);
+    provider2.setKeepDevicesOpen(false);
+    QVERIFY(device1->keepOpen);
+
+    // Clearing the setting closes them even without a widget.
+    provider.setKeepDevicesOpen(false);
+    QVERIFY(!device1->keepOpen);
+
+    // So does destroying the provider that kept them open.
+    QExtMouse3DEventProvider *provider3 = new QExtMouse3DEventProvider();
+    provider3->setKeepDevicesOpen(true);
+    provider3->setWidget(&widget);
+    QVERIFY(device1->keepOpen);
+    provider3->setWidget(0);
+    QVERIFY(device1->keepOpen);
+    delete provider3;
+    QVERIFY(!device1->keepOpen);
+
+    // A provider that becomes current decides for itself.
+    provider.setKeepDevicesOpen(true);
+    provider.setWidget(&widget);
+    provider.setWidget(0);
+    QVERIFY(device1->keepOpen);
+    provider2.setWidget(&widget);
+    QVERIFY(!device1->keepOpen);
+    provider.setKeepDevicesOpen(false);
+    QVERIFY(!device1->keepOpen);
+    provider2.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::readerOptions()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.readerScheduling(),
+             QExtMouse3DEventProvider::NormalScheduling);
+    QCOMPARE(provider.readerPriority(), 0);
+    QVERIFY(provider.readerCpus().isEmpty());
+    QCOMPARE(provider.readerBusyPollTime(), 0);
+
+    provider.setReaderScheduling(QExtMouse3DEventProvider::FifoScheduling, 50);
+    QList<int> cpus;
+    cpus << 2 << 3;
+    provider.setReaderCpus(cpus);
+    provider.setReaderBusyPollTime(-5);
+    QCOMPARE(provider.readerBusyPollTime(), 0);
+    provider.setReaderBusyPollTime(2000);
+
+    // The options are passed on when the provider becomes current.
+    provider.setWidget(&widget);
+    QCOMPARE(device1->readerOptions.scheduling,
+             QExtMouse3DEventProvider::FifoScheduling);
+    QCOMPARE(device1->readerOptions.priority, 50);
+    QVERIFY(device1->readerOptions.cpus == cpus);
+    QCOMPARE(device1->readerOptions.busyPollTime, 2000);
+
+    // The priority does not apply to normal scheduling.
+    provider.setReaderScheduling(QExtMouse3DEventProvider::NormalScheduling, 10);
+    QCOMPARE(provider.readerPriority(), 0);
+    QCOMPARE(device1->readerOptions.scheduling,
+             QExtMouse3DEventProvider::NormalScheduling);
+    QCOMPARE(device1->readerOptions.priority, 0);
+
+    provider.setReaderCpus(QList<int>());
+    QVERIFY(device1->readerOptions.cpus.isEmpty());
+
+    // Providers that are not attached to the device do not affect it.
+    QExtMouse3DEventProvider provider2;
+    provider2.setReaderBusyPollTime(100);
+    QCOMPARE(device1->readerOptions.busyPollTime, 2000);
+
+    provider.setWidget(0);
+    device1->readerOptions = QExtMouse3DReaderOptions();
+}
+
+void tst_QExtMouse3DEvent::wakeupRate()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.maximumWakeupRate(), 0);
+
+    provider.setMaximumWakeupRate(-1);
+    QCOMPARE(provider.maximumWakeupRate(), 0);
+    provider.setMaximumWakeupRate(30);
+    QCOMPARE(provider.maximumWakeupRate(), 30);
+
+    // The rate is passed on when the provider becomes current.
+    QCOMPARE(device1->wakeupRate, 0);
+    provider.setWidget(&widget);
+    QCOMPARE(device1->wakeupRate, 30);
+
+    provider.setMaximumWakeupRate(60);
+    QCOMPARE(device1->wakeupRate, 60);
+
+    // Providers that are not attached to the device do not affect it.
+    QExtMouse3DEventProvider provider2;
+    provider2.setMaximumWakeupRate(10);
+    QCOMPARE(device1->wakeupRate, 60);
+
+    provider.setMaximumWakeupRate(0);
+    QCOMPARE(device1->wakeupRate, 0);
+
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::routing()
+{
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.routing(), QExtMouse3DEventProvider::ActiveWidgetRouting);
+    provider.setRouting(QExtMouse3DEventProvider::PointerRouting);
+    QCOMPARE(provider.routing(), QExtMouse3DEventProvider::PointerRouting);
+
+    // Changing the routing of a registered widget and unregistering it.
+    TestMouse3DWidget widget;
+    provider.setWidget(&widget);
+    provider.setRouting(QExtMouse3DEventProvider::ActiveWidgetRouting);
+    provider.setRouting(QExtMouse3DEventProvider::PointerRouting);
+    provider.setWidget(0);
+    QCOMPARE(provider.routing(), QExtMouse3DEventProvider::PointerRouting);
+}
+
+// Two viewports side by side, the right-hand one inside a container
+// that is moved later.  Motions starting from rest go to the viewport
+// under the pointer.
+void tst_QExtMouse3DEvent::pointerRouting()
+{
+    QWidget window;
+    window.resize(400, 200);
+    TestMouse3DWidget left(&window);
+    left.setGeometry(0, 0, 200, 200);
+    QWidget container(&window);
+    container.setGeometry(200, 0, 200, 200);
+    TestMouse3DWidget right(&container);
+    right.setGeometry(0, 0, 100, 200);
+
+    QExtMouse3DEventProvider leftProvider;
+    QExtMouse3DEventProvider rightProvider;
+    leftProvider.setRouting(QExtMouse3DEventProvider::PointerRouting);
+    rightProvider.setRouting(QExtMouse3DEventProvider::PointerRouting);
+    window.show();
+    QTest::qWaitForWindowShown(&window);
+    rightProvider.setWidget(&right);
+    leftProvider.setWidget(&left);
+
+    QExtMouse3DEvent rest(0, 0, 0, 0, 0, 0);
+    QExtMouse3DEvent moving(5, 0, 0, 0, 0, 0);
+
+    // Over the right-hand viewport.
+    device1->sendMotion(&rest);
+    left.clear();
+    QCursor::setPos(window.mapToGlobal(QPoint(250, 100)));
+    device1->sendMotion(&moving);
+    QCOMPARE(right.motionsSeen, 1);
+    QCOMPARE(left.motionsSeen, 0);
+
+    // The pointer is only consulted when the mouse starts moving.
+    QCursor::setPos(window.mapToGlobal(QPoint(100, 100)));
+    device1->sendMotion(&moving);
+    QCOMPARE(right.motionsSeen, 2);
+    device1->sendMotion(&rest);
+    device1->sendMotion(&moving);
+    QCOMPARE(right.motionsSeen, 3);
+    QCOMPARE(left.motionsSeen, 1);
+
+    // Moving the container does not send a move event to the viewport,
+    // so it is not in the index where it now lies under the pointer.
+    container.move(250, 0);
+    QCursor::setPos(window.mapToGlobal(QPoint(340, 100)));
+    device1->sendMotion(&rest);
+    device1->sendMotion(&moving);
+    QCOMPARE(left.motionsSeen, 2);
+    QCOMPARE(right.motionsSeen, 4);
+
+    leftProvider.setWidget(0);
+    rightProvider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::widgetIndex()
+{
+    const int size = QExtMouse3DWidgetIndex::CellSize;
+    QWidget window1;
+    QWidget window2;
+    QWidget left, right, inset, other;
+
+    QExtMouse3DWidgetIndex index;
+    QVERIFY(index.isEmpty());
+    QVERIFY(!index.widgetAt(&window1, QPoint(10, 10)));
+
+    // Two side by side viewports that each cover several cells,
+    // with a smaller one nested inside the right-hand viewport.
+    index.insert(&left, &window1, QRect(0, 0, size * 2, size * 3));
+    index.insert(&right, &window1, QRect(size * 2, 0, size * 2, size * 3));
+    index.insert(&inset, &window1, QRect(size * 3, size, 40, 40));
+    index.insert(&other, &window2, QRect(0, 0, size * 4, size * 3));
+    QVERIFY(index.contains(&left));
+    QVERIFY(index.rect(&right) == QRect(size * 2, 0, size * 2, size * 3));
+
+    QVERIFY(index.widgetAt(&window1, QPoint(10, 10)) == &left);
+    QVERIFY(index.widgetAt(&window1, QPoint(size * 2 - 1, 10)) == &left);
+    QVERIFY(index.widgetAt(&window1, QPoint(size * 2, 10)) == &right);
+    QVERIFY(index.widgetAt(&window1, QPoint(size * 3 + 5, size + 5)) == &inset);
+    QVERIFY(index.widgetAt(&window1, QPoint(size * 3 + 50, size + 5)) == &right);
+    QVERIFY(!index.widgetAt(&window1, QPoint(size * 4, 10)));
+    QVERIFY(!index.widgetAt(&window1, QPoint(-1, 10)));
+
+    // Lookups are per window.
+    QVERIFY(index.widgetAt(&window2, QPoint(10, 10)) == &other);
+    QCOMPARE(index.widgets(&window1).size(), 3);
+    QCOMPARE(index.widgets(&window2).size(), 1);
+
+    // Moving a widget only leaves it in the cells of its new rectangle.
+    index.insert(&inset, &window1, QRect(10, 10, 40, 40));
+    QVERIFY(index.widgetAt(&window1, QPoint(20, 20)) == &inset);
+    QVERIFY(index.widgetAt(&window1, QPoint(size * 3 + 5, size + 5)) == &right);
+
+    // Resizing the splitter between the two viewports.
+    index.insert(&left, &window1, QRect(0, 0, size, size * 3));
+    index.insert(&right, &window1, QRect(size, 0, size * 3, size * 3));
+    QVERIFY(index.widgetAt(&window1, QPoint(size + 10, size * 2)) == &right);
+
+    // Negative coordinates, as for a widget that is scrolled out of view.
+    index.insert(&other, &window2, QRect(-size - 10, -10, 20, 20));
+    QVERIFY(index.widgetAt(&window2, QPoint(-size - 5, -5)) == &other);
+    QVERIFY(!index.widgetAt(&window2, QPoint(10, 10)));
+
+    index.remove(&inset);
+    QVERIFY(!index.contains(&inset));
+    QVERIFY(index.widgetAt(&window1, QPoint(20, 20)) == &left);
+    QVERIFY(index.rect(&inset).isNull());
+
+    index.clear();
+    QVERIFY(index.isEmpty());
+    QVERIFY(!index.widgetAt(&window1, QPoint(20, 20)));
+}
+
+void tst_QExtMouse3DEvent::mergeDevices()
+{
+    device1->setDeviceNames(QStringList() << "SpaceNavigator");
+    device2->setDeviceNames(QStringList() << "SpacePilot PRO");
+    device2->setAvailable(true);
+
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.merging(), QExtMouse3DEventProvider::NoMerging);
+    provider.setMerging(QExtMouse3DEventProvider::SumMerging);
+    QCOMPARE(provider.merging(), QExtMouse3DEventProvider::SumMerging);
+    provider.setWidget(&widget);
+    QVERIFY(device2->widget() == &widget);
+
+    // The motions of both devices are held until the next pass of the
+    // event loop, and only the latest motion of each device is used.
+    QExtMouse3DEvent event1(100, 0, 0, 0, 0, 0);
+    event1.setTimestamp(100);
+    device1->sendMotion(&event1);
+    QExtMouse3DEvent event2(10, 0, 0, 0, 0, 0);
+    event2.setTimestamp(200);
+    device1->sendMotion(&event2);
+    QExtMouse3DEvent event3(5, 0, 0, 0, 0, 7);
+    event3.setTimestamp(150);
+    device2->sendMotion(&event3);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 1);
+    QCOMPARE(widget.translateX, 15);
+    QCOMPARE(widget.rotateZ, 7);
+    QCOMPARE(widget.timestamp, qint64(200));
+
+    // The listed device wins while it is deflected.
+    provider.setMerging(QExtMouse3DEventProvider::PriorityMerging);
+    provider.setDevicePriority(QStringList() << "SpacePilot PRO");
+    QCOMPARE(provider.devicePriority(), QStringList() << "SpacePilot PRO");
+    device1->sendMotion(&event1);
+    device2->sendMotion(&event3);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 2);
+    QCOMPARE(widget.translateX, 5);
+    QCOMPARE(widget.rotateZ, 7);
+
+    QExtMouse3DEvent rest(0, 0, 0, 0, 0, 0);
+    device2->sendMotion(&rest);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 3);
+    QCOMPARE(widget.translateX, 100);
+    QCOMPARE(widget.rotateZ, 0);
+
+    // The device that started moving last wins.
+    provider.setMerging(QExtMouse3DEventProvider::MostRecentMerging);
+    device2->sendMotion(&event3);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 4);
+    QCOMPARE(widget.translateX, 5);
+    device2->sendMotion(&rest);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 5);
+    QCOMPARE(widget.translateX, 100);
+
+    // Only one zero motion is delivered when both are at rest.
+    device1->sendMotion(&rest);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 6);
+    QCOMPARE(widget.translateX, 0);
+    device1->sendMotion(&rest);
+    device2->sendMotion(&rest);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 6);
+
+    // The merged motion is queued like any other motion, so with
+    // BatchedDelivery it arrives as a sample of a batch.
+    provider.setMerging(QExtMouse3DEventProvider::SumMerging);
+    provider.setDelivery(QExtMouse3DEventProvider::BatchedDelivery);
+    widget.clear();
+    device1->sendMotion(&event1);
+    device2->sendMotion(&event3);
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 0);
+    QCOMPARE(widget.batchesSeen, 1);
+    QCOMPARE(widget.samples.size(), 1);
+    QCOMPARE(widget.samples[0].translateX, short(105));
+    QCOMPARE(widget.samples[0].rotateZ, short(7));
+    QCOMPARE(widget.samples[0].timestamp, qint64(150));
+    provider.setDelivery(QExtMouse3DEventProvider::SynchronousDelivery);
+
+    provider.setWidget(0);
+    device2->setAvailable(false);
+    device1->setDeviceNames(QStringList());
+    device2->setDeviceNames(QStringList());
+}
+
+void tst_QExtMouse3DEvent::bindDevices()
+{
+    device1->setDeviceNames(QStringList() << "SpaceNavigator");
+    device2->setDeviceNames(QStringList() << "SpacePilot PRO");
+    device2->setAvailable(true);
+
+    TestMouse3DWidget widget1;
+    TestMouse3DWidget widget2;
+    QExtMouse3DEventProvider provider1;
+    QExtMouse3DEventProvider provider2;
+    QVERIFY(provider2.deviceBinding().isEmpty());
+    provider2.setDeviceBinding(QStringList() << "SpacePilot PRO");
+    QCOMPARE(provider2.deviceBinding(), QStringList() << "SpacePilot PRO");
+
+    // The bound device goes to its own widget while another is current.
+    provider2.setWidget(&widget2);
+    provider1.setWidget(&widget1);
+    QExtMouse3DEvent event(1, 2, 3, 4, 5, 6);
+    device1->sendMotion(&event);
+    device2->sendMotion(&event);
+    QCOMPARE(widget1.motionsSeen, 1);
+    QCOMPARE(widget2.motionsSeen, 1);
+
+    // The sensitivity keys act on the provider the device is bound to.
+    device2->sendDeviceKey(QGL::Key_IncreaseSensitivity, true);
+    QCOMPARE(provider1.sensitivity(), qreal(1.0f));
+    QCOMPARE(provider2.sensitivity(), qreal(2.0f));
+
+    // The device settings of the current provider are only given to
+    // the devices that are not bound; the bound one reports every sample
+    // in batches, and each provider's filters and sensitivity still
+    // apply to what it receives.
+    provider1.setAggregation(QExtMouse3DEventProvider::TimeWeightedAverage);
+    provider1.setFilters(QExtMouse3DEventProvider::Translations);
+    QCOMPARE(device1->aggregation,
+             QExtMouse3DEventProvider::TimeWeightedAverage);
+    QCOMPARE(device1->delivery, QExtMouse3DEventProvider::SynchronousDelivery);
+    QCOMPARE(device2->aggregation, QExtMouse3DEventProvider::LastSample);
+    QCOMPARE(device2->delivery, QExtMouse3DEventProvider::BatchedDelivery);
+    device1->sendMotion(&event);
+    device2->sendMotion(&event);
+    QCOMPARE(widget1.motionsSeen, 2);
+    QCOMPARE(widget1.translateX, 1);
+    QCOMPARE(widget1.rotateX, 0);
+    QCOMPARE(widget2.motionsSeen, 2);
+    QCOMPARE(widget2.translateX, 2);
+    QCOMPARE(widget2.rotateX, 8);
+
+    // A device that is already bound stays with the first provider.
+    QExtMouse3DEventProvider provider3;
+    QTest::ignoreMessage(QtWarningMsg, "QExtMouse3DEventProvider: SpacePilot PRO is already bound to another provider");
+    provider3.setDeviceBinding(QStringList() << "SpacePilot PRO");
+    TestMouse3DWidget widget3;
+    provider3.setWidget(&widget3);
+    device2->sendMotion(&event);
+    QCOMPARE(widget2.motionsSeen, 3);
+    QCOMPARE(widget3.motionsSeen, 0);
+    provider3.setWidget(0);
+    widget1.clear();
+    widget2.clear();
+
+    // Without a current widget, the devices stay open for the bound one
+    // and only the bound device delivers.
+    provider1.setWidget(0);
+    QVERIFY(device1->widget() != 0);
+    device1->sendMotion(&event);
+    device2->sendMotion(&event);
+    QCOMPARE(widget1.motionsSeen, 0);
+    QCOMPARE(widget2.motionsSeen, 1);
+
+    // Removing the binding makes the device follow activation again,
+    // with the device settings of the current provider.
+    provider2.setDeviceBinding(QStringList());
+    provider1.setWidget(&widget1);
+    QCOMPARE(device1->aggregation,
+             QExtMouse3DEventProvider::TimeWeightedAverage);
+    device2->sendMotion(&event);
+    QCOMPARE(widget1.motionsSeen, 1);
+    QCOMPARE(widget2.motionsSeen, 1);
+
+    provider1.setWidget(0);
+    provider2.setWidget(0);
+    QVERIFY(device1->widget() == 0);
+    device2->setAvailable(false);
+    device1->setDeviceNames(QStringList());
+    device2->setDeviceNames(QStringList());
+}
+
+// Samples QExtMouse3DEventProvider::latestMotion() until stopped and
+// counts the samples whose axes were not all written by the same motion.
+class TestMotionReader : public QThread
+{
+public:
+    TestMotionReader(QExtMouse3DEventProvider *provider)
+        : provider(provider), torn(0), samples(0), lastSequence(0)
+        , outOfOrder(0) {}
+
+    QExtMouse3DEventProvider *provider;
+    QAtomicInt stop;
+    int torn;
+    int samples;
+    quint64 lastSequence;
+    int outOfOrder;
+
+protected:
+    void run();
+};
+
+void TestMotionReader::run()
+{
+    while (!stop.fetchAndAddAcquire(0)) {
+        short values[6];
+        qint64 timestamp;
+        quint64 sequence = provider->latestMotion(values, &timestamp);
+        for (int index = 1; index < 6; ++index) {
+            if (values[index] != values[0])
+                ++torn;
+        }
+        if (sequence && timestamp != values[0])
+            ++torn;
+        if (sequence < lastSequence)
+            ++outOfOrder;
+        lastSequence = sequence;
+        ++samples;
+    }
+}
+
+void tst_QExtMouse3DEvent::latestMotion()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+
+    short values[6] = {1, 1, 1, 1, 1, 1};
+    qint64 timestamp = -1;
+    QCOMPARE(provider.latestMotion(values, &timestamp), quint64(0));
+    QCOMPARE(values[0], short(0));
+    QCOMPARE(values[5], short(0));
+    QCOMPARE(timestamp, qint64(0));
+
+    provider.setWidget(&widget);
+    QExtMouse3DEvent event(1, -2, 3, -4, 5, -6);
+    event.setTimestamp(Q_INT64_C(42000));
+    device1->sendMotion(&event);
+    QCOMPARE(provider.latestMotion(values, &timestamp), quint64(1));
+    QCOMPARE(values[0], short(1));
+    QCOMPARE(values[1], short(-2));
+    QCOMPARE(values[2], short(3));
+    QCOMPARE(values[3], short(-4));
+    QCOMPARE(values[4], short(5));
+    QCOMPARE(values[5], short(-6));
+    QCOMPARE(timestamp, Q_INT64_C(42000));
+
+    // The state is the filtered one that the widget sees.
+    provider.setFilters(QExtMouse3DEventProvider::Rotations);
+    device1->sendMotion(&event);
+    QCOMPARE(provider.latestMotion(values), quint64(2));
+    QCOMPARE(values[0], short(0));
+    QCOMPARE(values[5], short(-6));
+    QCOMPARE(widget.translateX, 0);
+    provider.setFilters(QExtMouse3DEventProvider::Translations |
+                        QExtMouse3DEventProvider::Rotations);
+
+    // A reader on another thread never sees a partially written motion.
+    QExtMouse3DEvent uniform(7, 7, 7, 7, 7, 7);
+    uniform.setTimestamp(7);
+    device1->sendMotion(&uniform);
+    TestMotionReader reader(&provider);
+    reader.start();
+    for (int count = 1; count <= 20000; ++count) {
+        short value = short(count % 1000);
+        QExtMouse3DEvent motion(value, value, value, value, value, value);
+        motion.setTimestamp(value);
+        device1->sendMotion(&motion);
+    }
+    reader.stop.fetchAndStoreRelease(1);
+    reader.wait();
+    QVERIFY(reader.samples > 0);
+    QCOMPARE(reader.torn, 0);
+    QCOMPARE(reader.outOfOrder, 0);
+    QCOMPARE(provider.latestMotion(values), quint64(20003));
+
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::postedDelivery()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QCOMPARE(provider.delivery(),
+             QExtMouse3DEventProvider::SynchronousDelivery);
+    provider.setDelivery(QExtMouse3DEventProvider::PostedDelivery);
+    QCOMPARE(provider.delivery(), QExtMouse3DEventProvider::PostedDelivery);
+    provider.setWidget(&widget);
+
+    // Motions for the same widget update the waiting one.
+    QExtMouse3DEvent event1(1, 0, 0, 0, 0, 0);
+    event1.setTimestamp(100);
+    QExtMouse3DEvent event2(2, 0, 0, 0, 0, 6);
+    event2.setTimestamp(200);
+    device1->sendMotion(&event1);
+    device1->sendMotion(&event2);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 1);
+    QCOMPARE(widget.translateX, 2);
+    QCOMPARE(widget.rotateZ, 6);
+    QCOMPARE(widget.timestamp, qint64(200));
+
+    // Keys keep their order with respect to motions.
+    widget.clear();
+    device1->sendMotion(&event1);
+    device1->sendKeyPress(QGL::Key_TopView);
+    device1->sendMotion(&event2);
+    device1->sendMotion(&event1);
+    device1->sendKeyRelease(QGL::Key_TopView);
+    QVERIFY(widget.eventsSeen.isEmpty());
+    QCoreApplication::processEvents();
+    QList<int> expected;
+    expected << int(QExtMouse3DEvent::type) << int(QEvent::KeyPress)
+             << int(QExtMouse3DEvent::type) << int(QEvent::KeyRelease);
+    QCOMPARE(widget.eventsSeen, expected);
+    QCOMPARE(widget.translateX, 1);
+
+    // A waiting motion keeps the filters and sensitivity that were in
+    // effect when it was reported.
+    widget.clear();
+    device1->sendMotion(&event2);
+    device1->sendDeviceKey(QGL::Key_Rotations, true);
+    device1->sendDeviceKey(QGL::Key_IncreaseSensitivity, true);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 1);
+    QCOMPARE(widget.translateX, 2);
+    QCOMPARE(widget.rotateZ, 6);
+    device1->sendMotion(&event2);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 2);
+    QCOMPARE(widget.translateX, 4);
+    QCOMPARE(widget.rotateZ, 0);
+    provider.setFilters(provider.filters() | QExtMouse3DEventProvider::Rotations);
+    provider.setSensitivity(1.0f);
+
+    // Synchronous delivery waits for the events that are already queued.
+    widget.clear();
+    device1->sendMotion(&event1);
+    provider.setDelivery(QExtMouse3DEventProvider::SynchronousDelivery);
+    device1->sendKeyPress(QGL::Key_TopView);
+    QVERIFY(widget.eventsSeen.isEmpty());
+    QCoreApplication::processEvents();
+    expected.clear();
+    expected << int(QExtMouse3DEvent::type) << int(QEvent::KeyPress);
+    QCOMPARE(widget.eventsSeen, expected);
+    device1->sendMotion(&event2);
+    QCOMPARE(widget.motionsSeen, 2);
+
+    // Waiting events are dropped when the widget is unregistered.
+    provider.setDelivery(QExtMouse3DEventProvider::PostedDelivery);
+    device1->sendMotion(&event1);
+    provider.setWidget(0);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 2);
+}
+
+// Records the motions that are handed to it.
+class TestMotionSink : public QExtMouse3DMotionSink
+{
+public:
+    TestMotionSink() : motionsSeen(0), timestamp(0)
+        { memset(values, 0, sizeof(values)); }
+
+    void motion(const short values[6], qint64 timestamp)
+    {
+        ++motionsSeen;
+        memcpy(this->values, values, sizeof(this->values));
+        this->timestamp = timestamp;
+    }
+
+    int motionsSeen;
+    short values[6];
+    qint64 timestamp;
+};
+
+void tst_QExtMouse3DEvent::motionSink()
+{
+    TestMouse3DWidget widget;
+    TestMotionSink sink;
+    QExtMouse3DEventProvider provider;
+    QVERIFY(provider.motionSink() == 0);
+    QCOMPARE(provider.motionSinkThread(),
+             QExtMouse3DEventProvider::GuiThreadSink);
+    provider.setWidget(&widget);
+    provider.setMotionSink(&sink);
+    QVERIFY(provider.motionSink() == &sink);
+    QVERIFY(device1->motionSink == 0);
+
+    // Filtered motions go to the sink instead of the widget.
+    provider.setFilters(QExtMouse3DEventProvider::Rotations);
+    QExtMouse3DEvent event(1, -2, 3, -4, 5, -6);
+    event.setTimestamp(Q_INT64_C(42000));
+    device1->sendMotion(&event);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCOMPARE(sink.motionsSeen, 1);
+    QCOMPARE(sink.values[0], short(0));
+    QCOMPARE(sink.values[3], short(-4));
+    QCOMPARE(sink.values[5], short(-6));
+    QCOMPARE(sink.timestamp, Q_INT64_C(42000));
+
+    // Keys still go to the widget, and the sink is not posted.
+    device1->sendKeyPress(QGL::Key_TopView);
+    QCOMPARE(widget.eventsSeen.size(), 1);
+    provider.setDelivery(QExtMouse3DEventProvider::PostedDelivery);
+    device1->sendMotion(&event);
+    QCOMPARE(sink.motionsSeen, 2);
+    provider.setDelivery(QExtMouse3DEventProvider::SynchronousDelivery);
+
+    // A reader thread sink is handed to the devices, and is called on
+    // the GUI thread for motions that the devices pass up anyway.
+    provider.setMotionSink(&sink, QExtMouse3DEventProvider::ReaderThreadSink);
+    QCOMPARE(provider.motionSinkThread(),
+             QExtMouse3DEventProvider::ReaderThreadSink);
+    QVERIFY(device1->motionSink == &sink);
+    device1->sendMotion(&event);
+    QCOMPARE(sink.motionsSeen, 3);
+
+    provider.setMotionSink(0);
+    QVERIFY(device1->motionSink == 0);
+    device1->sendMotion(&event);
+    QCOMPARE(sink.motionsSeen, 3);
+    QCOMPARE(widget.motionsSeen, 1);
+
+    provider.setWidget(0);
+    QVERIFY(device1->motionSink == 0);
+}
+
+void tst_QExtMouse3DEvent::batchedDelivery()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setDelivery(QExtMouse3DEventProvider::BatchedDelivery);
+    provider.setWidget(&widget);
+
+    // Every motion arrives in one batch, filtered as it came in.
+    QExtMouse3DEvent event1(1, 0, 0, 0, 0, 2);
+    event1.setTimestamp(100);
+    QExtMouse3DEvent event2(3, 0, 0, 0, 0, 4);
+    event2.setTimestamp(200);
+    QExtMouse3DEvent event3(5, 0, 0, 0, 0, 6);
+    event3.setTimestamp(300);
+    device1->sendMotion(&event1);
+    device1->sendMotion(&event2);
+    provider.setFilters(QExtMouse3DEventProvider::Rotations);
+    device1->sendMotion(&event3);
+    QCOMPARE(widget.batchesSeen, 0);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.batchesSeen, 1);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCOMPARE(widget.samples.size(), 3);
+    QCOMPARE(widget.samples[0].translateX, short(1));
+    QCOMPARE(widget.samples[0].rotateZ, short(2));
+    QCOMPARE(widget.samples[0].timestamp, qint64(100));
+    QCOMPARE(widget.samples[1].translateX, short(3));
+    QCOMPARE(widget.samples[1].timestamp, qint64(200));
+    QCOMPARE(widget.samples[2].translateX, short(0));
+    QCOMPARE(widget.samples[2].rotateZ, short(6));
+    QCOMPARE(widget.samples[2].timestamp, qint64(300));
+    provider.setFilters(QExtMouse3DEventProvider::Translations |
+                        QExtMouse3DEventProvider::Rotations);
+
+    // A key splits the batch so that the order is kept.
+    widget.clear();
+    device1->sendMotion(&event1);
+    device1->sendKeyPress(QGL::Key_TopView);
+    device1->sendMotion(&event2);
+    device1->sendMotion(&event3);
+    QCoreApplication::processEvents();
+    QList<int> expected;
+    expected << int(QExtMouse3DBatchEvent::type) << int(QEvent::KeyPress)
+             << int(QExtMouse3DBatchEvent::type);
+    QCOMPARE(widget.eventsSeen, expected);
+    QCOMPARE(widget.samples.size(), 3);
+    QCOMPARE(widget.samples[2].translateX, short(5));
+
+    // The next batch starts empty.
+    widget.clear();
+    device1->sendMotion(&event2);
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.batchesSeen, 1);
+    QCOMPARE(widget.samples.size(), 1);
+    QCOMPARE(widget.samples[0].translateX, short(3));
+
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::normalizedMotion()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QVERIFY(!provider.normalizedMotion());
+    provider.setNormalizedMotion(true);
+    QVERIFY(provider.normalizedMotion());
+    provider.setWidget(&widget);
+
+    int ranges[6] = {350, 350, 350, 500, 500, 500};
+    device1->setRanges(ranges);
+    QCOMPARE(device1->axisRange(0), 350);
+    QCOMPARE(device1->axisRange(5), 500);
+
+    // Each axis is scaled with the range of the device.
+    QExtMouse3DEvent event(350, -175, 0, 500, -250, 125);
+    event.setTimestamp(Q_INT64_C(42000));
+    device1->sendMotion(&event);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCOMPARE(widget.normalizedSeen, 1);
+    QCOMPARE(widget.normalized[0], qreal(1.0f));
+    QCOMPARE(widget.normalized[1], qreal(-0.5f));
+    QCOMPARE(widget.normalized[2], qreal(0.0f));
+    QCOMPARE(widget.normalized[3], qreal(1.0f));
+    QCOMPARE(widget.normalized[4], qreal(-0.5f));
+    QCOMPARE(widget.normalized[5], qreal(0.25f));
+    QCOMPARE(widget.timestamp, Q_INT64_C(42000));
+
+    // High sensitivity does not saturate, and low sensitivity does
+    // not round small deflections away.
+    provider.setSensitivity(64.0f);
+    QExtMouse3DEvent large(350, 0, 0, 0, 0, 0);
+    device1->sendMotion(&large);
+    QCOMPARE(widget.normalized[0], qreal(64.0f));
+    provider.setSensitivity(1.0f / 64.0f);
+    QExtMouse3DEvent small(0, 0, 0, 0, 0, 1);
+    device1->sendMotion(&small);
+    QCOMPARE(widget.normalized[5], qreal(1.0f / 64.0f) / 500);
+    provider.setSensitivity(1.0f);
+
+    // The dominant axis is picked after scaling.
+    provider.setFilters(QExtMouse3DEventProvider::Translations |
+                        QExtMouse3DEventProvider::Rotations |
+                        QExtMouse3DEventProvider::DominantAxis);
+    QExtMouse3DEvent dominant(300, 0, 0, 400, 0, 0);
+    device1->sendMotion(&dominant);
+    QVERIFY(widget.normalized[0] > 0.8f);
+    QCOMPARE(widget.normalized[3], qreal(0.0f));
+
+    int defaults[6] = {32767, 32767, 32767, 32767, 32767, 32767};
+    device1->setRanges(defaults);
+    provider.setWidget(0);
+}
+
+// Receives the events of a provider in place of its widget and
+// records the thread that they were delivered on.
+class TestMouse3DTarget : public QObject
+{
+public:
+    TestMouse3DTarget() : translateX(0), rotateZ(0), eventThread(0) {}
+
+    QAtomicInt motionsSeen;
+    QAtomicInt keyPressesSeen;
+    int translateX;
+    int rotateZ;
+    QThread *eventThread;
+
+protected:
+    bool event(QEvent *e);
+};
+
+bool TestMouse3DTarget::event(QEvent *e)
+{
+    if (e->type() == QExtMouse3DEvent::type) {
+        QExtMouse3DEvent *mouse = static_cast<QExtMouse3DEvent *>(e);
+        translateX = mouse->translateX();
+        rotateZ = mouse->rotateZ();
+        eventThread = QThread::currentThread();
+        motionsSeen.fetchAndAddRelease(1);
+        return true;
+    } else if (e->type() == QEvent::KeyPress) {
+        eventThread = QThread::currentThread();
+        keyPressesSeen.fetchAndAddRelease(1);
+        return true;
+    }
+    return QObject::event(e);
+}
+
+// Creates and destroys providers without widgets.
+class TestProviderChurn : public QThread
+{
+protected:
+    void run();
+};
+
+void TestProviderChurn::run()
+{
+    for (int count = 0; count < 1000; ++count) {
+        QExtMouse3DEventProvider provider;
+        provider.setSensitivity(2.0f);
+    }
+}
+
+// Creates a provider for a widget in the GUI thread, with a target
+// in its own thread, and runs an event loop until told to quit.
+class TestProviderThread : public QThread
+{
+public:
+    TestProviderThread(QWidget *widget) : widget(widget), target(0) {}
+
+    QWidget *widget;
+    TestMouse3DTarget *target;
+    QAtomicInt ready;
+
+protected:
+    void run();
+};
+
+void TestProviderThread::run()
+{
+    QExtMouse3DEventProvider *provider = new QExtMouse3DEventProvider();
+    target = new TestMouse3DTarget();
+    provider->setTarget(target);
+    provider->setWidget(widget);
+    provider->setFilters(QExtMouse3DEventProvider::Rotations);
+    ready.fetchAndStoreRelease(1);
+    exec();
+    delete provider;
+}
+
+void tst_QExtMouse3DEvent::workerThreads()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+
+    // Providers can come and go in several threads at once.
+    TestProviderChurn churn[4];
+    for (int index = 0; index < 4; ++index)
+        churn[index].start();
+    for (int index = 0; index < 4; ++index)
+        churn[index].wait();
+
+    // A target in another thread gets the events on that thread.
+    // Motions that wait for a busy thread are replaced by newer ones.
+    QThread worker;
+    TestMouse3DTarget target;
+    target.moveToThread(&worker);
+    provider.setTarget(&target);
+    provider.setWidget(&widget);
+    for (int count = 1; count <= 100; ++count) {
+        QExtMouse3DEvent waiting(count, 0, 0, 0, 0, 0);
+        device1->sendMotion(&waiting);
+    }
+    device1->sendKeyPress(QGL::Key_TopView);
+    worker.start();
+    for (int count = 0; count < 100; ++count) {
+        if (target.keyPressesSeen.fetchAndAddAcquire(0))
+            break;
+        QTest::qWait(10);
+    }
+    QCOMPARE(target.motionsSeen.fetchAndAddAcquire(0), 1);
+    QCOMPARE(target.keyPressesSeen.fetchAndAddAcquire(0), 1);
+    QCOMPARE(target.translateX, 100);
+    QVERIFY(target.eventThread == &worker);
+    QCOMPARE(widget.motionsSeen, 0);
+    QCOMPARE(widget.keyPressesSeen, 0);
+    provider.setWidget(0);
+    provider.setTarget(0);
+    worker.quit();
+    worker.wait();
+
+    // A provider that lives in another thread is configured from there,
+    // and the changes reach the devices once the GUI thread runs.
+    TestProviderThread thread(&widget);
+    thread.start();
+    while (!thread.ready.fetchAndAddAcquire(0))
+        QTest::qWait(10);
+    QCoreApplication::processEvents();
+    QExtMouse3DEvent event(1, -2, 3, -4, 5, -6);
+    device1->sendMotion(&event);
+    for (int count = 0; count < 100; ++count) {
+        if (thread.target->motionsSeen.fetchAndAddAcquire(0))
+            break;
+        QTest::qWait(10);
+    }
+    QCOMPARE(thread.target->motionsSeen.fetchAndAddAcquire(0), 1);
+    QCOMPARE(thread.target->translateX, 0);
+    QCOMPARE(thread.target->rotateZ, -6);
+    QVERIFY(thread.target->eventThread == &thread);
+
+    // Destroying the provider in its thread waits for the GUI thread
+    // to release the widget, so keep the event loop running meanwhile.
+    thread.quit();
+    while (!thread.isFinished())
+        QTest::qWait(10);
+    thread.wait();
+    delete thread.target;
+    device1->sendMotion(&event);
+    QCOMPARE(widget.motionsSeen, 0);
+}
+
+// Events that are waiting for a target when it is destroyed are
+// dropped, and later events go to the widget again.
+void tst_QExtMouse3DEvent::destroyedTarget()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    TestMouse3DTarget *target = new TestMouse3DTarget();
+    provider.setTarget(target);
+    provider.setWidget(&widget);
+
+    QExtMouse3DEvent event(1, 0, 0, 0, 0, 0);
+    device1->sendMotion(&event);
+    delete target;
+    QCoreApplication::processEvents();
+    QCOMPARE(widget.motionsSeen, 0);
+    QVERIFY(!provider.target());
+
+    device1->sendMotion(&event);
+    QCOMPARE(widget.motionsSeen, 1);
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::deviceRegistry()
+{
+    QExtMouse3DEventProvider provider;
+    quint64 generation = provider.deviceGeneration();
+
+    // Reading the registry does not query the devices.
+    QVERIFY(provider.isAvailable());
+    QVERIFY(provider.deviceNames().isEmpty());
+    QVERIFY(provider.deviceDescriptors().isEmpty());
+    QCOMPARE(provider.deviceGeneration(), generation);
+
+    // Plugging in a device rebuilds it.
+    device2->setDeviceNames(QStringList() << "SpacePilot PRO");
+    device2->setAvailable(true);
+    quint64 current = 0;
+    QList<QExtMouse3DDeviceDescriptor> descriptors =
+        provider.deviceDescriptors(&current);
+    QVERIFY(current > generation);
+    QCOMPARE(provider.deviceGeneration(), current);
+    QCOMPARE(descriptors.size(), 1);
+    QCOMPARE(descriptors.at(0).name, QString("SpacePilot PRO"));
+    QCOMPARE(descriptors.at(0).vendorId, 0);
+    QCOMPARE(descriptors.at(0).axisRanges[0], 32767);
+    QCOMPARE(descriptors.at(0).buttonCount, 0);
+    QVERIFY(!descriptors.at(0).hasLcd);
+    QCOMPARE(provider.deviceNames(), QStringList() << "SpacePilot PRO");
+
+    // So does a device learning more about itself when it is opened.
+    generation = current;
+    int ranges[6] = {350, 350, 350, 350, 350, 350};
+    device2->setRanges(ranges);
+    device2->setInfo(0x046d, 0xc629, 31, true);
+    device2->setInfo(0x046d, 0xc629, 31, true);
+    descriptors = provider.deviceDescriptors(&current);
+    QCOMPARE(current, generation + 2);
+    QCOMPARE(descriptors.at(0).vendorId, 0x046d);
+    QCOMPARE(descriptors.at(0).productId, 0xc629);
+    QCOMPARE(descriptors.at(0).axisRanges[5], 350);
+    QCOMPARE(descriptors.at(0).buttonCount, 31);
+    QVERIFY(descriptors.at(0).hasLcd);
+
+    int defaults[6] = {32767, 32767, 32767, 32767, 32767, 32767};
+    device2->setRanges(defaults);
+    device2->setInfo(0, 0, 0, false);
+    device2->setAvailable(false);
+    device2->setDeviceNames(QStringList());
+    QVERIFY(provider.deviceDescriptors().isEmpty());
+}
+
+void tst_QExtMouse3DEvent::deviceKeys()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    provider.setWidget(&widget);
+    QExtMouse3DEventProvider::Filters filters = provider.filters();
+    QVERIFY(filters & QExtMouse3DEventProvider::Translations);
+
+    // Pressing a lock key toggles the filter; releasing it does not.
+    device1->sendDeviceKey(QGL::Key_Translations, true);
+    QCOMPARE(widget.keyPressesSeen, 1);
+    QCOMPARE(widget.keyPressed, int(QGL::Key_Translations));
+    QVERIFY(!(provider.filters() & QExtMouse3DEventProvider::Translations));
+    device1->sendDeviceKey(QGL::Key_Translations, false);
+    QCOMPARE(widget.keyReleasesSeen, 1);
+    QCOMPARE(widget.keyReleased, int(QGL::Key_Translations));
+    QVERIFY(!(provider.filters() & QExtMouse3DEventProvider::Translations));
+    device1->sendDeviceKey(QGL::Key_Translations, true);
+    QVERIFY(provider.filters() & QExtMouse3DEventProvider::Translations);
+
+    device1->sendDeviceKey(QGL::Key_IncreaseSensitivity, true);
+    QCOMPARE(provider.sensitivity(), qreal(2.0f));
+    device1->sendDeviceKey(QGL::Key_DecreaseSensitivity, true);
+    QCOMPARE(provider.sensitivity(), qreal(1.0f));
+
+    // Other keys are passed through without side effects.
+    device1->sendDeviceKey(QGL::Key_TopView, true);
+    QCOMPARE(widget.keyPressed, int(QGL::Key_TopView));
+    QCOMPARE(widget.keyPressesSeen, 5);
+    QVERIFY(provider.filters() == filters);
+
+    provider.setWidget(0);
+}
+
+void tst_QExtMouse3DEvent::hidReports()
+{
+    static const uchar translate[] = {0x01, 0x0a, 0x00, 0xec, 0xff, 0x2c, 0x01};
+    static const uchar rotate[] = {0x02, 0x05, 0x00, 0x00, 0x00, 0xf4, 0xfe};
+    static const uchar combined[] =
+        {0x01, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00,
+         0x04, 0x00, 0x05, 0x00, 0x06, 0x00};
+    static const uchar bogus[] = {0x07, 0x01, 0x02};
+
+    QExtMouse3DHidParser parser;
+    const int *values = parser.values();
+
+    // The translation is held until the rotation arrives.
+    QCOMPARE(parser.parse(translate, sizeof(translate)),
+             int(QExtMouse3DHidParser::NoResult));
+    QCOMPARE(parser.parse(rotate, sizeof(rotate)),
+             int(QExtMouse3DHidParser::Motion));
+    QCOMPARE(values[0], 10);
+    QCOMPARE(values[1], -20);
+    QCOMPARE(values[2], 300);
+    QCOMPARE(values[3], 5);
+    QCOMPARE(values[4], 0);
+    QCOMPARE(values[5], -268);
+
+    // A second translation without a rotation flushes the first.
+    parser.reset();
+    QCOMPARE(parser.parse(translate, sizeof(translate)),
+             int(QExtMouse3DHidParser::NoResult));
+    QCOMPARE(parser.parse(translate, sizeof(translate)),
+             int(QExtMouse3DHidParser::Motion));
+    QCOMPARE(values[2], 300);
+    QCOMPARE(values[5], 0);
+
+    // Some devices send all six axes in one report.
+    parser.reset();
+    QCOMPARE(parser.parse(combined, sizeof(combined)),
+             int(QExtMouse3DHidParser::Motion));
+    for (int axis = 0; axis < 6; ++axis)
+        QCOMPARE(values[axis], axis + 1);
+
+    // Short and unknown reports are ignored.
+    QCOMPARE(parser.parse(translate, 4), int(QExtMouse3DHidParser::NoResult));
+    QCOMPARE(parser.parse(bogus, sizeof(bogus)),
+             int(QExtMouse3DHidParser::NoResult));
+    QCOMPARE(parser.parse(bogus, 0), int(QExtMouse3DHidParser::NoResult));
+
+    // The values are passed through the calibration.
+    parser.reset();
+    for (int axis = 0; axis < 6; ++axis)
+        parser.calibration()->setAxis(axis, -500, 500, 16);
+    static const uchar noise[] = {0x01, 0x03, 0x00, 0xfe, 0xff, 0x01, 0x00};
+    parser.parse(noise, sizeof(noise));
+    QCOMPARE(parser.parse(rotate, sizeof(rotate)),
+             int(QExtMouse3DHidParser::Motion));
+    QCOMPARE(values[0], 0);
+    QCOMPARE(values[1], 0);
+    QCOMPARE(values[2], 0);
+    QVERIFY(values[5] < 0);
+}
+
+void tst_QExtMouse3DEvent::hidButtons()
+{
+    static const uchar first[] = {0x03, 0x05, 0x00, 0x00};
+    static const uchar second[] = {0x03, 0x04, 0x00, 0x40};
+    static const uchar released[] = {0x03, 0x00, 0x00, 0x00};
+
+    QExtMouse3DHidParser parser;
+    parser.setProductId(QExtMouse3DHidParser::SpacePilotPRO);
+
+    QCOMPARE(parser.parse(first, sizeof(first)),
+             int(QExtMouse3DHidParser::Buttons));
+    QCOMPARE(parser.buttons(), quint32(0x000005));
+    QCOMPARE(parser.changedButtons(), quint32(0x000005));
+
+    // Only the buttons that changed are reported.
+    QCOMPARE(parser.parse(second, sizeof(second)),
+             int(QExtMouse3DHidParser::Buttons));
+    QCOMPARE(parser.buttons(), quint32(0x400004));
+    QCOMPARE(parser.changedButtons(), quint32(0x400001));
+    QCOMPARE(parser.parse(second, sizeof(second)),
+             int(QExtMouse3DHidParser::NoResult));
+    QCOMPARE(parser.parse(released, sizeof(released)),
+             int(QExtMouse3DHidParser::Buttons));
+    QCOMPARE(parser.changedButtons(), quint32(0x400004));
+
+    // The SpacePilot PRO numbers its buttons in key order.
+    QCOMPARE(parser.buttonKey(0), QExtMouse3DHidParser::MenuKey);
+    QCOMPARE(parser.buttonKey(2), QExtMouse3DHidParser::TopViewKey);
+    QCOMPARE(parser.buttonKey(30), QExtMouse3DHidParser::DecreaseSensitivityKey);
+    QCOMPARE(parser.buttonKey(31), QExtMouse3DHidParser::NoKey);
+    QCOMPARE(parser.buttonCount(), 31);
+
+    parser.setProductId(QExtMouse3DHidParser::SpacePilot);
+    QCOMPARE(parser.buttonKey(0), QExtMouse3DHidParser::Button1Key);
+    QCOMPARE(parser.buttonKey(6), QExtMouse3DHidParser::TopViewKey);
+    QCOMPARE(parser.buttonKey(19), QExtMouse3DHidParser::RotationKey);
+    QCOMPARE(parser.buttonKey(20), QExtMouse3DHidParser::NoKey);
+    QCOMPARE(parser.buttonCount(), 20);
+
+    parser.setProductId(QExtMouse3DHidParser::SpaceExplorer);
+    QCOMPARE(parser.buttonKey(11), QExtMouse3DHidParser::MenuKey);
+    QCOMPARE(parser.buttonKey(15), QExtMouse3DHidParser::NoKey);
+    QCOMPARE(parser.buttonCount(), 15);
+
+    QCOMPARE(QExtMouse3DHidParser::keyCode(QExtMouse3DHidParser::MenuKey, false),
+             int(Qt::Key_Menu));
+    QCOMPARE(QExtMouse3DHidParser::keyCode(QExtMouse3DHidParser::MenuKey, true),
+             int(QGL::Key_Translations));
+    QCOMPARE(QExtMouse3DHidParser::keyCode(QExtMouse3DHidParser::FitKey, true),
+             int(QGL::Key_Rotations));
+    QCOMPARE(QExtMouse3DHidParser::keyCode(QExtMouse3DHidParser::Button10Key, false),
+             int(QGL::Key_Button10));
+    QCOMPARE(QExtMouse3DHidParser::keyCode(QExtMouse3DHidParser::NoKey, false), -1);
+}
+
+void tst_QExtMouse3DEvent::calibration()
+{
+    int values[3];
+
+    // The default calibration passes values through unchanged.
+    QExtMouse3DCalibration calibration;
+    int small[3] = {1, -2, 3};
+    calibration.calibrate(0, small, values);
+    QCOMPARE(values[0], 1);
+    QCOMPARE(values[1], -2);
+    QCOMPARE(values[2], 3);
+
+    for (int axis = 0; axis < 6; ++axis)
+        calibration.setAxis(axis, -500, 500, 20);
+
+    // Axial dead zones do not let one axis suppress another, and
+    // rescale the remaining travel to the full range.
+    calibration.setDeadZoneShape(QExtMouse3DCalibration::AxialDeadZone);
+    int axial[3] = {10, -300, 0};
+    calibration.calibrate(0, axial, values);
+    QCOMPARE(values[0], 0);
+    QCOMPARE(values[1], -292);
+    QCOMPARE(values[2], 0);
+
+    // Radial dead zones act on the length of the vector.
+    calibration.setDeadZoneShape(QExtMouse3DCalibration::RadialDeadZone);
+    int inside[3] = {10, 10, 0};
+    calibration.calibrate(3, inside, values);
+    QCOMPARE(values[0], 0);
+    QCOMPARE(values[1], 0);
+    QCOMPARE(values[2], 0);
+
+    int edge[3] = {15, 15, 0};
+    calibration.calibrate(0, edge, values);
+    QCOMPARE(values[0], 1);
+    QCOMPARE(values[1], 1);
+    QCOMPARE(values[2], 0);
+
+    int full[3] = {500, 0, 0};
+    calibration.calibrate(0, full, values);
+    QCOMPARE(values[0], 500);
+    QCOMPARE(values[1], 0);
+    QCOMPARE(values[2], 0);
+
+    // The direction of the vector is preserved.
+    int diagonal[3] = {-200, 100, 50};
+    calibration.calibrate(0, diagonal, values);
+    QCOMPARE(values[0], -190);
+    QCOMPARE(values[1], 95);
+    QCOMPARE(values[2], 48);
+}
+
+void tst_QExtMouse3DEvent::adaptiveCalibration()
+{
+    QExtMouse3DCalibration calibration;
+    for (int axis = 0; axis < 6; ++axis)
+        calibration.setAxis(axis, -500, 500, 20);
+    calibration.setAdaptive(true);
+    QVERIFY(calibration.isAdaptive());
+    QCOMPARE(calibration.bias(0), 0);
+    QCOMPARE(calibration.learnedDeadZone(0), 20);
+
+    // Simulate a worn device that rests off-center within its nominal
+    // dead zone, with a little noise.
+    int values[3];
+    for (int sample = 0; sample < 4000; ++sample) {
+        int noise = (sample % 3) - 1;
+        int raw[3] = {15 + noise, -12 - noise, 5};
+        calibration.calibrate(0, raw, values);
+    }
+    QCOMPARE(calibration.bias(0), 15);
+    QCOMPARE(calibration.bias(1), -12);
+    QCOMPARE(calibration.bias(2), 5);
+    QVERIFY(calibration.learnedDeadZone(0) < 20);
+    QVERIFY(calibration.learnedDeadZone(1) < 20);
+
+    // The resting position is now reported as zero, and a small
+    // deliberate motion is no longer swallowed by the dead zone.
+    int rest[3] = {16, -13, 5};
+    calibration.calibrate(0, rest, values);
+    QCOMPARE(values[0], 0);
+    QCOMPARE(values[1], 0);
+    QCOMPARE(values[2], 0);
+
+    int motion[3] = {45, -12, 5};
+    calibration.calibrate(0, motion, values);
+    QVERIFY(values[0] > 20);
+    QCOMPARE(values[1], 0);
+    QCOMPARE(values[2], 0);
+
+    // A slow pan that ends in a held deflection is not learned as
+    // drift, and the deflection is still reported after being held
+    // for as long as it took to learn the offset above.
+    int held = 0;
+    for (int sample = 0; sample < 4000; ++sample) {
+        int noise = (sample % 3) - 1;
+        int raw[3] = {qMin(15 + sample / 8, 60) + noise, -12 - noise, 5};
+        calibration.calibrate(0, raw, values);
+        held = values[0];
+    }
+    QCOMPARE(calibration.bias(0), 15);
+    QVERIFY(held > 20);
+
+    // Once the device is released, the offset is learned again.
+    for (int sample = 0; sample < 4000; ++sample) {
+        int noise = (sample % 3) - 1;
+        int raw[3] = {10 + noise, -12 - noise, 5};
+        calibration.calibrate(0, raw, values);
+    }
+    QCOMPARE(calibration.bias(0), 10);
+    QCOMPARE(values[0], 0);
+
+    // Learning does not affect the other triple.
+    QCOMPARE(calibration.bias(3), 0);
+    QCOMPARE(calibration.learnedDeadZone(3), 20);
+}
+
+void tst_QExtMouse3DEvent::calibrationSetting()
+{
+    TestMouse3DWidget widget;
+    QExtMouse3DEventProvider provider;
+    QVERIFY(provider.adaptiveCalibration());
+
+    provider.setAdaptiveCalibration(false);
+    QVERIFY(!provider.adaptiveCalibration());
+
+    // The setting is passed on when the provider becomes current.
+    QVERIFY(device1->adaptive);
+    provider.setWidget(&widget);
+    QVERIFY(!device1->adaptive);
+
+    provider.setAdaptiveCalibration(true);
+    QVERIFY(device1->adaptive);
+
+    // Providers that are not attached to the device do not affect it.
+    QExtMouse3DEventProvider provider2;
+    provider2.setAdaptiveCalibration(false);
+    QVERIFY(device1->adaptive);
+
+    provider.setWidget(0);
+}
+
 QTEST_MAIN(tst_QExtMouse3DEvent)
 
 #include "tst_qmouse3devent.moc"
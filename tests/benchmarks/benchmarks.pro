@@ -0,0 +1,3 @@
+TEMPLATE = subdirs
+SUBDIRS = qmouse3deventprovider
+linux*:SUBDIRS += linuxinput
@@ -0,0 +1,15 @@
+load(qttest_p4.prf)
+TEMPLATE=app
+QT += testlib
+CONFIG += warn_on
+
+TARGET = tst_bench_linuxinput
+
+LINUXINPUT = ../../../src/plugins/mouse3d/linuxinput
+INCLUDEPATH += $$LINUXINPUT
+SOURCES += tst_bench_linuxinput.cpp \
+           $$LINUXINPUT/qmouse3dlinuxinputparser.cpp
+
+LIBS += -L../../../lib -L../../../bin
+
+include(../../../src/threed/threed_dep.pri)
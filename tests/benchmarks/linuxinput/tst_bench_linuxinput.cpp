@@ -0,0 +1,216 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include "qmouse3dlinuxinputparser.h"
+#include "qmouse3dhidparser_p.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// Number of SYN_REPORT packets written to the pipe per iteration.
+// Each packet is six axis events plus the EV_SYN, as sent by a
+// SpacePilot PRO, and the whole burst must fit into the pipe buffer.
+#define PACKET_COUNT    256
+
+class tst_LinuxInput : public QObject
+{
+    Q_OBJECT
+public:
+    tst_LinuxInput() {}
+    ~tst_LinuxInput() {}
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void readBacklog_data();
+    void readBacklog();
+    void parseRecorded_data();
+    void parseRecorded();
+
+private:
+    int fds[2];
+    QVector<struct input_event> stream;
+
+    void writeBacklog();
+};
+
+static struct input_event makeEvent(int type, int code, int value)
+{
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return event;
+}
+
+void tst_LinuxInput::initTestCase()
+{
+    QVERIFY(::pipe(fds) == 0);
+    ::fcntl(fds[0], F_SETFL, ::fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    for (int packet = 0; packet < PACKET_COUNT; ++packet) {
+        for (int axis = ABS_X; axis <= ABS_RZ; ++axis)
+            stream.append(makeEvent(EV_ABS, axis, 100 + packet + axis));
+        stream.append(makeEvent(EV_SYN, SYN_REPORT, 0));
+    }
+}
+
+void tst_LinuxInput::cleanupTestCase()
+{
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void tst_LinuxInput::writeBacklog()
+{
+    int size = stream.size() * sizeof(struct input_event);
+    QCOMPARE(int(::write(fds[1], stream.constData(), size)), size);
+}
+
+void tst_LinuxInput::readBacklog_data()
+{
+    QTest::addColumn<bool>("batched");
+
+    QTest::newRow("one event per read") << false;
+    QTest::newRow("batched read") << true;
+}
+
+// Drains a backlog of motion packets the way readyRead() does, and
+// reports the number of read() system calls per decoded motion.
+void tst_LinuxInput::readBacklog()
+{
+    QFETCH(bool, batched);
+
+    QExtMouse3DLinuxInputParser parser;
+    QExtMouse3DLinuxInputPacket packet;
+    quint64 reads = 0;
+    quint64 motions = 0;
+
+    QBENCHMARK {
+        writeBacklog();
+        if (batched) {
+            int count;
+            do {
+                count = parser.readEvents(fds[0]);
+                ++reads;
+                while (parser.nextPacket(&packet))
+                    ++motions;
+            } while (count == QExtMouse3DLinuxInputParser::BatchSize);
+        } else {
+            // The original drain loop: one read() per input_event.
+            struct input_event event;
+            for (;;) {
+                ++reads;
+                if (::read(fds[0], &event, sizeof(event)) != sizeof(event))
+                    break;
+                if (parser.parse(event, &packet))
+                    ++motions;
+            }
+        }
+    }
+
+    QVERIFY(motions > 0);
+    qDebug("%s: %.3f read() calls per motion",
+           batched ? "batched read" : "one event per read",
+           double(reads) / double(motions));
+}
+
+void tst_LinuxInput::parseRecorded_data()
+{
+    QTest::addColumn<bool>("hid");
+
+    QTest::newRow("evdev events") << false;
+    QTest::newRow("hid reports") << true;
+}
+
+// Decodes the same motions from an in-memory recording of the evdev
+// events and of the HID reports, without any system calls, and
+// reports how many records each interface needs per motion.
+void tst_LinuxInput::parseRecorded()
+{
+    QFETCH(bool, hid);
+
+    QVector<uchar> reports;
+    for (int packet = 0; packet < PACKET_COUNT; ++packet) {
+        for (int half = 0; half < 2; ++half) {
+            reports.append(uchar(half + 1));
+            for (int axis = 0; axis < 3; ++axis) {
+                int value = 100 + packet + half * 3 + axis;
+                reports.append(uchar(value & 0xff));
+                reports.append(uchar((value >> 8) & 0xff));
+            }
+        }
+    }
+
+    int motions = 0;
+    if (hid) {
+        QExtMouse3DHidParser parser;
+        QBENCHMARK {
+            motions = 0;
+            const uchar *report = reports.constData();
+            for (int index = 0; index < PACKET_COUNT * 2; ++index, report += 7) {
+                if (parser.parse(report, 7) & QExtMouse3DHidParser::Motion)
+                    ++motions;
+            }
+        }
+    } else {
+        QExtMouse3DLinuxInputParser parser;
+        QExtMouse3DLinuxInputPacket packet;
+        int size = stream.size() * sizeof(struct input_event);
+        QBENCHMARK {
+            motions = 0;
+            parser.setEvents(stream.constData(), size);
+            while (parser.nextPacket(&packet))
+                ++motions;
+        }
+    }
+
+    QCOMPARE(motions, PACKET_COUNT);
+    int records = (hid ? PACKET_COUNT * 2 : stream.size());
+    qDebug("%s: %.1f records per motion",
+           hid ? "hid reports" : "evdev events",
+           double(records) / double(motions));
+}
+
+QTEST_MAIN(tst_LinuxInput)
+
+#include "tst_bench_linuxinput.moc"
@@ -0,0 +1,12 @@
+load(qttest_p4.prf)
+TEMPLATE=app
+QT += testlib
+CONFIG += warn_on
+
+TARGET = tst_bench_qmouse3deventprovider
+
+SOURCES += tst_bench_qmouse3deventprovider.cpp
+
+LIBS += -L../../../lib -L../../../bin
+
+include(../../../src/threed/threed_dep.pri)
@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Nokia Corporation and/or its subsidiary(-ies).
+** All rights reserved.
+** Contact: Nokia Corporation (qt-info@nokia.com)
+**
+** This file is part of the Qt3D module of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** No Commercial Usage
+** This file contains pre-release code and may not be distributed.
+** You may use this file in accordance with the terms and conditions
+** contained in the Technology Preview License Agreement accompanying
+** this package.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights.  These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** If you have questions regarding the use of this file, please contact
+** Nokia at qt-info@nokia.com.
+**
+**
+**
+**
+**
+**
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtGui/qwidget.h>
+#include "qmouse3deventprovider.h"
+
+// Number of event pairs sent to the widget per iteration.
+#define EVENT_COUNT     1000
+
+class tst_QExtMouse3DEventProvider : public QObject
+{
+    Q_OBJECT
+public:
+    tst_QExtMouse3DEventProvider() {}
+    ~tst_QExtMouse3DEventProvider() {}
+
+private slots:
+    void eventFilter_data();
+    void eventFilter();
+};
+
+void tst_QExtMouse3DEventProvider::eventFilter_data()
+{
+    QTest::addColumn<int>("widgetCount");
+    QTest::addColumn<bool>("registered");
+
+    QTest::newRow("unregistered") << 1 << false;
+    QTest::newRow("1 widget") << 1 << true;
+    QTest::newRow("10 widgets") << 10 << true;
+    QTest::newRow("100 widgets") << 100 << true;
+}
+
+// Sends the timer and mouse move events that a busy viewport receives
+// all the time to one of several widgets with registered providers.
+// The difference to the unregistered row is the cost of the event
+// filter that tracks window activation.
+void tst_QExtMouse3DEventProvider::eventFilter()
+{
+    QFETCH(int, widgetCount);
+    QFETCH(bool, registered);
+
+    QList<QWidget *> widgets;
+    QList<QExtMouse3DEventProvider *> providers;
+    for (int index = 0; index < widgetCount; ++index) {
+        QWidget *widget = new QWidget();
+        widgets.append(widget);
+        if (registered) {
+            QExtMouse3DEventProvider *provider = new QExtMouse3DEventProvider();
+            provider->setWidget(widget);
+            providers.append(provider);
+        }
+    }
+
+    QWidget *target = widgets.last();
+    QTimerEvent timer(1);
+    QMouseEvent move(QEvent::MouseMove, QPoint(1, 1),
+                     Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+    QBENCHMARK {
+        for (int count = 0; count < EVENT_COUNT; ++count) {
+            QApplication::sendEvent(target, &timer);
+            QApplication::sendEvent(target, &move);
+        }
+    }
+
+    qDeleteAll(providers);
+    qDeleteAll(widgets);
+}
+
+QTEST_MAIN(tst_QExtMouse3DEventProvider)
+
+#include "tst_bench_qmouse3deventprovider.moc"